@@ -0,0 +1,153 @@
+//============================================================================
+/**
+	Implementation file for AnnotationFile.h
+
+	@author		agent
+	@date		20261017
+*/
+//============================================================================
+
+// Includes
+#include <sstream>
+#include <stdexcept>
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include "AnnotationFile.h"
+#include "ResultStore.h"
+
+using std::string;
+using std::runtime_error;
+using boost::filesystem::path;
+
+AnnotationFile::AnnotationFile(const path& inFilePath, const Archives& inArchives)
+: m_FilePath(inFilePath), m_IsArchived(false), m_Begin(NULL), m_End(NULL)
+{
+	for (size_t i = 0; i < inArchives.size() && !m_IsArchived; ++i)
+	{
+		m_IsArchived = inArchives[i]->findMember(inFilePath, m_Begin, m_End);
+	}
+	m_IsCompressed = m_IsArchived ? CompressedLabFile::isCompressed(m_Begin, m_End) : CompressedLabFile::isCompressed(inFilePath);
+}
+
+AnnotationFile::~AnnotationFile()
+{
+	if (!m_ExtractedDir.empty())
+	{
+		boost::system::error_code theError;
+		boost::filesystem::remove_all(m_ExtractedDir, theError);
+	}
+}
+
+bool AnnotationFile::exists(const path& inFilePath, const Archives& inArchives)
+{
+	const char* theBegin;
+	const char* theEnd;
+	for (size_t i = 0; i < inArchives.size(); ++i)
+	{
+		if (inArchives[i]->findMember(inFilePath, theBegin, theEnd))
+		{
+			return true;
+		}
+	}
+	boost::system::error_code theError;
+	return boost::filesystem::is_regular_file(inFilePath, theError);
+}
+
+bool AnnotationFile::isCompressed() const
+{
+	return m_IsCompressed;
+}
+
+bool AnnotationFile::isLabFile(const string& inFormat) const
+{
+	return inFormat == "auto" && (m_IsCompressed || (m_FilePath.extension() == ".lab" && (m_IsArchived || boost::filesystem::is_regular_file(m_FilePath))));
+}
+
+const boost::shared_ptr<CompressedLabFile> AnnotationFile::openCompressed() const
+{
+	if (m_IsArchived)
+	{
+		return boost::shared_ptr<CompressedLabFile>(new CompressedLabFile(m_Begin, m_End, m_FilePath.string()));
+	}
+	return boost::shared_ptr<CompressedLabFile>(new CompressedLabFile(m_FilePath));
+}
+
+const path& AnnotationFile::getPath()
+{
+	if (m_IsCompressed)
+	{
+		throw runtime_error("Could not read the compressed file '" + m_FilePath.string() + "', only files in the three-column lab format can be compressed");
+	}
+	if (m_IsArchived && m_ExtractedDir.empty())
+	{
+		m_ExtractedDir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("MusOOEvaluator-%%%%-%%%%-%%%%-%%%%");
+		boost::filesystem::create_directory(m_ExtractedDir);
+		m_ExtractedPath = m_ExtractedDir / m_FilePath.filename();
+		boost::filesystem::ofstream theFile(m_ExtractedPath, std::ios::binary);
+		theFile.write(m_Begin, m_End - m_Begin);
+		if (!theFile.good())
+		{
+			throw runtime_error("Could not extract '" + m_FilePath.string() + "' to '" + m_ExtractedPath.string() + "'");
+		}
+	}
+	return m_IsArchived ? m_ExtractedPath : m_FilePath;
+}
+
+const boost::uintmax_t AnnotationFile::getSize() const
+{
+	if (m_IsArchived)
+	{
+		return m_End - m_Begin;
+	}
+	boost::system::error_code theError;
+	const boost::uintmax_t theSize = boost::filesystem::file_size(m_FilePath, theError);
+	return theError ? 0 : theSize;
+}
+
+const string AnnotationFile::readText()
+{
+	if (m_IsCompressed)
+	{
+		const boost::shared_ptr<CompressedLabFile> theFile = openCompressed();
+		string theText;
+		string theLine;
+		while (theFile->readLine(theLine))
+		{
+			theText += theLine + '\n';
+		}
+		return theText;
+	}
+	if (m_IsArchived)
+	{
+		return string(m_Begin, m_End);
+	}
+	boost::filesystem::ifstream theFile(m_FilePath);
+	if (!theFile.is_open())
+	{
+		throw runtime_error("Could not open file '" + m_FilePath.string() + "' for reading.");
+	}
+	std::ostringstream theText;
+	theText << theFile.rdbuf();
+	return theText.str();
+}
+
+const string AnnotationFile::hashContents() const
+{
+	ResultStore::ContentHash theHash;
+	if (m_IsArchived)
+	{
+		theHash.add(m_Begin, m_End);
+		return theHash.str();
+	}
+	boost::filesystem::ifstream theFile(m_FilePath, std::ios::binary);
+	if (!theFile.is_open())
+	{
+		throw runtime_error("Could not open file '" + m_FilePath.string() + "' for reading.");
+	}
+	std::vector<char> theBuffer(1 << 16);
+	while (theFile.read(&theBuffer[0], theBuffer.size()) || theFile.gcount() > 0)
+	{
+		theHash.add(&theBuffer[0], &theBuffer[0] + theFile.gcount());
+	}
+	return theHash.str();
+}
@@ -0,0 +1,98 @@
+#ifndef AnnotationFile_h
+#define AnnotationFile_h
+
+//============================================================================
+/**
+	Class representing an annotation file that lies either on disk or in one
+	of the tar archives given instead of a directory, and that can be
+	compressed.
+
+	@author		agent
+	@date		20261017
+*/
+//============================================================================
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/shared_ptr.hpp>
+#include "MusOO/TimedLabel.h"
+#include "TarArchive.h"
+#include "MappedLabFile.h"
+#include "CompressedLabFile.h"
+
+class AnnotationFile
+{
+public:
+
+	typedef std::vector<boost::shared_ptr<const TarArchive> > Archives;
+
+	/** Constructor. Looks inFilePath up in inArchives first and on disk
+		otherwise. */
+	AnnotationFile(const boost::filesystem::path& inFilePath, const Archives& inArchives);
+
+	/** Destructor. Removes the file again if it has been extracted. */
+	virtual ~AnnotationFile();
+
+	/** Whether inFilePath is a regular file or lies in one of inArchives,
+		without opening it. */
+	static bool exists(const boost::filesystem::path& inFilePath, const Archives& inArchives);
+
+	bool isCompressed() const;
+
+	/** Whether the file can be read by MappedLabFile or CompressedLabFile
+		instead of the general readers. The general readers cannot read
+		compressed files, so those are always tried in the lab format. */
+	bool isLabFile(const std::string& inFormat) const;
+
+	template <typename P, typename T>
+	bool readSegments(std::vector<MusOO::TimedLabel<T> >& outSequence) const;
+
+	/** Opens a compressed file for decompressing it line by line. */
+	const boost::shared_ptr<CompressedLabFile> openCompressed() const;
+
+	/** Path the general readers can open. A file in an archive is extracted
+		under its own name into a temporary directory, which is removed again
+		together with this object. Throws for a compressed file, which only
+		the readers of this class can decompress. */
+	const boost::filesystem::path& getPath();
+
+	/** Size of the file in bytes, zero if it does not exist. */
+	const boost::uintmax_t getSize() const;
+
+	/** Reads the whole file as text. */
+	const std::string readText();
+
+	/** Hash of the contents of the file as it is stored, to find out whether
+		it has changed since an earlier run. */
+	const std::string hashContents() const;
+
+private:
+
+	AnnotationFile(const AnnotationFile&);
+	AnnotationFile& operator=(const AnnotationFile&);
+
+	const boost::filesystem::path m_FilePath;
+	bool m_IsArchived;
+	bool m_IsCompressed;
+	const char* m_Begin;
+	const char* m_End;
+	boost::filesystem::path m_ExtractedDir;
+	boost::filesystem::path m_ExtractedPath;
+};
+
+template <typename P, typename T>
+bool AnnotationFile::readSegments(std::vector<MusOO::TimedLabel<T> >& outSequence) const
+{
+	if (m_IsCompressed)
+	{
+		return openCompressed()->readSegments<P>(outSequence);
+	}
+	if (m_IsArchived)
+	{
+		return MappedLabFile(m_Begin, m_End).readSegments<P>(outSequence);
+	}
+	return MappedLabFile(m_FilePath).readSegments<P>(outSequence);
+}
+
+#endif	// #ifndef AnnotationFile_h
@@ -8,197 +8,249 @@
 //============================================================================
 
 // Includes
+#include <algorithm>
+#include <boost/thread/locks.hpp>
 #include "ChordEvaluationStats.h"
 
+std::map<ChordEvaluationStats::ChordPairTablesKey, boost::shared_ptr<const ChordEvaluationStats::ChordPairTables> > ChordEvaluationStats::s_ChordPairTables;
+boost::mutex ChordEvaluationStats::s_ChordPairTablesMutex;
+
 ChordEvaluationStats::ChordEvaluationStats(const Eigen::ArrayXXd& inConfusionMatrix,
-                                           const std::vector<MusOO::Chord> inChords,
+                                           const std::vector<MusOO::Chord>& inChords,
 										   const Eigen::ArrayXXd::Index inNumOfChromas /*= 12*/)
-: m_ConfusionMatrix(inConfusionMatrix), m_NumOfChromas(inNumOfChromas), 
-m_NumOfChordTypes(inConfusionMatrix.rows()/inNumOfChromas),
+: m_NumOfChromas(inNumOfChromas), m_NumOfChordTypes(inConfusionMatrix.rows()/inNumOfChromas),
 m_NumOfChords(m_NumOfChordTypes * m_NumOfChromas),
-m_OnlyRoots(Eigen::ArrayXd::Zero(inNumOfChromas)), m_OnlyTypes(Eigen::ArrayXd::Zero(m_NumOfChordTypes)),
-m_ChordsMatrix(m_ConfusionMatrix.topLeftCorner(m_NumOfChords,m_NumOfChords)),
-m_HasTestCatchAllChords(inConfusionMatrix.cols() > m_NumOfChords+1),
-m_HasRefNoChord(inConfusionMatrix.rows() > m_NumOfChords),
-m_CardinalityDiff(m_NumOfChords, m_NumOfChords),
-m_NumOfWrongChromas(m_NumOfChords, m_NumOfChords)
-{
-    for (Eigen::ArrayXXd::Index iTestChord = 0; iTestChord < m_NumOfChords; ++iTestChord)
+m_ChordPairTables(getChordPairTables(inChords, m_NumOfChords)),
+m_CorrectChords(0.), m_CorrectNoChords(0.), m_ChordDeletions(0.), m_ChordInsertions(0.), m_ChordSubstitutions(0.),
+m_UnknownWrong(0.), m_OnlyRootCorrect(0.), m_OnlyTypeCorrect(0.), m_BothRootAndTypeWrong(0.), m_RefChordsDuration(0.), m_RefNoChordsDuration(0.),
+m_NumOfUniquesInRef(0), m_NumOfUniquesInTest(0), m_CorrectChordsPerType(Eigen::ArrayXXd::Zero(m_NumOfChordTypes, 2))
+{
+    std::vector<bool> theRefChordsPresent(m_NumOfChords, false);
+    std::vector<bool> theTestChordsPresent(inConfusionMatrix.cols(), false);
+    for (Eigen::ArrayXXd::Index iTestChord = 0; iTestChord < inConfusionMatrix.cols(); ++iTestChord)
     {
-        for (Eigen::ArrayXXd::Index iRefChord = 0; iRefChord < m_NumOfChords; ++iRefChord)
+        for (Eigen::ArrayXXd::Index iRefChord = 0; iRefChord < inConfusionMatrix.rows(); ++iRefChord)
         {
-            m_CardinalityDiff(iRefChord, iTestChord) = inChords[iTestChord].cardinality() - inChords[iRefChord].cardinality();
-            m_NumOfWrongChromas(iRefChord, iTestChord) = std::max(inChords[iRefChord].cardinality(), inChords[iTestChord].cardinality()) - inChords[iRefChord].commonChromas(inChords[iTestChord]).size();
+            if (inConfusionMatrix(iRefChord, iTestChord) != 0.)
+            {
+                addEntry(iRefChord, iTestChord, inConfusionMatrix(iRefChord, iTestChord), theRefChordsPresent, theTestChordsPresent);
+            }
         }
     }
-	for (int i = 0; i < m_NumOfChromas; ++i)
-	{
-		const Eigen::Block<const Eigen::ArrayXXd> theRootBlock =
-			m_ChordsMatrix.block(i*m_NumOfChordTypes, i*m_NumOfChordTypes, m_NumOfChordTypes, m_NumOfChordTypes);
-		m_OnlyRoots[i] = theRootBlock.sum() - theRootBlock.matrix().trace();
-        if (m_HasTestCatchAllChords)
+    m_NumOfUniquesInRef = std::count(theRefChordsPresent.begin(), theRefChordsPresent.end(), true);
+    m_NumOfUniquesInTest = std::count(theTestChordsPresent.begin(), theTestChordsPresent.end(), true);
+}
+
+ChordEvaluationStats::ChordEvaluationStats(const Eigen::SparseMatrix<double>& inConfusionMatrix,
+                                           const std::vector<MusOO::Chord>& inChords,
+										   const Eigen::ArrayXXd::Index inNumOfChromas /*= 12*/)
+: m_NumOfChromas(inNumOfChromas), m_NumOfChordTypes(inConfusionMatrix.rows()/inNumOfChromas),
+m_NumOfChords(m_NumOfChordTypes * m_NumOfChromas),
+m_ChordPairTables(getChordPairTables(inChords, m_NumOfChords)),
+m_CorrectChords(0.), m_CorrectNoChords(0.), m_ChordDeletions(0.), m_ChordInsertions(0.), m_ChordSubstitutions(0.),
+m_UnknownWrong(0.), m_OnlyRootCorrect(0.), m_OnlyTypeCorrect(0.), m_BothRootAndTypeWrong(0.), m_RefChordsDuration(0.), m_RefNoChordsDuration(0.),
+m_NumOfUniquesInRef(0), m_NumOfUniquesInTest(0), m_CorrectChordsPerType(Eigen::ArrayXXd::Zero(m_NumOfChordTypes, 2))
+{
+    std::vector<bool> theRefChordsPresent(m_NumOfChords, false);
+    std::vector<bool> theTestChordsPresent(inConfusionMatrix.cols(), false);
+    for (Eigen::ArrayXXd::Index iTestChord = 0; iTestChord < inConfusionMatrix.outerSize(); ++iTestChord)
+    {
+        for (Eigen::SparseMatrix<double>::InnerIterator theEntry(inConfusionMatrix, iTestChord); theEntry; ++theEntry)
         {
-            m_OnlyRoots[i] += m_ConfusionMatrix.col(m_NumOfChords+1+i).segment(i*m_NumOfChordTypes, m_NumOfChordTypes).sum();
+            addEntry(theEntry.row(), iTestChord, theEntry.value(), theRefChordsPresent, theTestChordsPresent);
         }
-	}
-	for (Eigen::ArrayXXd::Index i = 0; i < m_NumOfChordTypes; ++i)
-	{
-		for (Eigen::ArrayXXd::Index j = 0; j < m_NumOfChromas; ++j)
-		{
-			for (Eigen::ArrayXXd::Index k = 0; k < m_NumOfChromas; ++k)
-			{
-				if (j != k)
-				{
-					m_OnlyTypes[i] += m_ChordsMatrix(j*m_NumOfChordTypes+i, k*m_NumOfChordTypes+i);
-				}
-			}
-		}
-	}
+    }
+    m_NumOfUniquesInRef = std::count(theRefChordsPresent.begin(), theRefChordsPresent.end(), true);
+    m_NumOfUniquesInTest = std::count(theTestChordsPresent.begin(), theTestChordsPresent.end(), true);
 }
 
 ChordEvaluationStats::~ChordEvaluationStats()
 {
 }
 
-const double ChordEvaluationStats::getCorrectChords() const
+void ChordEvaluationStats::addEntry(const Eigen::ArrayXXd::Index inRefChord, const Eigen::ArrayXXd::Index inTestChord, const double inDuration, std::vector<bool>& ioRefChordsPresent, std::vector<bool>& ioTestChordsPresent)
 {
-	return m_ChordsMatrix.matrix().trace();
+    // The confusion matrix consists of the chords, followed by a no-chord row and column, and optionally
+    // followed by a catch-all column per root for test chords outside of the mapped set
+    if (inRefChord < m_NumOfChords)
+    {
+        const Eigen::ArrayXXd::Index theRefRoot = inRefChord / m_NumOfChordTypes;
+        const Eigen::ArrayXXd::Index theRefType = inRefChord % m_NumOfChordTypes;
+        m_RefChordsDuration += inDuration;
+        m_CorrectChordsPerType(theRefType,1) += inDuration;
+        if (inTestChord < m_NumOfChords)
+        {
+            const Eigen::ArrayXXd::Index theTestRoot = inTestChord / m_NumOfChordTypes;
+            const Eigen::ArrayXXd::Index theTestType = inTestChord % m_NumOfChordTypes;
+            if (inRefChord == inTestChord)
+            {
+                m_CorrectChords += inDuration;
+                m_CorrectChordsPerType(theRefType,0) += inDuration;
+            }
+            else
+            {
+                m_ChordSubstitutions += inDuration;
+                if (theRefRoot == theTestRoot)
+                {
+                    m_OnlyRootCorrect += inDuration;
+                }
+                else if (theRefType == theTestType)
+                {
+                    m_OnlyTypeCorrect += inDuration;
+                }
+                else
+                {
+                    m_BothRootAndTypeWrong += inDuration;
+                }
+            }
+            const int theNumOfWrongChromas = m_ChordPairTables->numOfWrongChromas(inRefChord, inTestChord);
+            m_ChordsPerWrongChromas[theNumOfWrongChromas] += inDuration;
+            m_ChordsPerWrongChromasAndCardinalityDiff[std::make_pair(theNumOfWrongChromas, m_ChordPairTables->cardinalityDiff(inRefChord, inTestChord))] += inDuration;
+        }
+        else if (inTestChord == m_NumOfChords)
+        {
+            m_ChordDeletions += inDuration;
+        }
+        else
+        {
+            m_UnknownWrong += inDuration;
+            m_ChordSubstitutions += inDuration;
+            if (inTestChord - m_NumOfChords - 1 == theRefRoot)
+            {
+                m_OnlyRootCorrect += inDuration;
+            }
+            else
+            {
+                m_BothRootAndTypeWrong += inDuration;
+            }
+        }
+        if (inDuration > 0. && inTestChord != m_NumOfChords)
+        {
+            ioRefChordsPresent[inRefChord] = true;
+            ioTestChordsPresent[inTestChord] = true;
+        }
+    }
+    else
+    {
+        m_RefNoChordsDuration += inDuration;
+        if (inTestChord == m_NumOfChords)
+        {
+            m_CorrectNoChords += inDuration;
+        }
+        else
+        {
+            m_ChordInsertions += inDuration;
+        }
+    }
 }
 
-const double ChordEvaluationStats::getCorrectNoChords() const
+boost::shared_ptr<const ChordEvaluationStats::ChordPairTables> ChordEvaluationStats::getChordPairTables(const std::vector<MusOO::Chord>& inChords, const Eigen::ArrayXXd::Index inNumOfChords)
 {
-	if (m_HasRefNoChord)
+    ChordPairTablesKey theKey;
+    theKey.reserve(inNumOfChords);
+    for (Eigen::ArrayXXd::Index iChord = 0; iChord < inNumOfChords; ++iChord)
     {
-        return m_ConfusionMatrix(m_NumOfChords, m_NumOfChords);
+        theKey.push_back(std::make_pair(inChords[iChord].root(), inChords[iChord].type()));
     }
-    else
+    
+    boost::lock_guard<boost::mutex> theLock(s_ChordPairTablesMutex);
+    boost::shared_ptr<const ChordPairTables>& theTables = s_ChordPairTables[theKey];
+    if (!theTables)
     {
-        return 0.;
+        boost::shared_ptr<ChordPairTables> theNewTables(new ChordPairTables());
+        theNewTables->cardinalityDiff.resize(inNumOfChords, inNumOfChords);
+        theNewTables->numOfWrongChromas.resize(inNumOfChords, inNumOfChords);
+        for (Eigen::ArrayXXd::Index iTestChord = 0; iTestChord < inNumOfChords; ++iTestChord)
+        {
+            for (Eigen::ArrayXXd::Index iRefChord = 0; iRefChord < inNumOfChords; ++iRefChord)
+            {
+                theNewTables->cardinalityDiff(iRefChord, iTestChord) = inChords[iTestChord].cardinality() - inChords[iRefChord].cardinality();
+                theNewTables->numOfWrongChromas(iRefChord, iTestChord) = std::max(inChords[iRefChord].cardinality(), inChords[iTestChord].cardinality()) - inChords[iRefChord].commonChromas(inChords[iTestChord]).size();
+            }
+        }
+        theTables = theNewTables;
     }
+    return theTables;
+}
+
+const double ChordEvaluationStats::getCorrectChords() const
+{
+	return m_CorrectChords;
+}
+
+const double ChordEvaluationStats::getCorrectNoChords() const
+{
+    return m_CorrectNoChords;
 }
 
 const double ChordEvaluationStats::getChordDeletions() const
 {
-    return m_ConfusionMatrix.col(m_NumOfChords).head(m_NumOfChords).sum();
+    return m_ChordDeletions;
 }
 
 const double ChordEvaluationStats::getChordInsertions() const
 {
-    if (m_HasRefNoChord)
-    {
-        if (m_HasTestCatchAllChords)
-        {
-            return m_ConfusionMatrix.row(m_NumOfChords).head(m_NumOfChords).sum() +
-                m_ConfusionMatrix.row(m_NumOfChords).tail(m_NumOfChromas).sum();
-        }
-        else
-        {
-            return m_ConfusionMatrix.row(m_NumOfChords).head(m_NumOfChords).sum();
-        }
-    }
-    else
-    {
-        return 0.;
-    }
+    return m_ChordInsertions;
 }
 
 const double ChordEvaluationStats::getChordSubstitutions() const
 {
-	return m_ChordsMatrix.sum() - getCorrectChords() + getChordsWithUnknownWrong();
+	return m_ChordSubstitutions;
 }
 
 const Eigen::ArrayXXd::Index ChordEvaluationStats::getNumOfUniquesInRef() const
 {
-    if (m_HasTestCatchAllChords)
-    {
-        return ((m_ChordsMatrix > 0.).rowwise().any() ||
-            (m_ConfusionMatrix.block(0, m_NumOfChords+1, m_NumOfChords, m_NumOfChromas) > 0).rowwise().any()).count();
-    }
-    else
-    {
-        return (m_ChordsMatrix > 0.).rowwise().any().count();
-    }
+    return m_NumOfUniquesInRef;
 }
 
 const Eigen::ArrayXXd::Index ChordEvaluationStats::getNumOfUniquesInTest() const
 {
-    if (m_HasTestCatchAllChords)
-    {
-        return (m_ChordsMatrix > 0.).colwise().any().count() +
-            (m_ConfusionMatrix.block(0, m_NumOfChords+1, m_NumOfChords, m_NumOfChromas) > 0).colwise().any().count();
-    }
-    else
-    {
-        return (m_ChordsMatrix > 0.).colwise().any().count();
-    }
+    return m_NumOfUniquesInTest;
 }
 
 const double ChordEvaluationStats::getRefChordsDuration() const
 {
-	return m_ConfusionMatrix.topRows(m_NumOfChords).sum();
+	return m_RefChordsDuration;
 }
 
 const double ChordEvaluationStats::getRefNoChordsDuration() const
 {
-    if (m_HasRefNoChord)
-    {
-        return m_ConfusionMatrix.bottomRows<1>().sum();
-    }
-    else
-    {
-        return 0.;
-    }
+    return m_RefNoChordsDuration;
 }
 
 const double ChordEvaluationStats::getOnlyRootCorrect() const
 {
-	return m_OnlyRoots.sum();
+	return m_OnlyRootCorrect;
 }
 
 const double ChordEvaluationStats::getOnlyTypeCorrect() const
 {
-	return m_OnlyTypes.sum();
+	return m_OnlyTypeCorrect;
 }
 
 const double ChordEvaluationStats::getBothRootAndTypeWrong() const
 {
-	return getChordSubstitutions() - m_OnlyRoots.sum() - m_OnlyTypes.sum();
+	return m_BothRootAndTypeWrong;
 }
 
 const Eigen::ArrayXXd ChordEvaluationStats::getCorrectChordsPerType() const
 {
-    Eigen::ArrayXXd outCorrectChordsPerType = Eigen::ArrayXXd::Zero(m_NumOfChordTypes, 2);
-    for (Eigen::ArrayXXd::Index iChordType = 0; iChordType < m_NumOfChordTypes; ++iChordType)
-    {
-        for (Eigen::ArrayXXd::Index iChroma = 0; iChroma < m_NumOfChromas; ++iChroma)
-        {
-            // Correct chords per type
-            outCorrectChordsPerType(iChordType,0) += m_ConfusionMatrix(iChroma*m_NumOfChordTypes+iChordType, iChroma*m_NumOfChordTypes+iChordType);
-            // Total duration per type
-            outCorrectChordsPerType(iChordType,1) += m_ConfusionMatrix.row(iChroma*m_NumOfChordTypes+iChordType).sum();
-        }
-    }
-    return outCorrectChordsPerType;
+    return m_CorrectChordsPerType;
 }
 
 const double ChordEvaluationStats::getChordsWithNWrong(const Eigen::ArrayXXd::Index inNumOfWrongChromas) const
 {
-    return (m_NumOfWrongChromas == inNumOfWrongChromas).select(m_ChordsMatrix, 0.).sum();
+    std::map<int, double>::const_iterator theDuration = m_ChordsPerWrongChromas.find(static_cast<int>(inNumOfWrongChromas));
+    return theDuration != m_ChordsPerWrongChromas.end() ? theDuration->second : 0.;
 }
 
 const double ChordEvaluationStats::getChordsWithSDI(const Eigen::ArrayXXd::Index inNumOfSubstitutedChromas, const Eigen::ArrayXXd::Index inNumOfDeletedChromas, const Eigen::ArrayXXd::Index inNumOfInsertedChromas) const
 {
-    return (m_NumOfWrongChromas == inNumOfSubstitutedChromas && m_CardinalityDiff == inNumOfInsertedChromas-inNumOfDeletedChromas).select(m_ChordsMatrix, 0.).sum();
+    std::map<std::pair<int, int>, double>::const_iterator theDuration = m_ChordsPerWrongChromasAndCardinalityDiff.find(std::make_pair(static_cast<int>(inNumOfSubstitutedChromas), static_cast<int>(inNumOfInsertedChromas-inNumOfDeletedChromas)));
+    return theDuration != m_ChordsPerWrongChromasAndCardinalityDiff.end() ? theDuration->second : 0.;
 }
 
 const double ChordEvaluationStats::getChordsWithUnknownWrong() const
 {
-    if (m_HasTestCatchAllChords)
-    {
-        return m_ConfusionMatrix.topRightCorner(m_NumOfChords, m_NumOfChromas).sum();
-    }
-    else
-    {
-        return 0.;
-    }
+    return m_UnknownWrong;
 }
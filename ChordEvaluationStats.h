@@ -10,15 +10,24 @@
 */
 //============================================================================
 #include <vector>
+#include <map>
+#include <utility>
 #include <Eigen/Core>
+#include <Eigen/SparseCore>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 #include "MusOO/Chord.h"
 
 class ChordEvaluationStats
 {
 public:
 
-	/** Default constructor. */
-	ChordEvaluationStats(const Eigen::ArrayXXd& inConfusionMatrix, const std::vector<MusOO::Chord> inChords, const Eigen::ArrayXXd::Index inNumOfChromas = 12);
+	/** Default constructor. All statistics are reduced in a single pass over
+		the confusion matrix, such that the getters only read the results. */
+	ChordEvaluationStats(const Eigen::ArrayXXd& inConfusionMatrix, const std::vector<MusOO::Chord>& inChords, const Eigen::ArrayXXd::Index inNumOfChromas = 12);
+	/** Constructor for a sparse confusion matrix, which is read without
+		densifying it. */
+	ChordEvaluationStats(const Eigen::SparseMatrix<double>& inConfusionMatrix, const std::vector<MusOO::Chord>& inChords, const Eigen::ArrayXXd::Index inNumOfChromas = 12);
 
 	/** Destructor. */
 	virtual ~ChordEvaluationStats();
@@ -49,20 +58,44 @@ protected:
 
 private:
 
-	const Eigen::ArrayXXd m_ConfusionMatrix;
+	/** Cardinality difference and number of wrong chromas for every pair of
+		chords in a label list. These only depend on the labels, so they are
+		computed once per label list and shared by all instances. */
+	struct ChordPairTables
+	{
+		Eigen::ArrayXXi cardinalityDiff;
+		Eigen::ArrayXXi numOfWrongChromas;
+	};
+	typedef std::vector<std::pair<MusOO::Chroma, MusOO::ChordType> > ChordPairTablesKey;
+	static boost::shared_ptr<const ChordPairTables> getChordPairTables(const std::vector<MusOO::Chord>& inChords, const Eigen::ArrayXXd::Index inNumOfChords);
+	// Filled by all evaluating threads, so only accessed while holding the mutex
+	static std::map<ChordPairTablesKey, boost::shared_ptr<const ChordPairTables> > s_ChordPairTables;
+	static boost::mutex s_ChordPairTablesMutex;
+
+	void addEntry(const Eigen::ArrayXXd::Index inRefChord, const Eigen::ArrayXXd::Index inTestChord, const double inDuration, std::vector<bool>& ioRefChordsPresent, std::vector<bool>& ioTestChordsPresent);
+
 	const Eigen::ArrayXXd::Index m_NumOfChromas;
 	const Eigen::ArrayXXd::Index m_NumOfChordTypes;
 	const Eigen::ArrayXXd::Index m_NumOfChords;
+    const boost::shared_ptr<const ChordPairTables> m_ChordPairTables;
 
-	Eigen::ArrayXd m_OnlyRoots;
-	Eigen::ArrayXd m_OnlyTypes;
-    const Eigen::ArrayXXd m_ChordsMatrix;
-    
-    const bool m_HasTestCatchAllChords;
-    const bool m_HasRefNoChord;
-    
-    Eigen::ArrayXXi m_CardinalityDiff;
-    Eigen::ArrayXXi m_NumOfWrongChromas;
+    // Reductions of the confusion matrix, all filled in a single pass
+    double m_CorrectChords;
+    double m_CorrectNoChords;
+    double m_ChordDeletions;
+    double m_ChordInsertions;
+    double m_ChordSubstitutions;
+    double m_UnknownWrong;
+    double m_OnlyRootCorrect;
+    double m_OnlyTypeCorrect;
+    double m_BothRootAndTypeWrong;
+    double m_RefChordsDuration;
+    double m_RefNoChordsDuration;
+    Eigen::ArrayXXd::Index m_NumOfUniquesInRef;
+    Eigen::ArrayXXd::Index m_NumOfUniquesInTest;
+    Eigen::ArrayXXd m_CorrectChordsPerType;
+    std::map<int, double> m_ChordsPerWrongChromas;
+    std::map<std::pair<int, int>, double> m_ChordsPerWrongChromasAndCardinalityDiff;
 };
 
 #endif	// #ifndef ChordEvaluationStats_h
@@ -0,0 +1,136 @@
+//============================================================================
+/**
+	Implementation file for CompressedLabFile.h
+
+	@author		agent
+	@date		20261016
+*/
+//============================================================================
+
+// Includes
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+#include <boost/version.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#if BOOST_VERSION >= 107000
+#include <boost/iostreams/filter/zstd.hpp>
+#endif
+#include "CompressedLabFile.h"
+
+using std::string;
+using boost::filesystem::path;
+
+namespace
+{
+	const size_t s_MagicSize = 4;
+	const unsigned char s_GzipMagic[] = {0x1f, 0x8b};
+	const unsigned char s_ZstdMagic[] = {0x28, 0xb5, 0x2f, 0xfd};
+
+	bool startsWith(const char* inBegin, const size_t inSize, const unsigned char* inMagic, const size_t inMagicSize)
+	{
+		return inSize >= inMagicSize && std::memcmp(inBegin, inMagic, inMagicSize) == 0;
+	}
+}
+
+bool CompressedLabFile::isCompressed(const char* inBegin, const char* inEnd)
+{
+	const size_t theSize = inEnd - inBegin;
+	return startsWith(inBegin, theSize, s_GzipMagic, sizeof(s_GzipMagic)) || startsWith(inBegin, theSize, s_ZstdMagic, sizeof(s_ZstdMagic));
+}
+
+bool CompressedLabFile::isCompressed(const path& inFilePath)
+{
+	boost::filesystem::ifstream theFile(inFilePath, std::ios::binary);
+	char theMagic[s_MagicSize];
+	theFile.read(theMagic, s_MagicSize);
+	return isCompressed(theMagic, theMagic + theFile.gcount());
+}
+
+CompressedLabFile::CompressedLabFile(const path& inFilePath)
+: m_Name(inFilePath.string()), m_File(inFilePath, std::ios::binary)
+{
+	if (!m_File.is_open())
+	{
+		throw std::runtime_error("Could not open file '" + m_Name + "' for reading");
+	}
+	char theMagic[s_MagicSize];
+	m_File.read(theMagic, s_MagicSize);
+	const size_t theMagicSize = m_File.gcount();
+	m_File.clear();
+	m_File.seekg(0);
+	open(theMagic, theMagicSize);
+	m_Stream.push(m_File);
+}
+
+CompressedLabFile::CompressedLabFile(const char* inBegin, const char* inEnd, const string& inName)
+: m_Name(inName)
+{
+	open(inBegin, inEnd - inBegin);
+	m_Stream.push(boost::iostreams::array_source(inBegin, inEnd));
+}
+
+CompressedLabFile::~CompressedLabFile()
+{
+}
+
+bool CompressedLabFile::readLine(string& outLine)
+{
+	typedef std::char_traits<char> Traits;
+	outLine.clear();
+	try
+	{
+		std::streambuf* theBuffer = m_Stream.rdbuf();
+		Traits::int_type theChar = theBuffer->sbumpc();
+		if (Traits::eq_int_type(theChar, Traits::eof()))
+		{
+			return false;
+		}
+		while (!Traits::eq_int_type(theChar, Traits::eof()) && theChar != '\n' && theChar != '\r')
+		{
+			outLine += Traits::to_char_type(theChar);
+			theChar = theBuffer->sbumpc();
+		}
+		if (theChar == '\r' && theBuffer->sgetc() == '\n')
+		{
+			theBuffer->sbumpc();
+		}
+	}
+	catch (std::exception&)
+	{
+		throw std::runtime_error("Could not decompress file '" + m_Name + "'");
+	}
+	return true;
+}
+
+void CompressedLabFile::open(const char* inMagic, const size_t inSize)
+{
+	if (startsWith(inMagic, inSize, s_GzipMagic, sizeof(s_GzipMagic)))
+	{
+		m_Stream.push(boost::iostreams::gzip_decompressor());
+	}
+	else if (startsWith(inMagic, inSize, s_ZstdMagic, sizeof(s_ZstdMagic)))
+	{
+#if BOOST_VERSION >= 107000
+		m_Stream.push(boost::iostreams::zstd_decompressor());
+#else
+		throw std::runtime_error("Reading the zstd-compressed file '" + m_Name + "' requires boost 1.70 or later");
+#endif
+	}
+	else
+	{
+		throw std::runtime_error("'" + m_Name + "' is not compressed with gzip or zstd");
+	}
+}
+
+bool CompressedLabFile::isBlankLine(const string& inLine)
+{
+	return inLine.find_first_not_of(" \t") == string::npos;
+}
+
+bool CompressedLabFile::isColumnNamesLine(const string& inLine)
+{
+	const size_t theFirstChar = inLine.find_first_not_of(" \t");
+	return theFirstChar != string::npos && std::isalpha(static_cast<unsigned char>(inLine[theFirstChar]));
+}
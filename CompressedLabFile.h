@@ -0,0 +1,102 @@
+#ifndef CompressedLabFile_h
+#define CompressedLabFile_h
+
+//============================================================================
+/**
+	Class representing a gzip- or zstd-compressed text file, which is
+	decompressed while it is read, line by line, such that neither a
+	temporary file nor a decompressed copy of the whole file is needed.
+	Line endings can be "\n", "\r\n" or "\r".
+
+	Segment files in the three-column "onset offset label" layout are read
+	in the same way as by MappedLabFile.
+
+	@author		agent
+	@date		20261016
+*/
+//============================================================================
+#include <string>
+#include <vector>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/unordered_map.hpp>
+#include "MusOO/TimedLabel.h"
+#include "MappedLabFile.h"
+
+class CompressedLabFile
+{
+public:
+
+	/** Whether the data in [inBegin, inEnd) starts with the magic bytes of a
+		gzip or zstd stream. */
+	static bool isCompressed(const char* inBegin, const char* inEnd);
+	/** Whether the file at inFilePath starts with the magic bytes of a gzip
+		or zstd stream. Returns false if it cannot be read. */
+	static bool isCompressed(const boost::filesystem::path& inFilePath);
+
+	/** Constructor. Opens the compressed file at inFilePath. Throws if it
+		cannot be opened or is not compressed. */
+	CompressedLabFile(const boost::filesystem::path& inFilePath);
+
+	/** Constructor. Reads the compressed data in [inBegin, inEnd), which
+		needs to outlive the object. inName identifies it in errors. */
+	CompressedLabFile(const char* inBegin, const char* inEnd, const std::string& inName);
+
+	/** Destructor. */
+	virtual ~CompressedLabFile();
+
+	/** Decompresses the next line into outLine, without line ending. Returns
+		false at the end of the file. Throws if the data is corrupt. */
+	bool readLine(std::string& outLine);
+
+	/** Fills outSequence with a segment per remaining line, of which the
+		label is parsed from its text by P. Returns false if any line does
+		not consist of exactly two numbers and a label, apart from blank
+		lines at the end of the file and, if inMayHaveColumnNames, a first
+		line that starts with a letter. */
+	template <typename P, typename T>
+	bool readSegments(std::vector<MusOO::TimedLabel<T> >& outSequence, const bool inMayHaveColumnNames = false);
+
+private:
+
+	CompressedLabFile(const CompressedLabFile&);
+	CompressedLabFile& operator=(const CompressedLabFile&);
+
+	void open(const char* inMagic, const size_t inSize);
+	static bool isBlankLine(const std::string& inLine);
+	static bool isColumnNamesLine(const std::string& inLine);
+
+	const std::string m_Name;
+	boost::filesystem::ifstream m_File;
+	boost::iostreams::filtering_istream m_Stream;
+};
+
+template <typename P, typename T>
+bool CompressedLabFile::readSegments(std::vector<MusOO::TimedLabel<T> >& outSequence, const bool inMayHaveColumnNames /*= false*/)
+{
+	outSequence.clear();
+	boost::unordered_map<std::string, const T*> theLabels;
+	std::string theLine;
+	bool theIsAtBlankEnd = false;
+	bool theIsFirstLine = true;
+	while (readLine(theLine))
+	{
+		if (theIsFirstLine && inMayHaveColumnNames && isColumnNamesLine(theLine))
+		{
+			// Skipped
+		}
+		else if (isBlankLine(theLine))
+		{
+			theIsAtBlankEnd = true;
+		}
+		else if (theIsAtBlankEnd || MappedLabFile::scanSegments<P>(theLine.data(), theLine.data() + theLine.size(), theLabels, outSequence) != MappedLabFile::FoundSegment)
+		{
+			return false;
+		}
+		theIsFirstLine = false;
+	}
+	return true;
+}
+
+#endif	// #ifndef CompressedLabFile_h
@@ -0,0 +1,451 @@
+//============================================================================
+/**
+	Implementation file for EvaluationJobs.h
+
+	@author		agent
+	@date		20261017
+*/
+//============================================================================
+
+// Includes
+#include <functional>
+#include <utility>
+#include "MusOO/KeyQMUL.h"
+#include "MusOO/ChordQMUL.h"
+#include "MusOOFile/KeyFileUtil.h"
+#include "MusOOFile/ChordFileUtil.h"
+#include "MusOOFile/NoteFileMaps.h"
+#include "EvaluationJobs.h"
+#include "KeyEvaluationStats.h"
+#include "ChordEvaluationStats.h"
+#include "NoteEvaluationStats.h"
+#include "SimilarityScoreKey.h"
+#include "NoteText.h"
+
+using std::string;
+using std::vector;
+using std::endl;
+using std::runtime_error;
+using boost::filesystem::path;
+using namespace MusOO;
+
+namespace
+{
+	Key findLongestKey(TimedKeySequence inKeySequence)
+	{
+		vector<std::pair<Key,double> > theUniqueKeys;
+		//	std::unordered_map<Key,double> theUniqueKeys;
+		for (TimedKeySequence::const_iterator i = inKeySequence.begin(); i != inKeySequence.end(); ++i)
+		{
+			//		theUniqueKeys[i->label()] += i->offset()-i->onset();
+			bool theKeyFound = false;
+			for (size_t j = 0; j < theUniqueKeys.size(); ++j)
+			{
+				if (i->label() == theUniqueKeys[j].first)
+				{
+					theUniqueKeys[j].second += i->offset()-i->onset();
+					theKeyFound = true;
+				}
+			}
+			if (!theKeyFound)
+			{
+				theUniqueKeys.push_back(std::pair<Key,double>(i->label(), i->offset()-i->onset()));
+			}
+		}
+		Key theLongestKey = theUniqueKeys.front().first;
+		double theDuration = theUniqueKeys.front().second;
+		for (size_t j = 1; j < theUniqueKeys.size(); ++j)
+		{
+			if (theUniqueKeys[j].second > theDuration)
+			{
+				theLongestKey = theUniqueKeys[j].first;
+				theDuration = theUniqueKeys[j].second;
+			}
+		}
+		return theLongestKey;
+	}
+
+	const vector<TimedLabel<string> > readSegmentSequence(const path& inFilePath, const EvaluationSettings& inSettings)
+	{
+		vector<TimedLabel<string> > theSequence;
+		AnnotationFile theFile(inFilePath, inSettings.archives);
+		if (!theFile.isLabFile("auto") || !theFile.readSegments<string>(theSequence))
+		{
+			theSequence = LabFile<string>(theFile.getPath().string(), true).readAll();
+		}
+		return theSequence;
+	}
+}
+
+void readTiming(const ListItem& inItem, const EvaluationSettings& inSettings, double& outBegin, double& outEnd)
+{
+	outBegin = inItem.begin;
+	outEnd = inItem.end;
+	if (!inItem.timingPath.empty())
+	{
+		std::istringstream theTimingFile(AnnotationFile(inItem.timingPath, inSettings.archives).readText());
+		theTimingFile >> outBegin >> outEnd;
+	}
+}
+
+void parseLabelSequence(const path& inFilePath, const bool inIsReference, const EvaluationSettings& inSettings, TimedKeySequence& outSequence)
+{
+	const string& theFormat = inIsReference ? inSettings.refFormat : inSettings.testFormat;
+	AnnotationFile theFile(inFilePath, inSettings.archives);
+	if (!theFile.isLabFile(theFormat) || !theFile.readSegments<KeyQMUL>(outSequence))
+	{
+		outSequence = KeyFileUtil::readKeySequenceFromFile(theFile.getPath(), inIsReference, theFormat);
+	}
+}
+
+void parseLabelSequence(const path& inFilePath, const bool inIsReference, const EvaluationSettings& inSettings, TimedChordSequence& outSequence)
+{
+	const string& theFormat = inIsReference ? inSettings.refFormat : inSettings.testFormat;
+	AnnotationFile theFile(inFilePath, inSettings.archives);
+	if (!theFile.isLabFile(theFormat) || !theFile.readSegments<ChordQMUL>(outSequence))
+	{
+		outSequence = ChordFileUtil::readChordSequenceFromFile(theFile.getPath(), inIsReference, theFormat);
+	}
+}
+
+void parseLabelSequence(const path& inFilePath, const bool inIsReference, const EvaluationSettings& inSettings, NoteSequence& outSequence)
+{
+	AnnotationFile theFile(inFilePath, inSettings.archives);
+	if (theFile.isCompressed())
+	{
+		// MAPS files can start with a line naming the columns
+		if (!theFile.openCompressed()->readSegments<NoteText>(outSequence, true))
+		{
+			throw runtime_error("Could not read the compressed note file '" + inFilePath.string() + "'");
+		}
+		return;
+	}
+	NoteFileMaps theNoteFile(theFile.getPath().string());
+	outSequence = theNoteFile.readAll();
+}
+
+void calcCardinalityRange(const vector<Chord>& inLabels, const size_t inNumOfChordTypes, size_t& outMinCardinality, size_t& outMaxCardinality)
+{
+	vector<size_t> cardinalities(inNumOfChordTypes);
+	std::transform(inLabels.begin(), inLabels.begin()+inNumOfChordTypes, cardinalities.begin(), std::mem_fun_ref(&MusOO::Chord::cardinality));
+	outMaxCardinality = *std::max_element(cardinalities.begin(), cardinalities.end());
+	outMinCardinality = *std::min_element(cardinalities.begin(), cardinalities.end());
+}
+
+void writeBinary(std::ostream& inStream, const Eigen::ArrayXXd& inArray)
+{
+	writeBinary<boost::uint64_t>(inStream, inArray.rows());
+	writeBinary<boost::uint64_t>(inStream, inArray.cols());
+	inStream.write(reinterpret_cast<const char*>(inArray.data()), inArray.size() * sizeof(double));
+}
+
+void readBinary(std::istream& inStream, Eigen::ArrayXXd& outArray)
+{
+	boost::uint64_t theNumOfRows = 0;
+	boost::uint64_t theNumOfColumns = 0;
+	readBinary(inStream, theNumOfRows);
+	readBinary(inStream, theNumOfColumns);
+	outArray.resize(theNumOfRows, theNumOfColumns);
+	inStream.read(reinterpret_cast<char*>(outArray.data()), outArray.size() * sizeof(double));
+}
+
+ItemJob::ItemJob(const ListItem& inItem, const EvaluationSettings& inSettings)
+: m_Item(inItem), m_Settings(&inSettings), m_IsRestored(false)
+{
+}
+
+const string& ItemJob::getName() const
+{
+	return m_Item.name;
+}
+
+bool ItemJob::isRestored() const
+{
+	return m_IsRestored;
+}
+
+const string& ItemJob::getCSVRow() const
+{
+	return m_CSVRow;
+}
+
+void ItemJob::openVerboseStream(boost::filesystem::ofstream& outVerboseStream, const string& inSuffix /*= ""*/) const
+{
+	if (m_Settings->verbose)
+	{
+		path theVerbosePath = m_Settings->outputDir / path(m_Item.name + inSuffix + ".csv");
+		outVerboseStream.open(theVerbosePath);
+	}
+	else
+	{
+		// An unopened stream is still good until written to, and a good stream asks for verbose output
+		outVerboseStream.setstate(std::ios::badbit);
+	}
+}
+
+template <>
+const char* PairwiseJob<Key>::getStoreName()
+{
+	return "keys";
+}
+
+template <>
+const char* PairwiseJob<Chord>::getStoreName()
+{
+	return "chords";
+}
+
+template <>
+const char* PairwiseJob<Note>::getStoreName()
+{
+	return "notes";
+}
+
+template <>
+void PairwiseJob<Key>::printVerboseHeader(std::ostream& inVerboseStream) const
+{
+	const string& theCSVSeparator = m_Settings->csvSeparator;
+	inVerboseStream << "Start" << theCSVSeparator << "End" << theCSVSeparator << "RefLabel" << theCSVSeparator << "TestLabel" << theCSVSeparator << "Score" << theCSVSeparator << "Duration" << endl;
+}
+
+template <>
+void PairwiseJob<Key>::printCSVRow(std::ostream& inCSVStream, const PresetResult& inResult, const vector<Key>& inLabels) const
+{
+	const string& theCSVSeparator = m_Settings->csvSeparator;
+	const string& theCSVQuotes = m_Settings->csvQuotes;
+	KeyEvaluationStats theStats(inResult.confusionMatrix);
+	inCSVStream << theCSVQuotes << m_Item.name << theCSVQuotes << theCSVSeparator
+		<< 100*inResult.score << theCSVSeparator
+		<< inResult.duration << theCSVSeparator
+		<< theStats.getNumOfUniquesInRef() << theCSVSeparator
+		<< theStats.getNumOfUniquesInTest() << theCSVSeparator
+		<< theStats.getCorrectKeys() << theCSVSeparator
+		<< theStats.getAdjacentKeys() << theCSVSeparator
+		<< theStats.getRelativeKeys() << theCSVSeparator
+		<< theStats.getParallelKeys() << theCSVSeparator
+		<< theStats.getChromaticKeys() << "\n";
+}
+
+template <>
+void PairwiseJob<Chord>::printVerboseHeader(std::ostream& inVerboseStream) const
+{
+	const string& theCSVSeparator = m_Settings->csvSeparator;
+	inVerboseStream << "Start" << theCSVSeparator << "End" << theCSVSeparator << "RefLabel" << theCSVSeparator << "TestLabel" << theCSVSeparator << "Score" << theCSVSeparator << "Duration" << theCSVSeparator << "MappedRefLabel" << theCSVSeparator << "MappedTestLabel" << theCSVSeparator << "RefChromas" << theCSVSeparator << "TestChromas" << theCSVSeparator << "NumCommonChromas" << theCSVSeparator << "RefBass" << theCSVSeparator << "TestBass" << endl;
+}
+
+template <>
+void PairwiseJob<Chord>::printCSVRow(std::ostream& inCSVStream, const PresetResult& inResult, const vector<Chord>& inLabels) const
+{
+	const string& theCSVSeparator = m_Settings->csvSeparator;
+	const string& theCSVQuotes = m_Settings->csvQuotes;
+	const size_t numChordTypes = (inResult.isSparse ? inResult.sparseConfusionMatrix.rows() : inResult.confusionMatrix.rows())/12;
+	size_t minCardinality;
+	size_t maxCardinality;
+	calcCardinalityRange(inLabels, numChordTypes, minCardinality, maxCardinality);
+
+	inCSVStream << theCSVQuotes << m_Item.name << theCSVQuotes << theCSVSeparator;
+	const ChordEvaluationStats theStats = inResult.isSparse ? ChordEvaluationStats(inResult.sparseConfusionMatrix, inLabels) : ChordEvaluationStats(inResult.confusionMatrix, inLabels);
+	double theDuration = inResult.duration;
+	if (theDuration > 0.)
+	{
+		inCSVStream << 100*inResult.score << theCSVSeparator << theDuration;
+		inCSVStream
+			<< theCSVSeparator << 100*theStats.getCorrectChords()/theDuration
+			<< theCSVSeparator << 100*theStats.getChordSubstitutions()/theDuration
+			<< theCSVSeparator << 100*theStats.getChordDeletions()/theDuration
+			<< theCSVSeparator << 100*theStats.getChordInsertions()/theDuration
+			<< theCSVSeparator << 100*theStats.getCorrectNoChords()/theDuration;
+		const Eigen::ArrayXXd theResultsPerType = theStats.getCorrectChordsPerType();
+		for (Eigen::ArrayXXd::Index iChordType = 0; iChordType < theResultsPerType.rows(); ++iChordType)
+		{
+			inCSVStream
+				<< theCSVSeparator << 100*theResultsPerType(iChordType,0)/theResultsPerType(iChordType,1)
+				<< theCSVSeparator << 100*theResultsPerType(iChordType,1)/theDuration;
+		}
+		for (size_t iNumOfWrongChromas = 0; iNumOfWrongChromas <= maxCardinality; ++iNumOfWrongChromas)
+		{
+			inCSVStream << theCSVSeparator << 100*theStats.getChordsWithNWrong(iNumOfWrongChromas)/theDuration;
+		}
+		inCSVStream
+			<< theCSVSeparator << 100*theStats.getCorrectChords()/theDuration
+			<< theCSVSeparator << 100*theStats.getOnlyRootCorrect()/theDuration
+			<< theCSVSeparator<< 100*theStats.getOnlyTypeCorrect()/theDuration
+			<< theCSVSeparator << 100*theStats.getBothRootAndTypeWrong()/theDuration;
+	}
+	else
+	{
+		inCSVStream << "n/a" << theCSVSeparator << theDuration;
+		for (size_t i = 0; i < 9+2*numChordTypes+maxCardinality+1; ++i)
+		{
+			inCSVStream << theCSVSeparator << "n/a";
+		}
+	}
+	inCSVStream << theCSVSeparator << theStats.getNumOfUniquesInRef() << theCSVSeparator << theStats.getNumOfUniquesInTest() << "\n";
+}
+
+template <>
+void PairwiseJob<Note>::printVerboseHeader(std::ostream& inVerboseStream) const
+{
+}
+
+template <>
+void PairwiseJob<Note>::printCSVRow(std::ostream& inCSVStream, const PresetResult& inResult, const vector<Note>& inLabels) const
+{
+	const string& theCSVSeparator = m_Settings->csvSeparator;
+	const string& theCSVQuotes = m_Settings->csvQuotes;
+	NoteEvaluationStats theStats(inResult.confusionMatrix);
+	double theDuration = inResult.duration;
+	inCSVStream << theCSVQuotes << m_Item.name << theCSVQuotes << theCSVSeparator
+		<< 100*inResult.score << theCSVSeparator
+		<< theDuration << theCSVSeparator
+		<< 100*theStats.getCorrectNotes()/theDuration << theCSVSeparator
+		<< 100*theStats.getOctaveErrors()/theDuration << theCSVSeparator
+		<< 100*theStats.getFifthErrors()/theDuration << theCSVSeparator
+		<< 100*theStats.getChromaticUpErrors()/theDuration << theCSVSeparator
+		<< 100*theStats.getChromaticDownErrors()/theDuration
+		<< 100*theStats.getCorrectNoNotes()/theDuration << theCSVSeparator
+		<< 100*theStats.getNoteDeletions()/theDuration << theCSVSeparator
+		<< 100*theStats.getNoteInsertions()/theDuration << theCSVSeparator << "\n";
+}
+
+GlobalKeyJob::GlobalKeyJob(const ListItem& inItem, const EvaluationSettings& inSettings, const string& inPreset)
+: SequenceJob<Key>(inItem, inSettings), m_Preset(inPreset), m_Score(0.), m_RefIndex(0), m_TestIndex(0)
+{
+}
+
+void GlobalKeyJob::operator()(const size_t inWorkerIndex)
+{
+	if (m_IsRestored)
+	{
+		return;
+	}
+	SimilarityScoreKey theSimilarityScoreKey(m_Preset);
+	Key theGlobalRefKey = findLongestKey(m_Sequences[0]);
+	Key theGlobalTestKey = findLongestKey(m_Sequences[1]);
+	releaseSequences();
+	m_Score = theSimilarityScoreKey.score(theGlobalRefKey, theGlobalTestKey);
+	m_RefIndex = theSimilarityScoreKey.getRefIndex();
+	m_TestIndex = theSimilarityScoreKey.getTestIndex();
+	if (m_Settings->csv)
+	{
+		const string& theCSVSeparator = m_Settings->csvSeparator;
+		const string& theCSVQuotes = m_Settings->csvQuotes;
+		std::ostringstream theCSVRow;
+		theCSVRow << std::fixed;
+		theCSVRow << theCSVQuotes << m_Item.name << theCSVQuotes << theCSVSeparator
+			<< m_Score << theCSVSeparator
+			<< KeyQMUL(theGlobalRefKey).str() << theCSVSeparator
+			<< KeyQMUL(theGlobalTestKey).str() << "\n";
+		m_CSVRow = theCSVRow.str();
+	}
+}
+
+const double GlobalKeyJob::getScore() const
+{
+	return m_Score;
+}
+
+const size_t GlobalKeyJob::getRefIndex() const
+{
+	return m_RefIndex;
+}
+
+const size_t GlobalKeyJob::getTestIndex() const
+{
+	return m_TestIndex;
+}
+
+void GlobalKeyJob::save(std::ostream& inStream) const
+{
+	writeBinary(inStream, m_Score);
+	writeBinary<boost::uint64_t>(inStream, m_RefIndex);
+	writeBinary<boost::uint64_t>(inStream, m_TestIndex);
+	Journal::writeString(inStream, m_CSVRow);
+}
+
+void GlobalKeyJob::restore(std::istream& inStream)
+{
+	boost::uint64_t theRefIndex = 0;
+	boost::uint64_t theTestIndex = 0;
+	readBinary(inStream, m_Score);
+	readBinary(inStream, theRefIndex);
+	readBinary(inStream, theTestIndex);
+	if (!inStream)
+	{
+		throw runtime_error("The journal entry of '" + m_Item.name + "' is corrupt");
+	}
+	m_RefIndex = theRefIndex;
+	m_TestIndex = theTestIndex;
+	m_CSVRow = Journal::readString(inStream);
+	m_IsRestored = true;
+}
+
+SegmentationJob::SegmentationJob(const ListItem& inItem, const EvaluationSettings& inSettings, const string& inVariant, const vector<double>& inTolerances)
+: SequenceJob<string>(inItem, inSettings), m_Evaluation(new SegmentationEvaluation(inVariant, inTolerances))
+{
+}
+
+void SegmentationJob::load()
+{
+	if (m_IsRestored)
+	{
+		return;
+	}
+	readTiming(m_Item, *m_Settings, m_Begin, m_End);
+	m_Sequences.resize(2);
+	m_Sequences[0] = readSegmentSequence(m_Item.refPath, *m_Settings);
+	m_Sequences[1] = readSegmentSequence(m_Item.testPaths.front(), *m_Settings);
+}
+
+void SegmentationJob::operator()(const size_t inWorkerIndex)
+{
+	if (m_IsRestored)
+	{
+		return;
+	}
+	m_Evaluation->addSequencePair(m_Sequences[0], m_Sequences[1]);
+	releaseSequences();
+
+	if (m_Settings->csv)
+	{
+		const string& theCSVSeparator = m_Settings->csvSeparator;
+		const string& theCSVQuotes = m_Settings->csvQuotes;
+		std::ostringstream theCSVRow;
+		theCSVRow << std::fixed;
+		theCSVRow << theCSVQuotes << m_Item.name << theCSVQuotes
+			<< theCSVSeparator << m_Evaluation->getDuration()
+			<< theCSVSeparator << m_Evaluation->getNumRefSegments()
+			<< theCSVSeparator << m_Evaluation->getNumTestSegments()
+			<< theCSVSeparator << m_Evaluation->getCombinedHammingMeasureWorst()
+			<< theCSVSeparator << m_Evaluation->getCombinedHammingMeasureHarmonic()
+			<< theCSVSeparator << m_Evaluation->getUnderSegmentation()
+			<< theCSVSeparator << m_Evaluation->getOverSegmentation()
+			<< "\n";
+		m_CSVRow = theCSVRow.str();
+	}
+}
+
+const SegmentationEvaluation& SegmentationJob::getEvaluation() const
+{
+	return *m_Evaluation;
+}
+
+void SegmentationJob::save(std::ostream& inStream) const
+{
+	m_Evaluation->save(inStream);
+	Journal::writeString(inStream, m_CSVRow);
+}
+
+void SegmentationJob::restore(std::istream& inStream)
+{
+	try
+	{
+		m_Evaluation->restore(inStream);
+	}
+	catch (std::exception&)
+	{
+		throw runtime_error("The journal entry of '" + m_Item.name + "' is corrupt");
+	}
+	m_CSVRow = Journal::readString(inStream);
+	m_IsRestored = true;
+}
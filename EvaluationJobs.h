@@ -0,0 +1,839 @@
+#ifndef EvaluationJobs_h
+#define EvaluationJobs_h
+
+//============================================================================
+/**
+	Classes representing the evaluation of a single item of the evaluation
+	list, as run by a JobPool, together with the list item and the settings
+	shared by all of them.
+
+	Every job reads its label sequences in load, evaluates them when called
+	with the index of the worker thread running it, and can save its results
+	to a journal entry and restore them from it instead of evaluating.
+
+	@author		agent
+	@date		20261017
+*/
+//============================================================================
+#include <string>
+#include <vector>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/cstdint.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/shared_ptr.hpp>
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+#include "MusOO/TimedLabel.h"
+#include "MusOO/Key.h"
+#include "MusOO/Chord.h"
+#include "MusOO/Note.h"
+#include "PairwiseEvaluation.h"
+#include "SegmentationEvaluation.h"
+#include "SequenceCache.h"
+#include "ResultStore.h"
+#include "TarArchive.h"
+#include "AnnotationFile.h"
+#include "Journal.h"
+
+/** Paths and time span of a single item in the evaluation list. */
+struct ListItem
+{
+	std::string name;
+	boost::filesystem::path refPath;
+	/** One file per system under test. */
+	std::vector<boost::filesystem::path> testPaths;
+	boost::filesystem::path timingPath;
+	double begin;
+	double end;
+};
+
+/** Settings shared by the evaluation of all items in the list. */
+struct EvaluationSettings
+{
+	std::string refFormat;
+	std::string testFormat;
+	double minRefDuration;
+	double maxRefDuration;
+	double delay;
+	/** Number of time chunks that long files are evaluated in at the same time. */
+	size_t numOfChunks;
+	bool verbose;
+	bool csv;
+	boost::filesystem::path outputDir;
+	std::string csvSeparator;
+	std::string csvQuotes;
+	/** Added to the names of the output files of every system under test. */
+	std::vector<std::string> systemSuffixes;
+	/** Null unless parsed annotation files are cached. */
+	boost::shared_ptr<const SequenceCache> sequenceCache;
+	/** Null unless results are stored for later runs. */
+	boost::shared_ptr<const ResultStore> resultStore;
+	/** Tar archives given instead of a directory. */
+	AnnotationFile::Archives archives;
+};
+
+/** Reads the time span to evaluate of a list item from its timing file, if
+	it has one, and takes the one in the list otherwise. */
+void readTiming(const ListItem& inItem, const EvaluationSettings& inSettings, double& outBegin, double& outEnd);
+
+void parseLabelSequence(const boost::filesystem::path& inFilePath, const bool inIsReference, const EvaluationSettings& inSettings, std::vector<MusOO::TimedLabel<MusOO::Key> >& outSequence);
+void parseLabelSequence(const boost::filesystem::path& inFilePath, const bool inIsReference, const EvaluationSettings& inSettings, std::vector<MusOO::TimedLabel<MusOO::Chord> >& outSequence);
+void parseLabelSequence(const boost::filesystem::path& inFilePath, const bool inIsReference, const EvaluationSettings& inSettings, std::vector<MusOO::TimedLabel<MusOO::Note> >& outSequence);
+
+/** Reads a label sequence from the sequence cache, or parses it and adds it
+	to the cache. */
+template <typename T>
+void readLabelSequence(const boost::filesystem::path& inFilePath, const bool inIsReference, const EvaluationSettings& inSettings, std::vector<MusOO::TimedLabel<T> >& outSequence);
+
+void calcCardinalityRange(const std::vector<MusOO::Chord>& inLabels, const size_t inNumOfChordTypes, size_t& outMinCardinality, size_t& outMaxCardinality);
+
+/** Writes a value as it lies in memory, to save results in a journal. */
+template <typename V>
+void writeBinary(std::ostream& inStream, const V& inValue);
+
+template <typename V>
+void readBinary(std::istream& inStream, V& outValue);
+
+void writeBinary(std::ostream& inStream, const Eigen::ArrayXXd& inArray);
+void readBinary(std::istream& inStream, Eigen::ArrayXXd& outArray);
+
+/** Base class for the evaluation of a single list item by a JobPool. */
+class ItemJob
+{
+public:
+
+	ItemJob(const ListItem& inItem, const EvaluationSettings& inSettings);
+
+	const std::string& getName() const;
+
+	/** Whether the results have been restored from a journal, in which case
+		the job does not need to be loaded or run. */
+	bool isRestored() const;
+
+	const std::string& getCSVRow() const;
+
+protected:
+
+	void openVerboseStream(boost::filesystem::ofstream& outVerboseStream, const std::string& inSuffix = "") const;
+
+	ListItem m_Item;
+	const EvaluationSettings* m_Settings;
+	std::string m_CSVRow;
+	bool m_IsRestored;
+};
+
+/** Base class for the evaluation of a list item from its label sequences,
+	which get loaded separately from the evaluation itself. */
+template <typename T>
+class SequenceJob : public ItemJob
+{
+public:
+
+	SequenceJob(const ListItem& inItem, const EvaluationSettings& inSettings);
+
+	/** Reads the timing and the sequences of the reference and all systems under test. */
+	void load();
+
+protected:
+
+	/** Frees the memory taken by the sequences once they have been evaluated. */
+	void releaseSequences();
+
+	double m_Begin;
+	double m_End;
+	// The reference first, followed by every system under test
+	std::vector<std::vector<MusOO::TimedLabel<T> > > m_Sequences;
+};
+
+/** Evaluation of a single list item with a PairwiseEvaluation per preset,
+	for every system under test. The reference sequence is read once, every
+	test sequence is read and split into segment pairs once, which are then
+	scored for every preset. Every worker thread gets its own evaluations, the
+	results are copied into the job. */
+template <typename T>
+class PairwiseJob : public SequenceJob<T>
+{
+	using SequenceJob<T>::m_Item;
+	using SequenceJob<T>::m_Settings;
+	using SequenceJob<T>::m_Begin;
+	using SequenceJob<T>::m_End;
+	using SequenceJob<T>::m_Sequences;
+	using SequenceJob<T>::m_IsRestored;
+	using SequenceJob<T>::openVerboseStream;
+
+public:
+
+	PairwiseJob(const ListItem& inItem, const EvaluationSettings& inSettings, const std::vector<std::vector<PairwiseEvaluation<T>*> >& inWorkerEvaluations, const std::vector<std::string>& inPresets, const std::vector<std::string>& inPresetSuffixes);
+
+	/** Reads the timing and the sequences. Systems under test of which the
+		results for every preset are in the result store are not read again,
+		nor is the reference if that holds for all of them. */
+	void load();
+
+	void operator()(const size_t inWorkerIndex);
+
+	const std::string& getCSVRow(const size_t inSystemIndex = 0, const size_t inPresetIndex = 0) const;
+
+	/** Adds the results for a system and preset to an evaluation that collects them over all items. */
+	void commitResults(PairwiseEvaluation<T>& inEvaluation, const size_t inSystemIndex = 0, const size_t inPresetIndex = 0) const;
+
+	/** Takes back the results for a system and preset from an evaluation they have been committed to. */
+	void retractResults(PairwiseEvaluation<T>& inEvaluation, const size_t inSystemIndex = 0, const size_t inPresetIndex = 0) const;
+
+	/** Writes the results to a journal entry. */
+	void save(std::ostream& inStream) const;
+
+	/** Takes the results from a journal entry written by save, instead of evaluating. */
+	void restore(std::istream& inStream);
+
+	/** Frees the memory taken by the results once they have been committed. */
+	void releaseResults();
+
+private:
+
+	struct PresetResult
+	{
+		PresetResult() : duration(0.), score(0.), isSparse(false) {}
+		double duration;
+		double score;
+		bool isSparse;
+		Eigen::ArrayXXd confusionMatrix;
+		Eigen::SparseMatrix<double> sparseConfusionMatrix;
+		std::string csvRow;
+	};
+
+	/** Evaluates every system under test of which the results are not stored. */
+	void evaluate(const std::vector<PairwiseEvaluation<T>*>& inEvaluations);
+
+	void printVerboseHeader(std::ostream& inVerboseStream) const;
+	void printCSVRow(std::ostream& inCSVStream, const PresetResult& inResult, const std::vector<T>& inLabels) const;
+	/** Distinguishes the results of the different modes in the result store. */
+	static const char* getStoreName();
+
+	static const ResultStore::Result storeResult(const PresetResult& inResult);
+	static void restoreResult(const ResultStore::Result& inStoredResult, const PairwiseEvaluation<T>& inEvaluation, PresetResult& outResult);
+
+	const std::vector<std::vector<PairwiseEvaluation<T>*> >* m_WorkerEvaluations;
+	const std::vector<std::string>* m_Presets;
+	const std::vector<std::string>* m_PresetSuffixes;
+	std::vector<std::vector<PresetResult> > m_Results;
+	// Whether the results of a system under test have been read from the store
+	std::vector<bool> m_IsStored;
+	// Per system under test and preset, empty unless results are stored
+	std::vector<std::vector<std::string> > m_StoreKeys;
+};
+
+template <> const char* PairwiseJob<MusOO::Key>::getStoreName();
+template <> const char* PairwiseJob<MusOO::Chord>::getStoreName();
+template <> const char* PairwiseJob<MusOO::Note>::getStoreName();
+template <> void PairwiseJob<MusOO::Key>::printVerboseHeader(std::ostream& inVerboseStream) const;
+template <> void PairwiseJob<MusOO::Chord>::printVerboseHeader(std::ostream& inVerboseStream) const;
+template <> void PairwiseJob<MusOO::Note>::printVerboseHeader(std::ostream& inVerboseStream) const;
+template <> void PairwiseJob<MusOO::Key>::printCSVRow(std::ostream& inCSVStream, const PresetResult& inResult, const std::vector<MusOO::Key>& inLabels) const;
+template <> void PairwiseJob<MusOO::Chord>::printCSVRow(std::ostream& inCSVStream, const PresetResult& inResult, const std::vector<MusOO::Chord>& inLabels) const;
+template <> void PairwiseJob<MusOO::Note>::printCSVRow(std::ostream& inCSVStream, const PresetResult& inResult, const std::vector<MusOO::Note>& inLabels) const;
+
+/** Evaluation of the agreement between every ordered pair of annotations of a
+	single list item, with a PairwiseEvaluation per preset. The reference is
+	the first annotation, followed by those of every system under test. Each
+	annotation is read once, each pair is split into segment pairs once, which
+	are then scored for every preset. */
+template <typename T>
+class AgreementJob : public SequenceJob<T>
+{
+	using SequenceJob<T>::m_Item;
+	using SequenceJob<T>::m_Settings;
+	using SequenceJob<T>::m_Begin;
+	using SequenceJob<T>::m_End;
+	using SequenceJob<T>::m_Sequences;
+	using SequenceJob<T>::m_IsRestored;
+
+public:
+
+	AgreementJob(const ListItem& inItem, const EvaluationSettings& inSettings, const std::vector<std::vector<PairwiseEvaluation<T>*> >& inWorkerEvaluations, const std::vector<std::string>& inAnnotationNames);
+
+	void operator()(const size_t inWorkerIndex);
+
+	/** Durations of the evaluated segments for every ordered pair of annotations, with the reference annotations in the rows. */
+	const Eigen::ArrayXXd& getDurations(const size_t inPresetIndex) const;
+
+	/** Scores of every ordered pair of annotations, with the reference annotations in the rows. */
+	const Eigen::ArrayXXd& getScores(const size_t inPresetIndex) const;
+
+	const std::string& getCSVRows(const size_t inPresetIndex) const;
+
+	/** Writes the results to a journal entry. */
+	void save(std::ostream& inStream) const;
+
+	/** Takes the results from a journal entry written by save, instead of evaluating. */
+	void restore(std::istream& inStream);
+
+	/** Frees the memory taken by the results once they have been committed. */
+	void releaseResults();
+
+private:
+
+	const std::vector<std::vector<PairwiseEvaluation<T>*> >* m_WorkerEvaluations;
+	const std::vector<std::string>* m_AnnotationNames;
+	std::vector<Eigen::ArrayXXd> m_Durations;
+	std::vector<Eigen::ArrayXXd> m_Scores;
+	std::vector<std::string> m_CSVRows;
+};
+
+/** Evaluation of the global key of a single list item. */
+class GlobalKeyJob : public SequenceJob<MusOO::Key>
+{
+public:
+
+	GlobalKeyJob(const ListItem& inItem, const EvaluationSettings& inSettings, const std::string& inPreset);
+
+	void operator()(const size_t inWorkerIndex);
+
+	const double getScore() const;
+	const size_t getRefIndex() const;
+	const size_t getTestIndex() const;
+
+	/** Writes the results to a journal entry. */
+	void save(std::ostream& inStream) const;
+
+	/** Takes the results from a journal entry written by save, instead of evaluating. */
+	void restore(std::istream& inStream);
+
+private:
+
+	std::string m_Preset;
+	double m_Score;
+	size_t m_RefIndex;
+	size_t m_TestIndex;
+};
+
+/** Segmentation evaluation of a single list item. */
+class SegmentationJob : public SequenceJob<std::string>
+{
+public:
+
+	SegmentationJob(const ListItem& inItem, const EvaluationSettings& inSettings, const std::string& inVariant, const std::vector<double>& inTolerances);
+
+	/** Reads the segment sequences of the reference and the system under test, which are not parsed any further. */
+	void load();
+
+	void operator()(const size_t inWorkerIndex);
+
+	const SegmentationEvaluation& getEvaluation() const;
+
+	/** Writes the results to a journal entry. */
+	void save(std::ostream& inStream) const;
+
+	/** Takes the results from a journal entry written by save, instead of evaluating. */
+	void restore(std::istream& inStream);
+
+private:
+
+	boost::shared_ptr<SegmentationEvaluation> m_Evaluation;
+};
+
+template <typename T>
+void readLabelSequence(const boost::filesystem::path& inFilePath, const bool inIsReference, const EvaluationSettings& inSettings, std::vector<MusOO::TimedLabel<T> >& outSequence)
+{
+	const std::string& theFormat = inIsReference ? inSettings.refFormat : inSettings.testFormat;
+	if (inSettings.sequenceCache && inSettings.sequenceCache->read(inFilePath, inIsReference, theFormat, outSequence))
+	{
+		return;
+	}
+	parseLabelSequence(inFilePath, inIsReference, inSettings, outSequence);
+	if (inSettings.sequenceCache)
+	{
+		inSettings.sequenceCache->write(inFilePath, inIsReference, theFormat, outSequence);
+	}
+}
+
+template <typename V>
+void writeBinary(std::ostream& inStream, const V& inValue)
+{
+	inStream.write(reinterpret_cast<const char*>(&inValue), sizeof(V));
+}
+
+template <typename V>
+void readBinary(std::istream& inStream, V& outValue)
+{
+	inStream.read(reinterpret_cast<char*>(&outValue), sizeof(V));
+}
+
+template <typename T>
+SequenceJob<T>::SequenceJob(const ListItem& inItem, const EvaluationSettings& inSettings)
+: ItemJob(inItem, inSettings), m_Begin(0.), m_End(0.)
+{
+}
+
+template <typename T>
+void SequenceJob<T>::load()
+{
+	if (m_IsRestored)
+	{
+		return;
+	}
+	readTiming(m_Item, *m_Settings, m_Begin, m_End);
+	m_Sequences.resize(m_Item.testPaths.size() + 1);
+	readLabelSequence(m_Item.refPath, true, *m_Settings, m_Sequences[0]);
+	for (size_t iSystem = 0; iSystem < m_Item.testPaths.size(); ++iSystem)
+	{
+		readLabelSequence(m_Item.testPaths[iSystem], false, *m_Settings, m_Sequences[iSystem+1]);
+	}
+}
+
+template <typename T>
+void SequenceJob<T>::releaseSequences()
+{
+	std::vector<std::vector<MusOO::TimedLabel<T> > >().swap(m_Sequences);
+}
+
+template <typename T>
+PairwiseJob<T>::PairwiseJob(const ListItem& inItem, const EvaluationSettings& inSettings, const std::vector<std::vector<PairwiseEvaluation<T>*> >& inWorkerEvaluations, const std::vector<std::string>& inPresets, const std::vector<std::string>& inPresetSuffixes)
+: SequenceJob<T>(inItem, inSettings), m_WorkerEvaluations(&inWorkerEvaluations), m_Presets(&inPresets), m_PresetSuffixes(&inPresetSuffixes)
+{
+}
+
+template <typename T>
+void PairwiseJob<T>::load()
+{
+	if (m_IsRestored)
+	{
+		return;
+	}
+	readTiming(m_Item, *m_Settings, m_Begin, m_End);
+	const std::vector<PairwiseEvaluation<T>*>& theEvaluations = m_WorkerEvaluations->front();
+	const size_t theNumOfSystems = m_Item.testPaths.size();
+	m_Results.assign(theNumOfSystems, std::vector<PresetResult>(theEvaluations.size()));
+	m_IsStored.assign(theNumOfSystems, false);
+	m_StoreKeys.clear();
+	if (m_Settings->resultStore)
+	{
+		// Everything that changes the result of a pair of files is part of its key
+		std::ostringstream theItemKey;
+		theItemKey << std::setprecision(17) << getStoreName() << "\n"
+			<< AnnotationFile(m_Item.refPath, m_Settings->archives).hashContents() << "\n" << m_Settings->refFormat << "\n"
+			<< m_Begin << "\n" << m_End << "\n" << m_Settings->minRefDuration << "\n" << m_Settings->maxRefDuration << "\n" << m_Settings->delay << "\n";
+		m_StoreKeys.assign(theNumOfSystems, std::vector<std::string>(theEvaluations.size()));
+		for (size_t iSystem = 0; iSystem < theNumOfSystems; ++iSystem)
+		{
+			const std::string theSystemKey = theItemKey.str() + AnnotationFile(m_Item.testPaths[iSystem], m_Settings->archives).hashContents() + "\n" + m_Settings->testFormat + "\n";
+			// Verbose output needs the segments themselves
+			bool theIsStored = !m_Settings->verbose;
+			for (size_t iPreset = 0; iPreset < theEvaluations.size(); ++iPreset)
+			{
+				m_StoreKeys[iSystem][iPreset] = theSystemKey + (*m_Presets)[iPreset];
+				ResultStore::Result theStoredResult;
+				theIsStored = theIsStored && m_Settings->resultStore->read(m_StoreKeys[iSystem][iPreset], theEvaluations[iPreset]->getNumOfRefLabels(), theEvaluations[iPreset]->getNumOfTestLabels(), theStoredResult);
+				if (theIsStored)
+				{
+					restoreResult(theStoredResult, *theEvaluations[iPreset], m_Results[iSystem][iPreset]);
+				}
+			}
+			m_IsStored[iSystem] = theIsStored;
+		}
+	}
+	m_Sequences.resize(theNumOfSystems + 1);
+	if (std::find(m_IsStored.begin(), m_IsStored.end(), false) != m_IsStored.end())
+	{
+		readLabelSequence(m_Item.refPath, true, *m_Settings, m_Sequences[0]);
+	}
+	for (size_t iSystem = 0; iSystem < theNumOfSystems; ++iSystem)
+	{
+		if (!m_IsStored[iSystem])
+		{
+			readLabelSequence(m_Item.testPaths[iSystem], false, *m_Settings, m_Sequences[iSystem+1]);
+		}
+	}
+}
+
+template <typename T>
+void PairwiseJob<T>::operator()(const size_t inWorkerIndex)
+{
+	if (m_IsRestored)
+	{
+		return;
+	}
+	const std::vector<PairwiseEvaluation<T>*>& theEvaluations = (*m_WorkerEvaluations)[inWorkerIndex];
+	try
+	{
+		evaluate(theEvaluations);
+	}
+	catch (...)
+	{
+		// The evaluations get reused for the next item
+		for (size_t iPreset = 0; iPreset < theEvaluations.size(); ++iPreset)
+		{
+			theEvaluations[iPreset]->reset();
+		}
+		this->releaseSequences();
+		throw;
+	}
+	this->releaseSequences();
+}
+
+template <typename T>
+const std::string& PairwiseJob<T>::getCSVRow(const size_t inSystemIndex /*= 0*/, const size_t inPresetIndex /*= 0*/) const
+{
+	return m_Results[inSystemIndex][inPresetIndex].csvRow;
+}
+
+template <typename T>
+void PairwiseJob<T>::commitResults(PairwiseEvaluation<T>& inEvaluation, const size_t inSystemIndex /*= 0*/, const size_t inPresetIndex /*= 0*/) const
+{
+	const PresetResult& theResult = m_Results[inSystemIndex][inPresetIndex];
+	if (theResult.isSparse)
+	{
+		inEvaluation.addResult(theResult.duration, theResult.score, theResult.sparseConfusionMatrix);
+	}
+	else
+	{
+		inEvaluation.addResult(theResult.duration, theResult.score, theResult.confusionMatrix);
+	}
+}
+
+template <typename T>
+void PairwiseJob<T>::retractResults(PairwiseEvaluation<T>& inEvaluation, const size_t inSystemIndex /*= 0*/, const size_t inPresetIndex /*= 0*/) const
+{
+	const PresetResult& theResult = m_Results[inSystemIndex][inPresetIndex];
+	if (theResult.isSparse)
+	{
+		inEvaluation.removeResult(theResult.duration, theResult.score, theResult.sparseConfusionMatrix);
+	}
+	else
+	{
+		inEvaluation.removeResult(theResult.duration, theResult.score, theResult.confusionMatrix);
+	}
+}
+
+template <typename T>
+void PairwiseJob<T>::save(std::ostream& inStream) const
+{
+	for (size_t iSystem = 0; iSystem < m_Results.size(); ++iSystem)
+	{
+		for (size_t iPreset = 0; iPreset < m_Results[iSystem].size(); ++iPreset)
+		{
+			const ResultStore::Result theResult = storeResult(m_Results[iSystem][iPreset]);
+			writeBinary(inStream, theResult.duration);
+			writeBinary(inStream, theResult.score);
+			writeBinary<boost::uint64_t>(inStream, theResult.confusionCells.size());
+			for (size_t iCell = 0; iCell < theResult.confusionCells.size(); ++iCell)
+			{
+				writeBinary(inStream, theResult.confusionCells[iCell]);
+			}
+			Journal::writeString(inStream, m_Results[iSystem][iPreset].csvRow);
+		}
+	}
+}
+
+template <typename T>
+void PairwiseJob<T>::restore(std::istream& inStream)
+{
+	const std::vector<PairwiseEvaluation<T>*>& theEvaluations = m_WorkerEvaluations->front();
+	m_Results.assign(m_Item.testPaths.size(), std::vector<PresetResult>(theEvaluations.size()));
+	for (size_t iSystem = 0; iSystem < m_Results.size(); ++iSystem)
+	{
+		for (size_t iPreset = 0; iPreset < theEvaluations.size(); ++iPreset)
+		{
+			ResultStore::Result theResult;
+			boost::uint64_t theNumOfCells = 0;
+			readBinary(inStream, theResult.duration);
+			readBinary(inStream, theResult.score);
+			readBinary(inStream, theNumOfCells);
+			theResult.confusionCells.resize(inStream ? theNumOfCells : 0);
+			for (size_t iCell = 0; iCell < theResult.confusionCells.size(); ++iCell)
+			{
+				readBinary(inStream, theResult.confusionCells[iCell]);
+				if (theResult.confusionCells[iCell].row >= theEvaluations[iPreset]->getNumOfRefLabels() || theResult.confusionCells[iCell].column >= theEvaluations[iPreset]->getNumOfTestLabels())
+				{
+					inStream.setstate(std::ios::failbit);
+				}
+			}
+			if (!inStream)
+			{
+				throw std::runtime_error("The journal entry of '" + m_Item.name + "' is corrupt");
+			}
+			restoreResult(theResult, *theEvaluations[iPreset], m_Results[iSystem][iPreset]);
+			m_Results[iSystem][iPreset].csvRow = Journal::readString(inStream);
+		}
+	}
+	m_IsRestored = true;
+}
+
+template <typename T>
+void PairwiseJob<T>::releaseResults()
+{
+	std::vector<std::vector<PresetResult> >().swap(m_Results);
+}
+
+template <typename T>
+void PairwiseJob<T>::evaluate(const std::vector<PairwiseEvaluation<T>*>& inEvaluations)
+{
+	for (size_t iSystem = 0; iSystem < m_Item.testPaths.size(); ++iSystem)
+	{
+		if (m_IsStored[iSystem])
+		{
+			if (m_Settings->csv)
+			{
+				for (size_t iPreset = 0; iPreset < inEvaluations.size(); ++iPreset)
+				{
+					std::ostringstream theCSVRow;
+					theCSVRow << std::fixed;
+					printCSVRow(theCSVRow, m_Results[iSystem][iPreset], inEvaluations[iPreset]->getLabels());
+					m_Results[iSystem][iPreset].csvRow = theCSVRow.str();
+				}
+			}
+			continue;
+		}
+		typename PairwiseEvaluation<T>::SegmentPairSequence theSegmentPairs;
+		PairwiseEvaluation<T>::collectSegmentPairs(m_Sequences[0], m_Sequences[iSystem+1], m_Begin, m_End, theSegmentPairs, m_Settings->minRefDuration, m_Settings->maxRefDuration, m_Settings->delay, m_Settings->numOfChunks);
+
+		for (size_t iPreset = 0; iPreset < inEvaluations.size(); ++iPreset)
+		{
+			boost::filesystem::ofstream theVerboseStream;
+			openVerboseStream(theVerboseStream, m_Settings->systemSuffixes[iSystem] + (*m_PresetSuffixes)[iPreset]);
+			if (theVerboseStream.is_open())
+			{
+				printVerboseHeader(theVerboseStream);
+			}
+			PairwiseEvaluation<T>& theEvaluation = *inEvaluations[iPreset];
+			theEvaluation.addSegmentPairs(theSegmentPairs, theVerboseStream, m_Settings->numOfChunks);
+			PresetResult& theResult = m_Results[iSystem][iPreset];
+			theResult.duration = theEvaluation.getDuration();
+			theResult.score = theEvaluation.getScore();
+			theResult.isSparse = theEvaluation.isSparse();
+			if (theResult.isSparse)
+			{
+				theResult.sparseConfusionMatrix = theEvaluation.getSparseConfusionMatrix();
+			}
+			else
+			{
+				theResult.confusionMatrix = theEvaluation.getConfusionMatrix();
+			}
+			theEvaluation.reset();
+			if (m_Settings->resultStore)
+			{
+				m_Settings->resultStore->write(m_StoreKeys[iSystem][iPreset], theEvaluation.getNumOfRefLabels(), theEvaluation.getNumOfTestLabels(), storeResult(theResult));
+			}
+
+			if (m_Settings->csv)
+			{
+				std::ostringstream theCSVRow;
+				theCSVRow << std::fixed;
+				printCSVRow(theCSVRow, theResult, theEvaluation.getLabels());
+				theResult.csvRow = theCSVRow.str();
+			}
+		}
+	}
+}
+
+template <typename T>
+const ResultStore::Result PairwiseJob<T>::storeResult(const PresetResult& inResult)
+{
+	ResultStore::Result theStoredResult;
+	theStoredResult.duration = inResult.duration;
+	theStoredResult.score = inResult.score;
+	ResultStore::Cell theCell;
+	if (inResult.isSparse)
+	{
+		for (Eigen::SparseMatrix<double>::Index iOuter = 0; iOuter < inResult.sparseConfusionMatrix.outerSize(); ++iOuter)
+		{
+			for (Eigen::SparseMatrix<double>::InnerIterator i(inResult.sparseConfusionMatrix, iOuter); i; ++i)
+			{
+				theCell.row = static_cast<boost::uint32_t>(i.row());
+				theCell.column = static_cast<boost::uint32_t>(i.col());
+				theCell.value = i.value();
+				theStoredResult.confusionCells.push_back(theCell);
+			}
+		}
+	}
+	else
+	{
+		for (Eigen::ArrayXXd::Index iColumn = 0; iColumn < inResult.confusionMatrix.cols(); ++iColumn)
+		{
+			for (Eigen::ArrayXXd::Index iRow = 0; iRow < inResult.confusionMatrix.rows(); ++iRow)
+			{
+				if (inResult.confusionMatrix(iRow, iColumn) != 0.)
+				{
+					theCell.row = static_cast<boost::uint32_t>(iRow);
+					theCell.column = static_cast<boost::uint32_t>(iColumn);
+					theCell.value = inResult.confusionMatrix(iRow, iColumn);
+					theStoredResult.confusionCells.push_back(theCell);
+				}
+			}
+		}
+	}
+	return theStoredResult;
+}
+
+template <typename T>
+void PairwiseJob<T>::restoreResult(const ResultStore::Result& inStoredResult, const PairwiseEvaluation<T>& inEvaluation, PresetResult& outResult)
+{
+	outResult.duration = inStoredResult.duration;
+	outResult.score = inStoredResult.score;
+	outResult.isSparse = inEvaluation.isSparse();
+	const std::vector<ResultStore::Cell>& theCells = inStoredResult.confusionCells;
+	if (outResult.isSparse)
+	{
+		std::vector<Eigen::Triplet<double> > theTriplets;
+		theTriplets.reserve(theCells.size());
+		for (size_t iCell = 0; iCell < theCells.size(); ++iCell)
+		{
+			theTriplets.push_back(Eigen::Triplet<double>(theCells[iCell].row, theCells[iCell].column, theCells[iCell].value));
+		}
+		outResult.sparseConfusionMatrix.resize(inEvaluation.getNumOfRefLabels(), inEvaluation.getNumOfTestLabels());
+		outResult.sparseConfusionMatrix.setFromTriplets(theTriplets.begin(), theTriplets.end());
+	}
+	else
+	{
+		outResult.confusionMatrix = Eigen::ArrayXXd::Zero(inEvaluation.getNumOfRefLabels(), inEvaluation.getNumOfTestLabels());
+		for (size_t iCell = 0; iCell < theCells.size(); ++iCell)
+		{
+			outResult.confusionMatrix(theCells[iCell].row, theCells[iCell].column) = theCells[iCell].value;
+		}
+	}
+}
+
+template <typename T>
+AgreementJob<T>::AgreementJob(const ListItem& inItem, const EvaluationSettings& inSettings, const std::vector<std::vector<PairwiseEvaluation<T>*> >& inWorkerEvaluations, const std::vector<std::string>& inAnnotationNames)
+: SequenceJob<T>(inItem, inSettings), m_WorkerEvaluations(&inWorkerEvaluations), m_AnnotationNames(&inAnnotationNames)
+{
+}
+
+template <typename T>
+void AgreementJob<T>::operator()(const size_t inWorkerIndex)
+{
+	if (m_IsRestored)
+	{
+		return;
+	}
+	const size_t theNumOfAnnotations = m_Sequences.size();
+	const std::vector<PairwiseEvaluation<T>*>& theEvaluations = (*m_WorkerEvaluations)[inWorkerIndex];
+	m_Durations.assign(theEvaluations.size(), Eigen::ArrayXXd::Zero(theNumOfAnnotations, theNumOfAnnotations));
+	m_Scores.assign(theEvaluations.size(), Eigen::ArrayXXd::Zero(theNumOfAnnotations, theNumOfAnnotations));
+	// A stream without buffer suppresses the verbose output
+	std::ostream theNoVerboseStream(NULL);
+	typename PairwiseEvaluation<T>::SegmentPairSequence theSegmentPairs;
+	try
+	{
+		for (size_t iRef = 0; iRef < theNumOfAnnotations; ++iRef)
+		{
+			for (size_t iTest = 0; iTest < theNumOfAnnotations; ++iTest)
+			{
+				PairwiseEvaluation<T>::collectSegmentPairs(m_Sequences[iRef], m_Sequences[iTest], m_Begin, m_End, theSegmentPairs, m_Settings->minRefDuration, m_Settings->maxRefDuration, m_Settings->delay, m_Settings->numOfChunks);
+				for (size_t iPreset = 0; iPreset < theEvaluations.size(); ++iPreset)
+				{
+					PairwiseEvaluation<T>& theEvaluation = *theEvaluations[iPreset];
+					theEvaluation.addSegmentPairs(theSegmentPairs, theNoVerboseStream, m_Settings->numOfChunks);
+					m_Durations[iPreset](iRef, iTest) = theEvaluation.getDuration();
+					m_Scores[iPreset](iRef, iTest) = theEvaluation.getScore();
+					theEvaluation.reset();
+				}
+			}
+		}
+	}
+	catch (...)
+	{
+		// The evaluations get reused for the next item
+		for (size_t iPreset = 0; iPreset < theEvaluations.size(); ++iPreset)
+		{
+			theEvaluations[iPreset]->reset();
+		}
+		this->releaseSequences();
+		throw;
+	}
+	this->releaseSequences();
+
+	if (m_Settings->csv)
+	{
+		const std::string& theCSVSeparator = m_Settings->csvSeparator;
+		const std::string& theCSVQuotes = m_Settings->csvQuotes;
+		m_CSVRows.resize(theEvaluations.size());
+		for (size_t iPreset = 0; iPreset < theEvaluations.size(); ++iPreset)
+		{
+			std::ostringstream theCSVRows;
+			theCSVRows << std::fixed;
+			for (size_t iRef = 0; iRef < theNumOfAnnotations; ++iRef)
+			{
+				theCSVRows << theCSVQuotes << m_Item.name << theCSVQuotes << theCSVSeparator << theCSVQuotes << (*m_AnnotationNames)[iRef] << theCSVQuotes;
+				for (size_t iTest = 0; iTest < theNumOfAnnotations; ++iTest)
+				{
+					theCSVRows << theCSVSeparator << 100*m_Scores[iPreset](iRef, iTest);
+				}
+				theCSVRows << "\n";
+			}
+			m_CSVRows[iPreset] = theCSVRows.str();
+		}
+	}
+}
+
+template <typename T>
+const Eigen::ArrayXXd& AgreementJob<T>::getDurations(const size_t inPresetIndex) const
+{
+	return m_Durations[inPresetIndex];
+}
+
+template <typename T>
+const Eigen::ArrayXXd& AgreementJob<T>::getScores(const size_t inPresetIndex) const
+{
+	return m_Scores[inPresetIndex];
+}
+
+template <typename T>
+const std::string& AgreementJob<T>::getCSVRows(const size_t inPresetIndex) const
+{
+	return m_CSVRows[inPresetIndex];
+}
+
+template <typename T>
+void AgreementJob<T>::save(std::ostream& inStream) const
+{
+	for (size_t iPreset = 0; iPreset < m_Durations.size(); ++iPreset)
+	{
+		writeBinary(inStream, m_Durations[iPreset]);
+		writeBinary(inStream, m_Scores[iPreset]);
+	}
+	for (size_t iPreset = 0; iPreset < m_CSVRows.size(); ++iPreset)
+	{
+		Journal::writeString(inStream, m_CSVRows[iPreset]);
+	}
+}
+
+template <typename T>
+void AgreementJob<T>::restore(std::istream& inStream)
+{
+	const size_t theNumOfPresets = m_WorkerEvaluations->front().size();
+	const Eigen::ArrayXXd::Index theNumOfAnnotations = m_AnnotationNames->size();
+	m_Durations.resize(theNumOfPresets);
+	m_Scores.resize(theNumOfPresets);
+	for (size_t iPreset = 0; iPreset < theNumOfPresets; ++iPreset)
+	{
+		readBinary(inStream, m_Durations[iPreset]);
+		readBinary(inStream, m_Scores[iPreset]);
+		if (!inStream || m_Durations[iPreset].rows() != theNumOfAnnotations || m_Durations[iPreset].cols() != theNumOfAnnotations ||
+			m_Scores[iPreset].rows() != theNumOfAnnotations || m_Scores[iPreset].cols() != theNumOfAnnotations)
+		{
+			throw std::runtime_error("The journal entry of '" + m_Item.name + "' is corrupt");
+		}
+	}
+	m_CSVRows.resize(m_Settings->csv ? theNumOfPresets : 0);
+	for (size_t iPreset = 0; iPreset < m_CSVRows.size(); ++iPreset)
+	{
+		m_CSVRows[iPreset] = Journal::readString(inStream);
+	}
+	m_IsRestored = true;
+}
+
+template <typename T>
+void AgreementJob<T>::releaseResults()
+{
+	std::vector<Eigen::ArrayXXd>().swap(m_Durations);
+	std::vector<Eigen::ArrayXXd>().swap(m_Scores);
+	std::vector<std::string>().swap(m_CSVRows);
+}
+
+#endif	// #ifndef EvaluationJobs_h
@@ -0,0 +1,106 @@
+//============================================================================
+/**
+	Implementation file for FileWatcher.h
+
+	@author		agent
+	@date		20261016
+*/
+//============================================================================
+
+// Includes
+#include <set>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+#include "FileWatcher.h"
+
+using std::string;
+using std::vector;
+using std::runtime_error;
+using boost::filesystem::path;
+
+#ifdef __linux__
+
+FileWatcher::FileWatcher()
+: m_Descriptor(inotify_init())
+{
+	if (m_Descriptor < 0)
+	{
+		throw runtime_error(string("Could not watch files: ") + std::strerror(errno));
+	}
+}
+
+FileWatcher::~FileWatcher()
+{
+	close(m_Descriptor);
+}
+
+void FileWatcher::watch(const path& inDirPath)
+{
+	const int theWatch = inotify_add_watch(m_Descriptor, inDirPath.string().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (theWatch < 0)
+	{
+		throw runtime_error("Could not watch directory '" + inDirPath.string() + "': " + std::strerror(errno));
+	}
+	m_DirPaths[theWatch] = inDirPath;
+}
+
+const vector<path> FileWatcher::waitForWrites(const int inQuietTime)
+{
+	std::set<path> theWrittenPaths;
+	// Keep the buffer aligned for the events that get read into it
+	inotify_event theBuffer[64];
+	pollfd theDescriptor = {m_Descriptor, POLLIN, 0};
+	while (theWrittenPaths.empty() || poll(&theDescriptor, 1, inQuietTime) > 0)
+	{
+		const ssize_t theSize = read(m_Descriptor, theBuffer, sizeof(theBuffer));
+		if (theSize < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			throw runtime_error(string("Could not watch files: ") + std::strerror(errno));
+		}
+		const char* theBytes = reinterpret_cast<const char*>(theBuffer);
+		for (ssize_t iByte = 0; iByte < theSize; )
+		{
+			const inotify_event* theEvent = reinterpret_cast<const inotify_event*>(theBytes + iByte);
+			std::map<int, path>::const_iterator theDirPath = m_DirPaths.find(theEvent->wd);
+			if (theDirPath != m_DirPaths.end() && theEvent->len > 0)
+			{
+				theWrittenPaths.insert(theDirPath->second / theEvent->name);
+			}
+			iByte += sizeof(inotify_event) + theEvent->len;
+		}
+	}
+	return vector<path>(theWrittenPaths.begin(), theWrittenPaths.end());
+}
+
+#else
+
+FileWatcher::FileWatcher()
+: m_Descriptor(-1)
+{
+	throw runtime_error("Watching files is only supported on Linux");
+}
+
+FileWatcher::~FileWatcher()
+{
+}
+
+void FileWatcher::watch(const path& inDirPath)
+{
+}
+
+const vector<path> FileWatcher::waitForWrites(const int inQuietTime)
+{
+	return vector<path>();
+}
+
+#endif
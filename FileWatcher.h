@@ -0,0 +1,48 @@
+#ifndef FileWatcher_h
+#define FileWatcher_h
+
+//============================================================================
+/**
+	Class representing a watch on the files written in a number of
+	directories, which blocks until some of them have been written.
+
+	A file counts as written when it is closed after writing or when it is
+	renamed into a watched directory, which is how most editors and tools
+	save. Only supported on Linux, where it relies on inotify.
+
+	@author		agent
+	@date		20261016
+*/
+//============================================================================
+#include <vector>
+#include <map>
+#include <boost/filesystem/path.hpp>
+
+class FileWatcher
+{
+public:
+
+	/** Constructor. Throws on systems where files cannot be watched. */
+	FileWatcher();
+
+	/** Destructor. */
+	virtual ~FileWatcher();
+
+	/** Starts watching the files written in inDirPath. */
+	void watch(const boost::filesystem::path& inDirPath);
+
+	/** Blocks until files have been written in one of the watched
+		directories and returns their paths, once no more have been written
+		for inQuietTime milliseconds. */
+	const std::vector<boost::filesystem::path> waitForWrites(const int inQuietTime = 100);
+
+private:
+
+	FileWatcher(const FileWatcher&);
+	FileWatcher& operator=(const FileWatcher&);
+
+	int m_Descriptor;
+	std::map<int, boost::filesystem::path> m_DirPaths;
+};
+
+#endif	// #ifndef FileWatcher_h
@@ -0,0 +1,320 @@
+#ifndef JobPool_h
+#define JobPool_h
+
+//============================================================================
+/**
+	Template class running a list of independent jobs on a number of worker
+	threads, while handing the finished jobs back in list order.
+
+	A job is any copyable type with a load() that reads its input and an
+	operator()(const size_t inWorkerIndex) that does the rest of the work.
+	The worker index lies in [0, max(1, inNumOfThreads)) and can be used to
+	select per-thread resources.
+
+	Workers never run further ahead of the job that is waited for than a
+	given look-ahead, so the number of finished jobs holding on to their
+	results stays bounded however long the list is. Within that look-ahead,
+	the input of upcoming jobs can be loaded on background threads, such
+	that reading files overlaps with the work.
+
+	@author		agent
+	@date		20261016
+*/
+//============================================================================
+#include <vector>
+#include <algorithm>
+#include <set>
+#include <string>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+template <typename Job>
+class JobPool
+{
+public:
+
+	/** Constructor. Starts the worker threads, which pick up the jobs in the
+		order given by inSchedule (a permutation of the job indices), limited
+		to the next inMaxLookAhead jobs in list order that have not been
+		waited for. With zero threads, no threads are started and every job is
+		run on the calling thread the moment it is waited for. With a non-zero
+		read-ahead, background threads load the input of at most that many
+		jobs before they are run, in the same order. */
+	JobPool(std::vector<Job>& inJobs, const std::vector<size_t>& inSchedule, const size_t inNumOfThreads, const size_t inMaxLookAhead, const size_t inReadAhead = 0);
+
+	/** Destructor. Lets the running jobs finish and joins all threads. */
+	virtual ~JobPool();
+
+	/** Blocks until the job at inIndex has finished and returns it. Throws if
+		running the job failed. Jobs need to be waited for in list order. */
+	Job& wait(const size_t inIndex);
+
+	const size_t getNumOfWorkers() const;
+
+private:
+
+	JobPool(const JobPool&);
+	JobPool& operator=(const JobPool&);
+
+	void work(const size_t inWorkerIndex);
+	void read();
+	/** Makes the next job in list order available to the workers and readers. Needs the mutex. */
+	void unlockNextJob();
+	/** Loads the input of a job, unless a reader has already done so, and runs it. */
+	void run(const size_t inJobIndex, const size_t inWorkerIndex);
+
+	enum JobState { Pending, Running, Done, Failed };
+	enum InputState { Unread, Reading, Read, ReadFailed, Taken };
+
+	// A few concurrent reads suffice to hide the latency of (network) file systems
+	static const size_t s_MaxNumOfReaders = 4;
+
+	std::vector<Job>& m_Jobs;
+	std::vector<size_t> m_Schedule;
+	std::vector<size_t> m_Ranks;
+	std::set<size_t> m_ReadyRanks;
+	std::set<size_t> m_UnreadRanks;
+	size_t m_NextUnlocked;
+	std::vector<JobState> m_States;
+	std::vector<InputState> m_InputStates;
+	std::vector<std::string> m_Errors;
+	size_t m_NumOfReadInputs;
+	bool m_Stopping;
+	const size_t m_NumOfThreads;
+	const size_t m_MaxLookAhead;
+	const size_t m_ReadAhead;
+	boost::mutex m_Mutex;
+	boost::condition_variable m_JobFinished;
+	boost::condition_variable m_JobsUnlocked;
+	boost::condition_variable m_InputRead;
+	boost::condition_variable m_InputsWanted;
+	boost::thread_group m_Threads;
+};
+
+template <typename Job>
+const size_t JobPool<Job>::s_MaxNumOfReaders;
+
+template <typename Job>
+JobPool<Job>::JobPool(std::vector<Job>& inJobs, const std::vector<size_t>& inSchedule, const size_t inNumOfThreads, const size_t inMaxLookAhead, const size_t inReadAhead /*= 0*/)
+: m_Jobs(inJobs), m_Schedule(inSchedule), m_Ranks(inJobs.size()), m_NextUnlocked(0), m_States(inJobs.size(), Pending),
+  m_InputStates(inJobs.size(), Unread), m_Errors(inJobs.size()), m_NumOfReadInputs(0), m_Stopping(false),
+  m_NumOfThreads(inNumOfThreads), m_MaxLookAhead(std::max<size_t>(inMaxLookAhead, 1)), m_ReadAhead(inReadAhead)
+{
+	if (m_Schedule.size() != m_Jobs.size())
+	{
+		throw std::invalid_argument("The job schedule needs to contain every job exactly once");
+	}
+	for (size_t iRank = 0; iRank < m_Schedule.size(); ++iRank)
+	{
+		m_Ranks[m_Schedule[iRank]] = iRank;
+	}
+	while (m_NextUnlocked < std::min(m_MaxLookAhead, m_Jobs.size()))
+	{
+		unlockNextJob();
+	}
+	for (size_t iThread = 0; iThread < m_NumOfThreads; ++iThread)
+	{
+		m_Threads.create_thread(boost::bind(&JobPool<Job>::work, this, iThread));
+	}
+	for (size_t iReader = 0; iReader < std::min(m_ReadAhead, s_MaxNumOfReaders); ++iReader)
+	{
+		m_Threads.create_thread(boost::bind(&JobPool<Job>::read, this));
+	}
+}
+
+template <typename Job>
+JobPool<Job>::~JobPool()
+{
+	{
+		boost::lock_guard<boost::mutex> theLock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_JobsUnlocked.notify_all();
+	m_InputsWanted.notify_all();
+	m_Threads.join_all();
+}
+
+template <typename Job>
+Job& JobPool<Job>::wait(const size_t inIndex)
+{
+	if (m_NumOfThreads == 0)
+	{
+		if (m_States[inIndex] == Pending)
+		{
+			{
+				boost::lock_guard<boost::mutex> theLock(m_Mutex);
+				if (m_NextUnlocked < m_Jobs.size() && m_NextUnlocked <= inIndex + m_MaxLookAhead)
+				{
+					unlockNextJob();
+				}
+			}
+			m_States[inIndex] = Running;
+			run(inIndex, 0);
+			m_States[inIndex] = Done;
+		}
+		return m_Jobs[inIndex];
+	}
+	boost::unique_lock<boost::mutex> theLock(m_Mutex);
+	// Waiting for this job lets the workers move one job further down the list
+	if (m_NextUnlocked < m_Jobs.size() && m_NextUnlocked <= inIndex + m_MaxLookAhead)
+	{
+		unlockNextJob();
+		m_JobsUnlocked.notify_one();
+	}
+	while (m_States[inIndex] != Done && m_States[inIndex] != Failed)
+	{
+		m_JobFinished.wait(theLock);
+	}
+	if (m_States[inIndex] == Failed)
+	{
+		throw std::runtime_error(m_Errors[inIndex]);
+	}
+	return m_Jobs[inIndex];
+}
+
+template <typename Job>
+const size_t JobPool<Job>::getNumOfWorkers() const
+{
+	return std::max<size_t>(m_NumOfThreads, 1);
+}
+
+template <typename Job>
+void JobPool<Job>::unlockNextJob()
+{
+	m_ReadyRanks.insert(m_Ranks[m_NextUnlocked]);
+	if (m_ReadAhead > 0)
+	{
+		m_UnreadRanks.insert(m_Ranks[m_NextUnlocked]);
+		m_InputsWanted.notify_one();
+	}
+	++m_NextUnlocked;
+}
+
+template <typename Job>
+void JobPool<Job>::run(const size_t inJobIndex, const size_t inWorkerIndex)
+{
+	InputState theInputState;
+	{
+		boost::unique_lock<boost::mutex> theLock(m_Mutex);
+		while (m_InputStates[inJobIndex] == Reading)
+		{
+			m_InputRead.wait(theLock);
+		}
+		theInputState = m_InputStates[inJobIndex];
+		m_InputStates[inJobIndex] = Taken;
+		if (theInputState == Unread)
+		{
+			m_UnreadRanks.erase(m_Ranks[inJobIndex]);
+		}
+		else
+		{
+			--m_NumOfReadInputs;
+			m_InputsWanted.notify_one();
+		}
+	}
+	if (theInputState == ReadFailed)
+	{
+		throw std::runtime_error(m_Errors[inJobIndex]);
+	}
+	if (theInputState == Unread)
+	{
+		m_Jobs[inJobIndex].load();
+	}
+	m_Jobs[inJobIndex](inWorkerIndex);
+}
+
+template <typename Job>
+void JobPool<Job>::work(const size_t inWorkerIndex)
+{
+	while (true)
+	{
+		size_t theJobIndex;
+		{
+			boost::unique_lock<boost::mutex> theLock(m_Mutex);
+			while (!m_Stopping && m_ReadyRanks.empty() && m_NextUnlocked < m_Jobs.size())
+			{
+				m_JobsUnlocked.wait(theLock);
+			}
+			if (m_Stopping || m_ReadyRanks.empty())
+			{
+				return;
+			}
+			theJobIndex = m_Schedule[*m_ReadyRanks.begin()];
+			m_ReadyRanks.erase(m_ReadyRanks.begin());
+			m_States[theJobIndex] = Running;
+		}
+		JobState theState = Done;
+		std::string theError;
+		try
+		{
+			run(theJobIndex, inWorkerIndex);
+		}
+		catch (std::exception& e)
+		{
+			theState = Failed;
+			theError = e.what();
+		}
+		catch (...)
+		{
+			theState = Failed;
+			theError = "Unknown error";
+		}
+		{
+			boost::lock_guard<boost::mutex> theLock(m_Mutex);
+			m_States[theJobIndex] = theState;
+			m_Errors[theJobIndex] = theError;
+		}
+		m_JobFinished.notify_all();
+	}
+}
+
+template <typename Job>
+void JobPool<Job>::read()
+{
+	while (true)
+	{
+		size_t theJobIndex;
+		{
+			boost::unique_lock<boost::mutex> theLock(m_Mutex);
+			while (!m_Stopping && (m_UnreadRanks.empty() || m_NumOfReadInputs >= m_ReadAhead))
+			{
+				m_InputsWanted.wait(theLock);
+			}
+			if (m_Stopping)
+			{
+				return;
+			}
+			theJobIndex = m_Schedule[*m_UnreadRanks.begin()];
+			m_UnreadRanks.erase(m_UnreadRanks.begin());
+			m_InputStates[theJobIndex] = Reading;
+			++m_NumOfReadInputs;
+		}
+		InputState theState = Read;
+		std::string theError;
+		try
+		{
+			m_Jobs[theJobIndex].load();
+		}
+		catch (std::exception& e)
+		{
+			theState = ReadFailed;
+			theError = e.what();
+		}
+		catch (...)
+		{
+			theState = ReadFailed;
+			theError = "Unknown error";
+		}
+		{
+			boost::lock_guard<boost::mutex> theLock(m_Mutex);
+			m_InputStates[theJobIndex] = theState;
+			m_Errors[theJobIndex] = theError;
+		}
+		m_InputRead.notify_all();
+	}
+}
+
+#endif	// #ifndef JobPool_h
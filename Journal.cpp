@@ -0,0 +1,167 @@
+//============================================================================
+/**
+	Implementation file for Journal.h
+
+	@author		agent
+	@date		20261016
+*/
+//============================================================================
+
+// Includes
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <boost/filesystem/operations.hpp>
+#include "Journal.h"
+
+using std::string;
+using std::vector;
+using std::runtime_error;
+using boost::filesystem::path;
+
+namespace
+{
+	const string s_Header = "MusOOEvaluator journal 1";
+}
+
+Journal::Journal(const path& inJournalPath, const string& inRunDescription, const bool inResume)
+: m_Path(inJournalPath)
+{
+	if (inResume && boost::filesystem::exists(m_Path))
+	{
+		read(m_Path, inRunDescription, m_Entries);
+	}
+
+	// Start from a journal without incomplete entries
+	const path theTempPath = m_Path.parent_path() / boost::filesystem::unique_path(m_Path.filename().string() + "-%%%%-%%%%.tmp");
+	{
+		boost::filesystem::ofstream theFile(theTempPath, std::ios::binary);
+		theFile << s_Header << "\n";
+		writeString(theFile, inRunDescription);
+		for (std::map<size_t, std::pair<string, string> >::const_iterator i = m_Entries.begin(); i != m_Entries.end(); ++i)
+		{
+			theFile << i->first << ' ';
+			writeString(theFile, i->second.first);
+			writeString(theFile, i->second.second);
+		}
+		if (!theFile.good())
+		{
+			theFile.close();
+			boost::system::error_code theError;
+			boost::filesystem::remove(theTempPath, theError);
+			throw runtime_error("Could not write journal '" + m_Path.string() + "'");
+		}
+	}
+	boost::filesystem::rename(theTempPath, m_Path);
+	m_File.open(m_Path, std::ios::binary | std::ios::app);
+	if (!m_File.is_open())
+	{
+		throw runtime_error("Could not write journal '" + m_Path.string() + "'");
+	}
+}
+
+Journal::Journal(const vector<path>& inJournalPaths, const string& inRunDescription)
+{
+	for (size_t iPath = 0; iPath < inJournalPaths.size(); ++iPath)
+	{
+		read(inJournalPaths[iPath], inRunDescription, m_Entries);
+	}
+}
+
+Journal::~Journal()
+{
+}
+
+bool Journal::find(const size_t inIndex, const string& inName, string& outResults) const
+{
+	std::map<size_t, std::pair<string, string> >::const_iterator theEntry = m_Entries.find(inIndex);
+	if (theEntry == m_Entries.end() || theEntry->second.first != inName)
+	{
+		return false;
+	}
+	outResults = theEntry->second.second;
+	return true;
+}
+
+void Journal::record(const size_t inIndex, const string& inName, const string& inResults)
+{
+	if (!m_File.is_open())
+	{
+		throw runtime_error("Merged journals cannot be recorded to");
+	}
+	m_File << inIndex << ' ';
+	writeString(m_File, inName);
+	writeString(m_File, inResults);
+	m_File.flush();
+	if (!m_File.good())
+	{
+		throw runtime_error("Could not write journal '" + m_Path.string() + "'");
+	}
+	m_Entries[inIndex] = std::make_pair(inName, inResults);
+}
+
+const size_t Journal::getNumOfEntries() const
+{
+	return m_Entries.size();
+}
+
+void Journal::read(const path& inJournalPath, const string& inRunDescription, std::map<size_t, std::pair<string, string> >& ioEntries)
+{
+	boost::filesystem::ifstream theFile(inJournalPath, std::ios::binary);
+	if (!theFile.is_open())
+	{
+		throw runtime_error("Could not open journal '" + inJournalPath.string() + "'");
+	}
+	string theHeader;
+	std::getline(theFile, theHeader);
+	string theRunDescription;
+	try
+	{
+		theRunDescription = readString(theFile);
+	}
+	catch (std::exception&)
+	{
+		throw runtime_error("'" + inJournalPath.string() + "' is not a journal");
+	}
+	if (theHeader != s_Header)
+	{
+		throw runtime_error("'" + inJournalPath.string() + "' is not a journal");
+	}
+	if (theRunDescription != inRunDescription)
+	{
+		throw runtime_error("The journal '" + inJournalPath.string() + "' belongs to a run with other settings");
+	}
+	// The last entry is incomplete if the run crashed while writing it
+	try
+	{
+		size_t theIndex;
+		while (theFile >> theIndex && theFile.get() == ' ')
+		{
+			const string theName = readString(theFile);
+			ioEntries[theIndex] = std::make_pair(theName, readString(theFile));
+		}
+	}
+	catch (std::exception&)
+	{
+	}
+}
+
+void Journal::writeString(std::ostream& inStream, const string& inString)
+{
+	inStream << inString.size() << ':' << inString << '\n';
+}
+
+const string Journal::readString(std::istream& inStream)
+{
+	size_t theSize;
+	if (!(inStream >> theSize) || inStream.get() != ':')
+	{
+		throw runtime_error("Could not read journal entry");
+	}
+	string theString(theSize, '\0');
+	if ((theSize > 0 && !inStream.read(&theString[0], theSize)) || inStream.get() != '\n')
+	{
+		throw runtime_error("Could not read journal entry");
+	}
+	return theString;
+}
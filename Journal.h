@@ -0,0 +1,71 @@
+#ifndef Journal_h
+#define Journal_h
+
+//============================================================================
+/**
+	Class representing the journal of a run, in which the results of every
+	list item get recorded the moment they are committed, such that an
+	interrupted run can be resumed without evaluating those items again.
+
+	The journal starts with a description of everything that changes the
+	results of the run, which needs to match when it is resumed. Every entry
+	is flushed to disk right away. An entry that was cut off by a crash is
+	left out when the journal is read back.
+
+	@author		agent
+	@date		20261016
+*/
+//============================================================================
+#include <string>
+#include <vector>
+#include <map>
+#include <iosfwd>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+class Journal
+{
+public:
+
+	/** Constructor. Starts a new journal at inJournalPath, or with inResume
+		continues the one of an earlier run there, if any. Throws if that run
+		has another description. */
+	Journal(const boost::filesystem::path& inJournalPath, const std::string& inRunDescription, const bool inResume);
+
+	/** Constructor. Reads the journals at inJournalPaths together, such as
+		those of the shards of a run, without recording anything. Throws if
+		any of them belongs to a run with another description. */
+	Journal(const std::vector<boost::filesystem::path>& inJournalPaths, const std::string& inRunDescription);
+
+	/** Destructor. */
+	virtual ~Journal();
+
+	/** Fills outResults with the results recorded for the list item at
+		inIndex, if it has been recorded under the name inName. */
+	bool find(const size_t inIndex, const std::string& inName, std::string& outResults) const;
+
+	/** Records the results of the list item at inIndex. */
+	void record(const size_t inIndex, const std::string& inName, const std::string& inResults);
+
+	const size_t getNumOfEntries() const;
+
+	/** Writes a string that can contain any character, such that readString
+		reads it back from the results of an entry. */
+	static void writeString(std::ostream& inStream, const std::string& inString);
+	static const std::string readString(std::istream& inStream);
+
+private:
+
+	Journal(const Journal&);
+	Journal& operator=(const Journal&);
+
+	/** Adds the complete entries of the journal at inJournalPath to ioEntries. */
+	static void read(const boost::filesystem::path& inJournalPath, const std::string& inRunDescription, std::map<size_t, std::pair<std::string, std::string> >& ioEntries);
+
+	const boost::filesystem::path m_Path;
+	boost::filesystem::ofstream m_File;
+	// Name and results per list item
+	std::map<size_t, std::pair<std::string, std::string> > m_Entries;
+};
+
+#endif	// #ifndef Journal_h
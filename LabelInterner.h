@@ -0,0 +1,59 @@
+#ifndef LabelInterner_h
+#define LabelInterner_h
+
+//============================================================================
+/**
+	Template class keeping a single parsed copy of every distinct label text
+	for the whole process, such that a label is parsed only the first time
+	it occurs in any file.
+
+	The parser P is a type that is constructed from the label text and
+	converts to the label type T, like MusOO::ChordQMUL for MusOO::Chord.
+	Entries are never removed, so references to them stay valid.
+
+	@author		agent
+	@date		20261016
+*/
+//============================================================================
+#include <string>
+#include <boost/unordered_map.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+template <typename P, typename T>
+class LabelInterner
+{
+public:
+
+	/** Returns the label for inText, parsing it if it has not been seen before. */
+	static const T& intern(const std::string& inText);
+
+private:
+
+	typedef boost::unordered_map<std::string, T> EntryMap;
+	// Filled by all reading threads, so only accessed while holding the mutex
+	static EntryMap s_Entries;
+	static boost::mutex s_Mutex;
+};
+
+template <typename P, typename T>
+typename LabelInterner<P,T>::EntryMap LabelInterner<P,T>::s_Entries;
+
+template <typename P, typename T>
+boost::mutex LabelInterner<P,T>::s_Mutex;
+
+template <typename P, typename T>
+const T& LabelInterner<P,T>::intern(const std::string& inText)
+{
+	boost::lock_guard<boost::mutex> theLock(s_Mutex);
+	typename EntryMap::iterator theEntry = s_Entries.find(inText);
+	if (theEntry == s_Entries.end())
+	{
+		// Parse first, such that a label that fails to parse leaves no entry behind
+		const T theLabel = P(inText);
+		theEntry = s_Entries.insert(std::make_pair(inText, theLabel)).first;
+	}
+	return theEntry->second;
+}
+
+#endif	// #ifndef LabelInterner_h
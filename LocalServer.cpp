@@ -0,0 +1,86 @@
+//============================================================================
+/**
+	Implementation file for LocalServer.h
+
+	@author		agent
+	@date		20261016
+*/
+//============================================================================
+
+// Includes
+#include <stdexcept>
+#include <boost/asio.hpp>
+#include <boost/filesystem/operations.hpp>
+#include "LocalServer.h"
+
+using std::runtime_error;
+using boost::filesystem::path;
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+
+struct LocalServer::Acceptor
+{
+	Acceptor(const path& inSocketPath)
+	: acceptor(service, boost::asio::local::stream_protocol::endpoint(inSocketPath.string()))
+	{
+	}
+
+	boost::asio::io_service service;
+	boost::asio::local::stream_protocol::acceptor acceptor;
+};
+
+LocalServer::LocalServer(const path& inSocketPath)
+: m_SocketPath(inSocketPath)
+{
+	// Only a socket gets replaced, never a file that happens to have its name
+	boost::system::error_code theError;
+	if (boost::filesystem::status(m_SocketPath, theError).type() == boost::filesystem::socket_file)
+	{
+		boost::filesystem::remove(m_SocketPath, theError);
+	}
+	try
+	{
+		m_Acceptor.reset(new Acceptor(m_SocketPath));
+	}
+	catch (boost::system::system_error& e)
+	{
+		throw runtime_error("Could not listen on '" + m_SocketPath.string() + "': " + e.code().message());
+	}
+}
+
+LocalServer::~LocalServer()
+{
+	m_Acceptor.reset();
+	boost::system::error_code theError;
+	boost::filesystem::remove(m_SocketPath, theError);
+}
+
+const boost::shared_ptr<std::iostream> LocalServer::accept()
+{
+	boost::shared_ptr<boost::asio::local::stream_protocol::iostream> theStream(new boost::asio::local::stream_protocol::iostream);
+	m_Acceptor->acceptor.accept(*theStream->rdbuf());
+	return theStream;
+}
+
+#else
+
+struct LocalServer::Acceptor
+{
+};
+
+LocalServer::LocalServer(const path& inSocketPath)
+: m_SocketPath(inSocketPath)
+{
+	throw runtime_error("Serving is only supported on systems with local sockets");
+}
+
+LocalServer::~LocalServer()
+{
+}
+
+const boost::shared_ptr<std::iostream> LocalServer::accept()
+{
+	return boost::shared_ptr<std::iostream>();
+}
+
+#endif
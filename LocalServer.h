@@ -0,0 +1,48 @@
+#ifndef LocalServer_h
+#define LocalServer_h
+
+//============================================================================
+/**
+	Class representing a server on a local socket, which hands out every
+	client that connects to it as a text stream.
+
+	Clients are accepted one at a time. Only supported on systems with Unix
+	domain sockets.
+
+	@author		agent
+	@date		20261016
+*/
+//============================================================================
+#include <iosfwd>
+#include <boost/filesystem/path.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+
+class LocalServer
+{
+public:
+
+	/** Constructor. Listens on a socket at inSocketPath, replacing the one
+		an earlier server left behind. Throws on systems without local
+		sockets. */
+	LocalServer(const boost::filesystem::path& inSocketPath);
+
+	/** Destructor. Removes the socket. */
+	virtual ~LocalServer();
+
+	/** Blocks until the next client connects and returns a stream to
+		exchange text with it. */
+	const boost::shared_ptr<std::iostream> accept();
+
+private:
+
+	LocalServer(const LocalServer&);
+	LocalServer& operator=(const LocalServer&);
+
+	struct Acceptor;
+
+	const boost::filesystem::path m_SocketPath;
+	boost::scoped_ptr<Acceptor> m_Acceptor;
+};
+
+#endif	// #ifndef LocalServer_h
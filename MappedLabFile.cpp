@@ -0,0 +1,236 @@
+//============================================================================
+/**
+	Implementation file for MappedLabFile.h
+
+	@author		agent
+	@date		20261016
+*/
+//============================================================================
+
+// Includes
+#include <cstdlib>
+#include <stdexcept>
+#include <boost/cstdint.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include "MappedLabFile.h"
+
+using std::string;
+using std::vector;
+using boost::filesystem::path;
+
+namespace
+{
+	bool isBlank(const char inChar)
+	{
+		return inChar == ' ' || inChar == '\t';
+	}
+
+	bool isLineEnd(const char inChar)
+	{
+		return inChar == '\n' || inChar == '\r';
+	}
+
+	bool isDigit(const char inChar)
+	{
+		return inChar >= '0' && inChar <= '9';
+	}
+
+	/** Parses a decimal number that takes up all of [inBegin, inEnd). Small
+		mantissas and exponents are converted with a single exact operation
+		(which rounds correctly), the others by strtod. */
+	bool parseNumber(const char* inBegin, const char* inEnd, double& outNumber)
+	{
+		static const double s_PowersOf10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+			1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+		const char* thePosition = inBegin;
+		const bool theNegative = thePosition != inEnd && *thePosition == '-';
+		if (thePosition != inEnd && (*thePosition == '-' || *thePosition == '+'))
+		{
+			++thePosition;
+		}
+		boost::uint64_t theMantissa = 0;
+		int theNumOfDigits = 0;
+		int theExponent = 0;
+		bool theHasDigits = false;
+		for (; thePosition != inEnd && isDigit(*thePosition); ++thePosition)
+		{
+			theHasDigits = true;
+			if (theMantissa > 0 || *thePosition != '0')
+			{
+				if (theNumOfDigits < 19)
+				{
+					theMantissa = 10 * theMantissa + (*thePosition - '0');
+				}
+				else
+				{
+					++theExponent;
+				}
+				++theNumOfDigits;
+			}
+		}
+		if (thePosition != inEnd && *thePosition == '.')
+		{
+			for (++thePosition; thePosition != inEnd && isDigit(*thePosition); ++thePosition)
+			{
+				theHasDigits = true;
+				if (theMantissa > 0 || *thePosition != '0')
+				{
+					if (theNumOfDigits < 19)
+					{
+						theMantissa = 10 * theMantissa + (*thePosition - '0');
+						--theExponent;
+					}
+					++theNumOfDigits;
+				}
+				else
+				{
+					--theExponent;
+				}
+			}
+		}
+		if (!theHasDigits)
+		{
+			return false;
+		}
+		if (thePosition != inEnd && (*thePosition == 'e' || *thePosition == 'E'))
+		{
+			++thePosition;
+			const bool theNegativeExponent = thePosition != inEnd && *thePosition == '-';
+			if (thePosition != inEnd && (*thePosition == '-' || *thePosition == '+'))
+			{
+				++thePosition;
+			}
+			if (thePosition == inEnd)
+			{
+				return false;
+			}
+			int theWrittenExponent = 0;
+			for (; thePosition != inEnd && isDigit(*thePosition); ++thePosition)
+			{
+				if (theWrittenExponent < 100000)
+				{
+					theWrittenExponent = 10 * theWrittenExponent + (*thePosition - '0');
+				}
+			}
+			theExponent += theNegativeExponent ? -theWrittenExponent : theWrittenExponent;
+		}
+		if (thePosition != inEnd)
+		{
+			return false;
+		}
+		if (theNumOfDigits <= 19 && theMantissa <= (static_cast<boost::uint64_t>(1) << 53) && theExponent >= -22 && theExponent <= 22)
+		{
+			outNumber = static_cast<double>(theMantissa);
+			outNumber = theExponent < 0 ? outNumber / s_PowersOf10[-theExponent] : outNumber * s_PowersOf10[theExponent];
+			outNumber = theNegative ? -outNumber : outNumber;
+		}
+		else
+		{
+			const string theText(inBegin, inEnd);
+			outNumber = std::strtod(theText.c_str(), NULL);
+		}
+		return true;
+	}
+}
+
+MappedLabFile::MappedLabFile(const path& inFilePath)
+: m_Begin(NULL), m_End(NULL)
+{
+	try
+	{
+		// Empty files cannot be mapped
+		if (boost::filesystem::file_size(inFilePath) > 0)
+		{
+			boost::interprocess::file_mapping theFile(inFilePath.string().c_str(), boost::interprocess::read_only);
+			boost::interprocess::mapped_region(theFile, boost::interprocess::read_only).swap(m_Region);
+			m_Begin = static_cast<const char*>(m_Region.get_address());
+			m_End = m_Begin + m_Region.get_size();
+		}
+	}
+	catch (std::exception&)
+	{
+		throw std::runtime_error("Could not open file '" + inFilePath.string() + "' for reading");
+	}
+}
+
+MappedLabFile::MappedLabFile(const char* inBegin, const char* inEnd)
+: m_Begin(inBegin), m_End(inEnd)
+{
+}
+
+MappedLabFile::~MappedLabFile()
+{
+}
+
+const vector<string> MappedLabFile::readLines() const
+{
+	vector<string> theLines;
+	const char* thePosition = m_Begin;
+	while (thePosition != m_End)
+	{
+		const char* theLineBegin = thePosition;
+		while (thePosition != m_End && !isLineEnd(*thePosition))
+		{
+			++thePosition;
+		}
+		theLines.push_back(string(theLineBegin, thePosition));
+		if (thePosition != m_End && *thePosition++ == '\r' && thePosition != m_End && *thePosition == '\n')
+		{
+			++thePosition;
+		}
+	}
+	return theLines;
+}
+
+const MappedLabFile::ScanResult MappedLabFile::scanSegment(const char*& ioPosition, const char* inEnd, double& outOnset, double& outOffset, const char*& outLabelBegin, const char*& outLabelEnd)
+{
+	const char* theFieldBegins[3];
+	const char* theFieldEnds[3];
+	size_t theNumOfFields = 0;
+	const char* thePosition = ioPosition;
+	while (thePosition != inEnd && !isLineEnd(*thePosition))
+	{
+		if (isBlank(*thePosition))
+		{
+			++thePosition;
+		}
+		else
+		{
+			if (theNumOfFields == 3)
+			{
+				return InvalidLine;
+			}
+			theFieldBegins[theNumOfFields] = thePosition;
+			while (thePosition != inEnd && !isLineEnd(*thePosition) && !isBlank(*thePosition))
+			{
+				++thePosition;
+			}
+			theFieldEnds[theNumOfFields++] = thePosition;
+		}
+	}
+	if (theNumOfFields == 0)
+	{
+		// Only blank lines are allowed to follow a blank line
+		for (; thePosition != inEnd; ++thePosition)
+		{
+			if (!isBlank(*thePosition) && !isLineEnd(*thePosition))
+			{
+				return InvalidLine;
+			}
+		}
+		return EndOfFile;
+	}
+	if (theNumOfFields != 3 || !parseNumber(theFieldBegins[0], theFieldEnds[0], outOnset) || !parseNumber(theFieldBegins[1], theFieldEnds[1], outOffset))
+	{
+		return InvalidLine;
+	}
+	outLabelBegin = theFieldBegins[2];
+	outLabelEnd = theFieldEnds[2];
+	if (thePosition != inEnd && *thePosition++ == '\r' && thePosition != inEnd && *thePosition == '\n')
+	{
+		++thePosition;
+	}
+	ioPosition = thePosition;
+	return FoundSegment;
+}
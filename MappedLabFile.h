@@ -0,0 +1,105 @@
+#ifndef MappedLabFile_h
+#define MappedLabFile_h
+
+//============================================================================
+/**
+	Class representing a text file that is memory mapped to be scanned
+	without copying it. Line endings can be "\n", "\r\n" or "\r".
+
+	Segment files in the common three-column "onset offset label" layout are
+	read with a locale-free number parser and a single label buffer, and
+	their labels are parsed through LabelInterner. Files with any other
+	layout are left to the general readers.
+
+	@author		agent
+	@date		20261016
+*/
+//============================================================================
+#include <string>
+#include <vector>
+#include <boost/filesystem/path.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/unordered_map.hpp>
+#include "MusOO/TimedLabel.h"
+#include "LabelInterner.h"
+
+class MappedLabFile
+{
+public:
+
+	/** Constructor. Maps the file at inFilePath. Throws if it cannot be opened. */
+	MappedLabFile(const boost::filesystem::path& inFilePath);
+
+	/** Constructor. Scans the text in [inBegin, inEnd), which needs to outlive
+		the object. */
+	MappedLabFile(const char* inBegin, const char* inEnd);
+
+	/** Destructor. */
+	virtual ~MappedLabFile();
+
+	/** Reads every line of the file, without line endings. */
+	const std::vector<std::string> readLines() const;
+
+	/** Fills outSequence with a segment per line, of which the label is
+		parsed from its text by P. Returns false if any line does not
+		consist of exactly two numbers and a label, apart from blank lines
+		at the end of the file. */
+	template <typename P, typename T>
+	bool readSegments(std::vector<MusOO::TimedLabel<T> >& outSequence) const;
+
+	enum ScanResult { FoundSegment, EndOfFile, InvalidLine };
+
+	/** Appends a segment for every line in [inBegin, inEnd), looking up their
+		labels in ioLabels before parsing them. Returns InvalidLine at the
+		first line that is not a segment, EndOfFile if the segments are
+		followed by blank lines only and FoundSegment otherwise. */
+	template <typename P, typename T>
+	static const ScanResult scanSegments(const char* inBegin, const char* inEnd, boost::unordered_map<std::string, const T*>& ioLabels, std::vector<MusOO::TimedLabel<T> >& ioSequence);
+
+private:
+
+	/** Parses the segment on the line at ioPosition and moves it to the next line. */
+	static const ScanResult scanSegment(const char*& ioPosition, const char* inEnd, double& outOnset, double& outOffset, const char*& outLabelBegin, const char*& outLabelEnd);
+
+	boost::interprocess::mapped_region m_Region;
+	const char* m_Begin;
+	const char* m_End;
+};
+
+template <typename P, typename T>
+bool MappedLabFile::readSegments(std::vector<MusOO::TimedLabel<T> >& outSequence) const
+{
+	outSequence.clear();
+	// Saves going to the shared interner for every line
+	boost::unordered_map<std::string, const T*> theLabels;
+	return scanSegments<P>(m_Begin, m_End, theLabels, outSequence) != InvalidLine;
+}
+
+template <typename P, typename T>
+const MappedLabFile::ScanResult MappedLabFile::scanSegments(const char* inBegin, const char* inEnd, boost::unordered_map<std::string, const T*>& ioLabels, std::vector<MusOO::TimedLabel<T> >& ioSequence)
+{
+	const char* thePosition = inBegin;
+	double theOnset;
+	double theOffset;
+	const char* theLabelBegin;
+	const char* theLabelEnd;
+	std::string theLabelText;
+	while (thePosition != inEnd)
+	{
+		const ScanResult theResult = scanSegment(thePosition, inEnd, theOnset, theOffset, theLabelBegin, theLabelEnd);
+		if (theResult != FoundSegment)
+		{
+			return theResult;
+		}
+		theLabelText.assign(theLabelBegin, theLabelEnd);
+		typename boost::unordered_map<std::string, const T*>::const_iterator theLabel = ioLabels.find(theLabelText);
+		if (theLabel == ioLabels.end())
+		{
+			theLabel = ioLabels.insert(std::make_pair(theLabelText, &LabelInterner<P,T>::intern(theLabelText))).first;
+		}
+		ioSequence.push_back(MusOO::TimedLabel<T>(theOnset, theOffset, *theLabel->second));
+	}
+	return FoundSegment;
+}
+
+#endif	// #ifndef MappedLabFile_h
@@ -14,12 +14,22 @@
 #include <stdexcept>
 #include <ctime>
 #include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <set>
+#include <map>
+#include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/program_options.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
 #include <Eigen/Core>
 #include "MusOO/ModeQMUL.h"
 #include "MusOO/ChordTypeQMUL.h"
+#include "MusOO/KeyQMUL.h"
+#include "MusOO/ChordQMUL.h"
 #include "MusOOFile/KeyFileUtil.h"
 #include "MusOOFile/ChordFileUtil.h"
 #include "MusOOFile/NoteFileMaps.h"
@@ -31,6 +41,18 @@
 #include "SimilarityScoreChord.h"
 #include "SimilarityScoreNote.h"
 #include "SegmentationEvaluation.h"
+#include "JobPool.h"
+#include "SequenceCache.h"
+#include "ResultStore.h"
+#include "Journal.h"
+#include "LocalServer.h"
+#include "ServedEvaluations.h"
+#include "MappedLabFile.h"
+#include "TarArchive.h"
+#include "AnnotationFile.h"
+#include "EvaluationJobs.h"
+#include "RunLog.h"
+#include "PairwiseWatch.h"
 
 using std::cout;
 using std::cerr;
@@ -54,6 +76,31 @@ using boost::program_options::store;
 using boost::program_options::notify;
 using namespace MusOO;
 
+/** Name of the system whose output is in a test directory, i.e. the name of the directory. */
+string getSystemName(const path& inTestDirPath)
+{
+    path theTestDirPath = inTestDirPath;
+    while (theTestDirPath.has_parent_path() && (theTestDirPath.filename() == "." || theTestDirPath.filename() == "/"))
+    {
+        theTestDirPath = theTestDirPath.parent_path();
+    }
+    string theSystemName = theTestDirPath.filename().string();
+    if (boost::filesystem::is_regular_file(theTestDirPath))
+    {
+        // An archive is named after the directory it holds
+        const char* theArchiveExtensions[] = {".tar", ".tar.gz", ".tgz"};
+        for (size_t i = 0; i < sizeof(theArchiveExtensions) / sizeof(theArchiveExtensions[0]); ++i)
+        {
+            const string theExtension = theArchiveExtensions[i];
+            if (theSystemName.size() > theExtension.size() && theSystemName.compare(theSystemName.size() - theExtension.size(), theExtension.size(), theExtension) == 0)
+            {
+                theSystemName.erase(theSystemName.size() - theExtension.size());
+            }
+        }
+    }
+    return theSystemName;
+}
+
 void parseCommandLine(int inNumOfArguments, char* inArguments[], path& outOutputFilePath, path& outListPath,
                       path& outRefPath, path& outTestPath, string& outRefExt, string& outTestExt, string& outRefFormat,
                       string& outTestFormat, double& outBegin, double& outEnd, double& outMinRefDuration, double& outMaxRefDuration, double& outTimeDelay,
@@ -63,7 +110,7 @@ void parseCommandLine(int inNumOfArguments, char* inArguments[], path& outOutput
 	theGeneralOptions.add_options()
 		("help,h", "produce this help message")
 		("output", value<path>(&outOutputFilePath), "path to the output file")
-		("chords", value<string>(), "select chords mode")
+		("chords", value<vector<string> >()->multitoken(), "select chords mode, several presets can be evaluated at once")
 		("keys", value<string>(), "select keys mode")
 		("globalkey", value<string>(), "select global key mode")
         ("notes", value<string>(), "select notes mode")
@@ -73,11 +120,22 @@ void parseCommandLine(int inNumOfArguments, char* inArguments[], path& outOutput
 		("csv", "Print results for individual files to file in comma separated format")
         ("confusion", value<path>(), "path to resulting global confusion matrix")
         ("verbose", "Write comparison file for each individual file")
+        ("agreement", "Evaluate every ordered pair of the reference and test annotations instead")
         ("begin", value<double>(&outBegin)->default_value(0.), "the start time in seconds")
         ("end", value<double>(&outEnd)->default_value(0., "file end"), "the end time in seconds")
         ("minduration", value<double>(&outMinRefDuration)->default_value(0.), "minimum duration the reference label needs to have to be included in evaluation")
         ("maxduration", value<double>(&outMaxRefDuration)->default_value(std::numeric_limits<double>::infinity(), "inf"), "maximum duration the reference label is allowed to have to be included in evaluation")
         ("delay", value<double>(&outTimeDelay)->default_value(0.), "Add a time delay to the files to evaluate")
+        ("jobs", value<size_t>()->default_value(1), "number of files to evaluate in parallel (0 for one per processor core)")
+        ("readahead", value<size_t>()->default_value(0), "number of upcoming files to read on background threads while evaluating")
+        ("chunks", value<size_t>()->default_value(1), "number of time chunks in which long files get split, to evaluate each of them on as many threads (0 for one per processor core)")
+        ("cache", value<path>(), "directory in which parsed annotation files are cached for later runs")
+        ("store", value<path>(), "directory in which the result of every file is stored, such that later runs only evaluate changed files")
+        ("keepgoing", "Report the files that cannot be evaluated and continue with the others")
+        ("journal", "Record the results of every evaluated file, such that an interrupted run can be resumed")
+        ("resume", "Resume an interrupted run from its journal, without evaluating the recorded files again")
+        ("watch", "Keep running and evaluate the files under test again whenever they are written (Linux only)")
+        ("shard", value<string>(), "evaluate only shard i of n of the list, given as 'i/n', keeping a journal that can be merged with those of the other shards")
 		;
 
 	options_description theRelativeListOptions("Relative list options");
@@ -85,10 +143,11 @@ void parseCommandLine(int inNumOfArguments, char* inArguments[], path& outOutput
 		("list", value<path>(&outListPath), "list with base file names")
         ("refdir", value<path>(&outRefPath), "directory with reference annotations")
         ("refext", value<string>(&outRefExt), "extension of the reference annotations")
-		("testdir", value<path>(&outTestPath), "directory with files to evaluate")
+		("testdir", value<vector<path> >()->multitoken(), "directory with files to evaluate, several systems can be evaluated at once")
 		("testext", value<string>(&outTestExt), "extension of the files to evaluate")
 		("timingdir", value<path>(), "directory with files with start and end times")
 		("timingext", value<string>()->default_value("-timing.txt"), "extension of the files with start and end times")
+		("manifest", value<path>(), "CSV or TSV file with a reference path, a test path and optionally a start and end time per line, instead of a list")
 		;
     
 	options_description theSingleFileOptions("Single file options");
@@ -101,24 +160,94 @@ void parseCommandLine(int inNumOfArguments, char* inArguments[], path& outOutput
 	options_description theOptions;
 	theOptions.add(theGeneralOptions).add(theRelativeListOptions).add(theSingleFileOptions);
 
-	store(parse_command_line(inNumOfArguments, inArguments, theOptions), outVarMap);
+	// The merge subcommand takes the journals of the shards as its other arguments,
+	// the serve subcommand the socket to listen on
+	const bool isMerging = inNumOfArguments > 1 && string(inArguments[1]) == "merge";
+	const bool isServing = inNumOfArguments > 1 && string(inArguments[1]) == "serve";
+	const bool hasSubcommand = isMerging || isServing;
+	options_description theSubcommandOptions;
+	theSubcommandOptions.add(theOptions).add_options()
+		("merge", value<vector<path> >(), "journals of the shards to merge")
+		("serve", value<path>(), "local socket to serve evaluation jobs on")
+		;
+	boost::program_options::positional_options_description theSubcommandArguments;
+	if (isMerging)
+	{
+		theSubcommandArguments.add("merge", -1);
+	}
+	else if (isServing)
+	{
+		theSubcommandArguments.add("serve", 1);
+	}
+	store(boost::program_options::command_line_parser(inNumOfArguments - hasSubcommand, inArguments + hasSubcommand).options(theSubcommandOptions).positional(theSubcommandArguments).run(), outVarMap);
 	notify(outVarMap);
 
 	if (inNumOfArguments < 2 ||outVarMap.count("help") > 0)
 	{
 		cout << "Description: This application compares music label sequences.\n"
-			<< "    The reference and test sequence(s) can be specified by two modes:\n"
-			<< "    as single files or as a list of multiple files.\n" << endl;
+			<< "    The reference and test sequence(s) can be specified by three modes:\n"
+			<< "    as single files, as a list of multiple files or as a manifest of file pairs.\n"
+			<< "    The journals of the shards of a run are combined by repeating its options\n"
+			<< "    without '--shard' after 'merge <journal>...'. With 'serve <socket>', jobs\n"
+			<< "    in the single file options are evaluated as they come in over a local socket.\n" << endl;
 		cout << theOptions << endl;
 		cout << "Author: Johan Pauwels - Build: " << __DATE__ << endl;
 		cout << endl;
 		exit(0);
 	}
     
+    if (isServing)
+    {
+        if (outVarMap.count("serve") == 0)
+        {
+            throw invalid_argument("Please give the socket to serve on");
+        }
+        // Every job selects its own mode and files
+        return;
+    }
 	if (outVarMap.count("chords") + outVarMap.count("keys") + outVarMap.count("globalkey") + outVarMap.count("notes") + outVarMap.count("segmentation") != 1)
 	{
 		throw invalid_argument("Please select a single 'chords', 'keys', 'globalkey', 'notes' or 'segmentation' mode");
 	}
+    if (outVarMap.count("chords") > 0)
+    {
+        vector<string> theChordModes = outVarMap["chords"].as<vector<string> >();
+        std::sort(theChordModes.begin(), theChordModes.end());
+        if (std::adjacent_find(theChordModes.begin(), theChordModes.end()) != theChordModes.end())
+        {
+            throw invalid_argument("Please select every chords preset only once");
+        }
+    }
+    if (isMerging && outVarMap.count("merge") == 0)
+    {
+        throw invalid_argument("Please give the journals of the shards to merge");
+    }
+    if (outVarMap.count("shard") > 0 || outVarMap.count("merge") > 0)
+    {
+        if (outVarMap.count("list") == 0 && outVarMap.count("manifest") == 0)
+        {
+            throw invalid_argument("Only a list or manifest can be split in shards");
+        }
+        if (outVarMap.count("merge") > 0 && outVarMap.count("shard") + outVarMap.count("journal") + outVarMap.count("resume") + outVarMap.count("watch") > 0)
+        {
+            throw invalid_argument("Merging cannot be combined with shards, journals or watching files");
+        }
+        if (outVarMap.count("shard") > 0 && outVarMap.count("watch") > 0)
+        {
+            throw invalid_argument("Watching files cannot be combined with shards");
+        }
+    }
+    if (outVarMap.count("watch") > 0)
+    {
+        if (outVarMap.count("globalkey") > 0 || outVarMap.count("segmentation") > 0 || outVarMap.count("agreement") > 0)
+        {
+            throw invalid_argument("Files can only be watched in 'chords', 'keys' or 'notes' mode, without agreement");
+        }
+        if (outVarMap.count("journal") > 0 || outVarMap.count("resume") > 0)
+        {
+            throw invalid_argument("Watching files cannot be combined with a journal");
+        }
+    }
 	if (!exists(absolute(outOutputFilePath.parent_path())))
 	{
 		create_directories(outOutputFilePath.parent_path());
@@ -131,11 +260,12 @@ void parseCommandLine(int inNumOfArguments, char* inArguments[], path& outOutput
         {
             throw invalid_argument("'" + outListPath.string() + "' is not an existing file");
         }
+        // Merging does not read any annotations
         if (outVarMap.count("refdir") > 0)
         {
-             if(!is_directory(outRefPath))
+             if(!isMerging && !is_directory(outRefPath) && !is_regular_file(outRefPath))
             {
-                throw invalid_argument("'" + outRefPath.string() + "' is not an existing directory");
+                throw invalid_argument("'" + outRefPath.string() + "' is not an existing directory or archive");
             }
         }
         else
@@ -144,23 +274,67 @@ void parseCommandLine(int inNumOfArguments, char* inArguments[], path& outOutput
         }
         if (outVarMap.count("testdir") > 0)
         {
-            if (!is_directory(outTestPath))
+            const vector<path>& theTestDirPaths = outVarMap["testdir"].as<vector<path> >();
+            vector<string> theSystemNames(theTestDirPaths.size());
+            for (size_t iSystem = 0; iSystem < theTestDirPaths.size(); ++iSystem)
+            {
+                if (!isMerging && !is_directory(theTestDirPaths[iSystem]) && !is_regular_file(theTestDirPaths[iSystem]))
+                {
+                    throw invalid_argument("'" + theTestDirPaths[iSystem].string() + "' is not an existing directory or archive");
+                }
+                if (outVarMap.count("watch") > 0 && !is_directory(theTestDirPaths[iSystem]))
+                {
+                    throw invalid_argument("The files in archive '" + theTestDirPaths[iSystem].string() + "' cannot be watched");
+                }
+                theSystemNames[iSystem] = getSystemName(theTestDirPaths[iSystem]);
+            }
+            std::sort(theSystemNames.begin(), theSystemNames.end());
+            if (std::adjacent_find(theSystemNames.begin(), theSystemNames.end()) != theSystemNames.end())
+            {
+                throw invalid_argument("Please select test directories with different names");
+            }
+            if (theTestDirPaths.size() > 1 && (outVarMap.count("globalkey") > 0 || outVarMap.count("segmentation") > 0))
             {
-                throw invalid_argument("'" + outTestPath.string() + "' is not an existing directory");
+                throw invalid_argument("Several test directories can only be evaluated in 'chords', 'keys' or 'notes' mode");
             }
+            outTestPath = theTestDirPaths.front();
         }
         else
         {
             throw invalid_argument("Please specifiy a test directory");
         }
-        if (outVarMap.count("timingdir") > 0 && !is_directory(outVarMap["timingdir"].as<path>()))
+        if (outVarMap.count("agreement") > 0 && (outVarMap.count("globalkey") > 0 || outVarMap.count("segmentation") > 0))
         {
-            throw invalid_argument("'" + outVarMap["timingdir"].as<path>().string() + "' is not an existing directory");
+            throw invalid_argument("The agreement can only be evaluated in 'chords', 'keys' or 'notes' mode");
+        }
+        if (outVarMap.count("timingdir") > 0 && !isMerging && !is_directory(outVarMap["timingdir"].as<path>()) && !is_regular_file(outVarMap["timingdir"].as<path>()))
+        {
+            throw invalid_argument("'" + outVarMap["timingdir"].as<path>().string() + "' is not an existing directory or archive");
+        }
+    }
+    else if (outVarMap.count("manifest") > 0)
+    {
+        // Manifest mode
+        if (!is_regular_file(outVarMap["manifest"].as<path>()))
+        {
+            throw invalid_argument("'" + outVarMap["manifest"].as<path>().string() + "' is not an existing file");
+        }
+        if (outVarMap.count("refdir") + outVarMap.count("testdir") + outVarMap.count("timingdir") + outVarMap.count("reffile") + outVarMap.count("testfile") + outVarMap.count("timingfile") > 0)
+        {
+            throw invalid_argument("A manifest cannot be combined with reference, test or timing directories or files");
+        }
+        if (outVarMap.count("agreement") > 0)
+        {
+            throw invalid_argument("The agreement can only be evaluated in list mode");
         }
     }
     else
     {
         // Single file mode
+        if (outVarMap.count("agreement") > 0)
+        {
+            throw invalid_argument("The agreement can only be evaluated in list mode");
+        }
         if (outVarMap.count("reffile") > 0)
         {
             if (!is_regular_file(outRefPath))
@@ -190,6 +364,21 @@ void parseCommandLine(int inNumOfArguments, char* inArguments[], path& outOutput
     }
 }
 
+/** Reads a shard given as "i/n" on the command line into its index, counting
+    from zero, and the number of shards. */
+void parseShard(const string& inShard, size_t& outShardIndex, size_t& outNumOfShards)
+{
+    std::istringstream theShard(inShard);
+    size_t theShardNumber = 0;
+    char theSeparator = '\0';
+    if (!(theShard >> theShardNumber >> theSeparator >> outNumOfShards) || theSeparator != '/' || !theShard.eof() ||
+        theShardNumber < 1 || theShardNumber > outNumOfShards)
+    {
+        throw invalid_argument("Please select a shard as 'i/n', with i from 1 to n");
+    }
+    outShardIndex = theShardNumber - 1;
+}
+
 const std::vector<std::string> readList(const path& inListPath)
 {
     if (inListPath.empty())
@@ -199,18 +388,19 @@ const std::vector<std::string> readList(const path& inListPath)
     else
     {
         vector<string> theListItems;
-        ifstream theListIn(inListPath);
-
-        if(!theListIn.is_open())
+        vector<string> theLines;
+        try
+        {
+            theLines = MappedLabFile(inListPath).readLines();
+        }
+        catch (runtime_error&)
         {
             throw runtime_error("Could not open list '" + inListPath.string() + "'");
         }
-        std::stringstream theFileStream;
-        normaliseLineEndings(theListIn, theFileStream);
         //run over all files in the list
-        string theListItem;
-        while(getline(theFileStream, theListItem))
+        for (vector<string>::iterator it = theLines.begin(); it != theLines.end(); ++it)
         {
+            string& theListItem = *it;
             if (!theListItem.empty() && theListItem[0] != '#')
             {
                 if ((theListItem[0] == '"' && *(theListItem.end()-1) == '"') || (theListItem[0] == '\'' && *(theListItem.end()-1) == '\''))
@@ -225,70 +415,231 @@ const std::vector<std::string> readList(const path& inListPath)
     }
 }
 
-Key findLongestKey(TimedKeySequence inKeySequence)
-{
-	vector<std::pair<Key,double> > theUniqueKeys;
-	//	std::unordered_map<Key,double> theUniqueKeys;
-	for (TimedKeySequence::const_iterator i = inKeySequence.begin(); i != inKeySequence.end(); ++i)
-	{
-		//		theUniqueKeys[i->label()] += i->offset()-i->onset();
-		bool theKeyFound = false;
-		for (size_t j = 0; j < theUniqueKeys.size(); ++j)
-		{
-			if (i->label() == theUniqueKeys[j].first)
-			{
-				theUniqueKeys[j].second += i->offset()-i->onset();
-				theKeyFound = true;
-			}
-		}
-		if (!theKeyFound)
-		{
-			theUniqueKeys.push_back(std::pair<Key,double>(i->label(), i->offset()-i->onset()));
-		}
-	}
-	Key theLongestKey = theUniqueKeys.front().first;
-	double theDuration = theUniqueKeys.front().second;
-	for (size_t j = 1; j < theUniqueKeys.size(); ++j)
-	{
-		if (theUniqueKeys[j].second > theDuration)
-		{
-			theLongestKey = theUniqueKeys[j].first;
-			theDuration = theUniqueKeys[j].second;
-		}
-	}
-	return theLongestKey;
-}
-
-void constructPaths(std::string& ioBaseName, const path& theRefDirName, const std::string& theRefExt, const path& theTestDirName, const std::string& theTestExt, const variables_map& theVarMap, path& outRefFileName, path& outTestFileName, double& outBegin, double& outEnd)
+void constructPaths(std::string& ioBaseName, const path& theRefDirName, const std::string& theRefExt, const std::vector<path>& theTestDirNames, const std::string& theTestExt, const variables_map& theVarMap, path& outRefFileName, std::vector<path>& outTestFileNames, path& outTimingFileName)
 {
+    outTestFileNames.resize(theTestDirNames.size());
     if (ioBaseName.empty())
     {
-        ioBaseName = theTestDirName.stem().string();
+        ioBaseName = theTestDirNames.front().stem().string();
         outRefFileName = theRefDirName;
-        outTestFileName = theTestDirName;
+        outTestFileNames = theTestDirNames;
     }
     else
     {
         outRefFileName = theRefDirName / path(ioBaseName + theRefExt);
-        outTestFileName = theTestDirName / path(ioBaseName + theTestExt);
+        for (size_t iSystem = 0; iSystem < theTestDirNames.size(); ++iSystem)
+        {
+            outTestFileNames[iSystem] = theTestDirNames[iSystem] / path(ioBaseName + theTestExt);
+        }
     }
-    if (theVarMap.count("timingdir") > 0 || theVarMap.count("timingfile") > 0)
+    if (theVarMap.count("timingdir") > 0)
     {
-        path theTimingPath;
-        if (theVarMap.count("timingdir") > 0)
+        outTimingFileName = theVarMap["timingdir"].as<path>() / path(ioBaseName + theVarMap["timingext"].as<string>());
+    }
+    else if (theVarMap.count("timingfile") > 0)
+    {
+        outTimingFileName = theVarMap["timingfile"].as<path>();
+    }
+}
+
+const std::vector<ListItem> constructListItems(std::vector<std::string>& ioBaseNames, const path& theRefDirName, const std::string& theRefExt, const std::vector<path>& theTestDirNames, const std::string& theTestExt, const variables_map& theVarMap, const double inBegin, const double inEnd)
+{
+    vector<ListItem> theListItems(ioBaseNames.size());
+    for (size_t i = 0; i < ioBaseNames.size(); ++i)
+    {
+        constructPaths(ioBaseNames[i], theRefDirName, theRefExt, theTestDirNames, theTestExt, theVarMap, theListItems[i].refPath, theListItems[i].testPaths, theListItems[i].timingPath);
+        theListItems[i].name = ioBaseNames[i];
+        theListItems[i].begin = inBegin;
+        theListItems[i].end = inEnd;
+    }
+    return theListItems;
+}
+
+/** Splits a line of a manifest into fields separated by inSeparator, which
+    can be enclosed in double quotes, with doubled quotes inside them. */
+const std::vector<std::string> splitManifestLine(const std::string& inLine, const char inSeparator)
+{
+    vector<string> theFields(1);
+    bool isQuoted = false;
+    for (size_t i = 0; i < inLine.size(); ++i)
+    {
+        if (inLine[i] == '"' && (isQuoted || theFields.back().find_first_not_of(" ") == string::npos))
+        {
+            if (isQuoted && i+1 < inLine.size() && inLine[i+1] == '"')
+            {
+                theFields.back() += inLine[++i];
+            }
+            else
+            {
+                if (!isQuoted)
+                {
+                    theFields.back().clear();
+                }
+                isQuoted = !isQuoted;
+            }
+        }
+        else if (inLine[i] == inSeparator && !isQuoted)
         {
-            theTimingPath = theVarMap["timingdir"].as<path>() / path(ioBaseName + theVarMap["timingext"].as<string>());
+            theFields.push_back("");
         }
         else
         {
-            theTimingPath = theVarMap["timingfile"].as<path>();
+            theFields.back() += inLine[i];
+        }
+    }
+    for (vector<string>::iterator it = theFields.begin(); it != theFields.end(); ++it)
+    {
+        const size_t theBegin = it->find_first_not_of(" ");
+        *it = theBegin == string::npos ? "" : it->substr(theBegin, it->find_last_not_of(" ") - theBegin + 1);
+    }
+    return theFields;
+}
+
+/** Reads a manifest with a reference path, a test path and optionally a
+    start and end time per line, separated by tabs, or by commas if a line
+    holds no tabs. Relative paths are taken relative to the manifest. Items
+    without times, or with empty ones, get inBegin and inEnd. */
+const std::vector<ListItem> readManifest(const path& inManifestPath, const double inBegin, const double inEnd)
+{
+    vector<string> theLines;
+    try
+    {
+        theLines = MappedLabFile(inManifestPath).readLines();
+    }
+    catch (runtime_error&)
+    {
+        throw runtime_error("Could not open manifest '" + inManifestPath.string() + "'");
+    }
+    const path theManifestDir = inManifestPath.parent_path();
+    vector<ListItem> theListItems;
+    for (size_t iLine = 0; iLine < theLines.size(); ++iLine)
+    {
+        const string& theLine = theLines[iLine];
+        if (theLine.find_first_not_of(" \t") == string::npos || theLine[theLine.find_first_not_of(" \t")] == '#')
+        {
+            continue;
+        }
+        const vector<string> theFields = splitManifestLine(theLine, theLine.find('\t') != string::npos ? '\t' : ',');
+        const string theLineDescription = "Line " + boost::lexical_cast<string>(iLine+1) + " of manifest '" + inManifestPath.string() + "'";
+        if ((theFields.size() != 2 && theFields.size() != 4) || theFields[0].empty() || theFields[1].empty())
+        {
+            throw runtime_error(theLineDescription + " does not hold a reference path, a test path and optionally a start and end time");
+        }
+        ListItem theListItem;
+        const path theRefPath(theFields[0]);
+        theListItem.refPath = theRefPath.is_absolute() ? theRefPath : theManifestDir / theRefPath;
+        const path theTestPath(theFields[1]);
+        theListItem.testPaths.push_back(theTestPath.is_absolute() ? theTestPath : theManifestDir / theTestPath);
+        // Named like the base names of a list, unless that would point outside the output directory
+        theListItem.name = theRefPath.is_absolute() ? theRefPath.stem().string() : path(theRefPath).replace_extension().string();
+        theListItem.begin = inBegin;
+        theListItem.end = inEnd;
+        try
+        {
+            if (theFields.size() == 4 && !theFields[2].empty())
+            {
+                theListItem.begin = boost::lexical_cast<double>(theFields[2]);
+            }
+            if (theFields.size() == 4 && !theFields[3].empty())
+            {
+                theListItem.end = boost::lexical_cast<double>(theFields[3]);
+            }
+        }
+        catch (boost::bad_lexical_cast&)
+        {
+            throw runtime_error(theLineDescription + " has a start or end time that is not a number");
+        }
+        theListItems.push_back(theListItem);
+    }
+    return theListItems;
+}
+
+/** Order in which the list items get evaluated when running in parallel:
+    largest files first, such that a single long file does not hold up the end of the run. */
+const std::vector<size_t> scheduleLargestFirst(const std::vector<ListItem>& inListItems, const EvaluationSettings& inSettings)
+{
+    vector<std::pair<boost::uintmax_t, size_t> > theSizes(inListItems.size());
+    for (size_t i = 0; i < inListItems.size(); ++i)
+    {
+        const boost::uintmax_t theRefSize = AnnotationFile(inListItems[i].refPath, inSettings.archives).getSize();
+        boost::uintmax_t theTestSize = 0;
+        for (size_t iSystem = 0; iSystem < inListItems[i].testPaths.size(); ++iSystem)
+        {
+            theTestSize += AnnotationFile(inListItems[i].testPaths[iSystem], inSettings.archives).getSize();
+        }
+        // Negate the index such that equal sizes keep their list order after sorting in reverse
+        theSizes[i] = std::make_pair(theRefSize + theTestSize, inListItems.size() - i);
+    }
+    std::sort(theSizes.rbegin(), theSizes.rend());
+    vector<size_t> theSchedule(inListItems.size());
+    for (size_t i = 0; i < theSizes.size(); ++i)
+    {
+        theSchedule[i] = inListItems.size() - theSizes[i].second;
+    }
+    return theSchedule;
+}
+
+/** Collects the files of the list items with an index in
+    [inFirstItem, inListItems.size()), in steps of inStep, that do not exist. */
+void findMissingFiles(const std::vector<ListItem>& inListItems, const EvaluationSettings& inSettings, const size_t inFirstItem, const size_t inStep, std::vector<std::pair<size_t, path> >& outMissingFiles)
+{
+    for (size_t i = inFirstItem; i < inListItems.size(); i += inStep)
+    {
+        vector<path> thePaths(inListItems[i].testPaths);
+        thePaths.insert(thePaths.begin(), inListItems[i].refPath);
+        if (!inListItems[i].timingPath.empty())
+        {
+            thePaths.push_back(inListItems[i].timingPath);
+        }
+        for (size_t iPath = 0; iPath < thePaths.size(); ++iPath)
+        {
+            if (!AnnotationFile::exists(thePaths[iPath], inSettings.archives))
+            {
+                outMissingFiles.push_back(std::make_pair(i, thePaths[iPath]));
+            }
+        }
+    }
+}
+
+/** Checks that all files of the list exist before anything gets evaluated,
+    such that a bad data set fails right away. Throws with the first missing
+    files in list order, or only warns about them if inKeepGoing, as their
+    items will fail on their own. */
+void validateListItems(const std::vector<ListItem>& inListItems, const EvaluationSettings& inSettings, const bool inKeepGoing)
+{
+    // Checking a file mostly waits for the file system, so more threads than cores pay off
+    const size_t theNumOfThreads = std::min<size_t>(inListItems.size(), 16);
+    vector<vector<std::pair<size_t, path> > > theThreadMissingFiles(theNumOfThreads);
+    boost::thread_group theThreads;
+    for (size_t iThread = 0; iThread < theNumOfThreads; ++iThread)
+    {
+        theThreads.create_thread(boost::bind(&findMissingFiles, boost::cref(inListItems), boost::cref(inSettings), iThread, theNumOfThreads, boost::ref(theThreadMissingFiles[iThread])));
+    }
+    theThreads.join_all();
+    vector<std::pair<size_t, path> > theMissingFiles;
+    for (size_t iThread = 0; iThread < theNumOfThreads; ++iThread)
+    {
+        theMissingFiles.insert(theMissingFiles.end(), theThreadMissingFiles[iThread].begin(), theThreadMissingFiles[iThread].end());
+    }
+    if (!theMissingFiles.empty())
+    {
+        std::sort(theMissingFiles.begin(), theMissingFiles.end());
+        std::ostringstream theMessage;
+        theMessage << theMissingFiles.size() << " file(s) of the list do not exist:";
+        for (size_t i = 0; i < std::min<size_t>(theMissingFiles.size(), 10); ++i)
+        {
+            theMessage << "\n    " << theMissingFiles[i].second.string();
         }
-        boost::filesystem::ifstream theTimingFile(theTimingPath);
-        if (!theTimingFile.is_open())
+        if (theMissingFiles.size() > 10)
         {
-            throw runtime_error("Could not open file '" + theTimingPath.string() + "' for reading.");
+            theMessage << "\n    ...";
         }
-        theTimingFile >> outBegin >> outEnd;
+        if (inKeepGoing)
+        {
+            cerr << "Warning: " << theMessage.str() << endl;
+            return;
+        }
+        throw runtime_error(theMessage.str());
     }
 }
 
@@ -307,458 +658,1166 @@ const std::string printResultLine(const double inResult, const double inTotal, c
     return stringStream.str();
 }
 
-/**	Start point of the program. */
-int main(int inNumOfArguments,char* inArguments[])
-{ try {
+/** Describes everything that changes the results of a run, such that its
+    journal is only resumed with the same settings. */
+const std::string describeRun(const variables_map& inVarMap, const vector<ListItem>& inListItems, const EvaluationSettings& inSettings)
+{
+    std::ostringstream theDescription;
+    theDescription << std::setprecision(17);
+    const char* theModes[] = {"keys", "globalkey", "notes", "segmentation"};
+    for (size_t iMode = 0; iMode < sizeof(theModes) / sizeof(theModes[0]); ++iMode)
+    {
+        if (inVarMap.count(theModes[iMode]) > 0)
+        {
+            theDescription << theModes[iMode] << " " << inVarMap[theModes[iMode]].as<string>() << "\n";
+        }
+    }
+    if (inVarMap.count("chords") > 0)
+    {
+        const vector<string>& thePresets = inVarMap["chords"].as<vector<string> >();
+        theDescription << "chords";
+        for (size_t iPreset = 0; iPreset < thePresets.size(); ++iPreset)
+        {
+            theDescription << " " << thePresets[iPreset];
+        }
+        theDescription << "\n";
+    }
+    theDescription << (inVarMap.count("agreement") > 0 ? "agreement\n" : "")
+        << inSettings.refFormat << " " << inSettings.testFormat << " " << inSettings.minRefDuration << " " << inSettings.maxRefDuration << " " << inSettings.delay << "\n";
+    if (inSettings.csv)
+    {
+        // Lengths first, since separator and quotes may be empty or whitespace themselves
+        theDescription << "csv " << inSettings.csvSeparator.size() << " " << inSettings.csvQuotes.size() << " "
+            << inSettings.csvSeparator << inSettings.csvQuotes << "\n";
+    }
+    for (size_t iItem = 0; iItem < inListItems.size(); ++iItem)
+    {
+        const ListItem& theItem = inListItems[iItem];
+        theDescription << theItem.name << "\t" << theItem.refPath.string();
+        for (size_t iSystem = 0; iSystem < theItem.testPaths.size(); ++iSystem)
+        {
+            theDescription << "\t" << theItem.testPaths[iSystem].string();
+        }
+        theDescription << "\t" << theItem.timingPath.string() << "\t" << theItem.begin << "\t" << theItem.end << "\n";
+    }
+    return theDescription.str();
+}
 
-	path theOutputPath;
-	path theListPath;
-	path theRefDirPath;
-	path theTestDirPath;
-	string theRefExt;
-	string theTestExt;
-    string theRefFormat;
-    string theTestFormat;
-	double theBegin;
-	double theEnd;
-    double theMinRefDuration;
-    double theMaxRefDuration;
-	double theDelay;
-	variables_map theVarMap;
+/** Returns the suffix that gets added to the names of the output files of
+    each preset or system, which is empty when there is only one. */
+vector<string> createOutputSuffixes(const vector<string>& inNames)
+{
+    vector<string> theSuffixes(inNames.size());
+    if (inNames.size() > 1)
+    {
+        for (size_t iName = 0; iName < inNames.size(); ++iName)
+        {
+            theSuffixes[iName] = "-" + inNames[iName];
+        }
+    }
+    return theSuffixes;
+}
 
-	parseCommandLine(inNumOfArguments, inArguments, theOutputPath, theListPath,
-		theRefDirPath, theTestDirPath, theRefExt, theTestExt, theRefFormat, theTestFormat,
-		theBegin, theEnd, theMinRefDuration, theMaxRefDuration, theDelay, theVarMap);
+path addSuffix(const path& inPath, const string& inSuffix)
+{
+    return inPath.parent_path() / path(inPath.stem().string() + inSuffix + inPath.extension().string());
+}
 
-	string theCSVSeparator = ",";
-    string theCSVQuotes = "\"";
-    
-    path theRefPath;
-    path theTestPath;
-	double theTotalDuration;
-	Eigen::ArrayXXd theGlobalConfusionMatrix;
-	vector<string> theLabels;
-    
-	vector<string> theListItems = readList(theListPath);
-    
-	ofstream theOutputFile(theOutputPath);
-	if (!theOutputFile.is_open())
-	{
-		throw runtime_error("Could not open output file '" + theOutputPath.string() + "'");
-	}
-    if (!theListPath.empty())
+/** Creates an evaluation for every preset in each worker thread. */
+template <typename T>
+vector<vector<PairwiseEvaluation<T>*> > createWorkerEvaluations(const size_t inNumOfWorkers, const vector<string>& inPresets)
+{
+    vector<vector<PairwiseEvaluation<T>*> > theWorkerEvaluations(inNumOfWorkers, vector<PairwiseEvaluation<T>*>(inPresets.size()));
+    for (size_t iWorker = 0; iWorker < inNumOfWorkers; ++iWorker)
     {
-        theOutputFile << "List: " << theListPath << "\n" << endl;
+        for (size_t iPreset = 0; iPreset < inPresets.size(); ++iPreset)
+        {
+            theWorkerEvaluations[iWorker][iPreset] = new PairwiseEvaluation<T>(inPresets[iPreset]);
+        }
     }
-    else
+    return theWorkerEvaluations;
+}
+
+template <typename T>
+void deleteWorkerEvaluations(vector<vector<PairwiseEvaluation<T>*> >& inWorkerEvaluations)
+{
+    for (size_t iWorker = 0; iWorker < inWorkerEvaluations.size(); ++iWorker)
     {
-        theOutputFile << "Files: " << theRefDirPath << " vs " << theTestDirPath << "\n" << endl;
+        for (size_t iPreset = 0; iPreset < inWorkerEvaluations[iWorker].size(); ++iPreset)
+        {
+            delete inWorkerEvaluations[iWorker][iPreset];
+        }
     }
+    inWorkerEvaluations.clear();
+}
 
-	/**********************/
-	/* Keys or global key */
-	/**********************/
-	if (theVarMap.count("keys") > 0 || theVarMap.count("globalkey") > 0)
-	{
-		PairwiseEvaluation<Key>* theKeyEvaluation = NULL;
-		if (theVarMap.count("keys") > 0)
-		{
-			theKeyEvaluation = new PairwiseEvaluation<Key>(theVarMap["keys"].as<string>());
-		}
-		else
-		{
-			theKeyEvaluation = new PairwiseEvaluation<Key>(theVarMap["globalkey"].as<string>());
-		}
-        theLabels.resize(theKeyEvaluation->getNumOfTestLabels());
-        std::transform(theKeyEvaluation->getLabels().begin(), theKeyEvaluation->getLabels().end(), theLabels.begin(), std::mem_fun_ref(&MusOO::KeyQMUL::str));
+/** Paths of the CSV files of every system under test and preset, none
+    without CSV output. */
+vector<vector<path> > createCSVPaths(const path& inOutputPath, const EvaluationSettings& inSettings, const vector<string>& inPresetSuffixes)
+{
+    vector<vector<path> > theCSVPaths;
+    if (inSettings.csv)
+    {
+        theCSVPaths.assign(inSettings.systemSuffixes.size(), vector<path>(inPresetSuffixes.size()));
+        for (size_t iSystem = 0; iSystem < theCSVPaths.size(); ++iSystem)
+        {
+            for (size_t iPreset = 0; iPreset < inPresetSuffixes.size(); ++iPreset)
+            {
+                theCSVPaths[iSystem][iPreset] = addSuffix(inOutputPath, inSettings.systemSuffixes[iSystem] + inPresetSuffixes[iPreset]).replace_extension("csv");
+            }
+        }
+    }
+    return theCSVPaths;
+}
 
-		ofstream theCSVFile;
-		if (theVarMap.count("csv") > 0)
-		{
-			theCSVFile.open(path(theOutputPath).replace_extension("csv"));
-			if (theVarMap.count("keys") > 0)
-			{
-				theCSVFile << theVarMap["keys"].as<string>() << endl;
-				theCSVFile << "File" << theCSVSeparator << "Pairwise score (%)"
-					<< theCSVSeparator << "Duration (s)"
-					<< theCSVSeparator << "Unique ref keys"
-                    << theCSVSeparator << "Unique test keys"
-                    << theCSVSeparator << "Correct keys"
-                    << theCSVSeparator << "Adjacent keys"
-                    << theCSVSeparator << "Relative keys"
-                    << theCSVSeparator << "Parallel keys"
-                    << theCSVSeparator << "Chromatic keys" << endl;
-			}
-			else
-			{
-				theCSVFile << theVarMap["globalkey"].as<string>() << endl;
-				theCSVFile << "File" 
-					<< theCSVSeparator << "Score" 
-					<< theCSVSeparator << "Ref key" 
-					<< theCSVSeparator << "Test key" << endl;
-			}
-			theCSVFile << std::fixed;
-		}
-        
-        theGlobalConfusionMatrix = Eigen::ArrayXXd::Zero(theKeyEvaluation->getNumOfRefLabels(), theKeyEvaluation->getNumOfTestLabels());
-        double theGlobalKeyScore = 0.;
-		for (vector<string>::iterator i = theListItems.begin(); i != theListItems.end(); ++i)
-		{
-            constructPaths(*i, theRefDirPath, theRefExt, theTestDirPath, theTestExt, theVarMap, theRefPath, theTestPath, theBegin, theEnd);
-			cout << "Evaluating file " << *i << endl;
-            
-            TimedKeySequence theRefKeys = KeyFileUtil::readKeySequenceFromFile(theRefPath, true, theRefFormat);
-			TimedKeySequence theTestKeys = KeyFileUtil::readKeySequenceFromFile(theTestPath, false, theTestFormat);
-            
-			if (theVarMap.count("keys") > 0)
-			{
-                ofstream theVerboseStream;
-                if (theVarMap.count("verbose"))
+/** Serves the evaluation jobs that clients send over a local socket at
+    inSocketPath, until the process gets stopped. Every job is a line of
+    options, followed by the lines of an inline sequence under test if any,
+    and ends with an empty line. So does the response, which holds either
+    the results or a line with an error. */
+void serveJobs(const path& inSocketPath, const EvaluationSettings& inSettings)
+{
+    ServedEvaluations<Key> theKeyEvaluations(inSettings);
+    ServedEvaluations<Chord> theChordEvaluations(inSettings);
+    ServedEvaluations<Note> theNoteEvaluations(inSettings);
+    LocalServer theServer(inSocketPath);
+    cout << "Serving evaluation jobs on '" << inSocketPath.string() << "'" << endl;
+    while (true)
+    {
+        const boost::shared_ptr<std::iostream> theClient = theServer.accept();
+        string theJobLine;
+        while (std::getline(*theClient, theJobLine))
+        {
+            if (theJobLine.empty())
+            {
+                continue;
+            }
+            string theInlineTest;
+            string theLine;
+            while (std::getline(*theClient, theLine) && !theLine.empty())
+            {
+                theInlineTest += theLine + '\n';
+            }
+            // Results are only sent back once the whole job has been evaluated
+            std::ostringstream theResponse;
+            theResponse << std::fixed << std::setprecision(9);
+            try
+            {
+                variables_map theJob;
+                parseServerJob(theJobLine, theJob);
+                if (!theInlineTest.empty() && theJob["testfile"].as<path>() != "-")
+                {
+                    throw invalid_argument("Only a test file '-' can be followed by the sequence under test");
+                }
+                if (theJob.count("keys") > 0)
+                {
+                    theKeyEvaluations.evaluate(theJob, theJob["keys"].as<vector<string> >(), theInlineTest, theResponse);
+                }
+                else if (theJob.count("chords") > 0)
                 {
-                    path theVerbosePath = theOutputPath.parent_path() / path(*i + ".csv");
-                    theVerboseStream.open(theVerbosePath);
-                    theVerboseStream << "Start" << theCSVSeparator << "End" << theCSVSeparator << "RefLabel" << theCSVSeparator << "TestLabel" << theCSVSeparator << "Score" << theCSVSeparator << "Duration" << endl;
+                    theChordEvaluations.evaluate(theJob, theJob["chords"].as<vector<string> >(), theInlineTest, theResponse);
                 }
-				theKeyEvaluation->addSequencePair(theRefKeys, theTestKeys, theBegin, theEnd, theVerboseStream, theMinRefDuration, theMaxRefDuration, theDelay);
+                else
+                {
+                    theNoteEvaluations.evaluate(theJob, theJob["notes"].as<vector<string> >(), theInlineTest, theResponse);
+                }
+            }
+            catch (exception& e)
+            {
+                theResponse.str("");
+                theResponse << "error\t" << e.what() << "\n";
+            }
+            *theClient << theResponse.str() << endl;
+        }
+    }
+}
+
+void openOutputFile(ofstream& outOutputFile, const path& inOutputPath, const path& inListPath, const path& inRefDirPath, const path& inTestDirPath)
+{
+	outOutputFile.open(inOutputPath);
+	if (!outOutputFile.is_open())
+	{
+		throw runtime_error("Could not open output file '" + inOutputPath.string() + "'");
+	}
+    if (!inListPath.empty())
+    {
+        outOutputFile << "List: " << inListPath << "\n" << endl;
+    }
+    else
+    {
+        outOutputFile << "Files: " << inRefDirPath << " vs " << inTestDirPath << "\n" << endl;
+    }
+}
+
+void printChordCSVHeader(std::ostream& inCSVStream, const PairwiseEvaluation<Chord>& inChordEvaluation, const string& inChordMode, const string& inCSVSeparator, const string& inCSVQuotes)
+{
+    const size_t numChordTypes = inChordEvaluation.getNumOfRefLabels()/12;
+    size_t minCardinality;
+    size_t maxCardinality;
+    calcCardinalityRange(inChordEvaluation.getLabels(), numChordTypes, minCardinality, maxCardinality);
+    inCSVStream << inChordMode << endl;
+    inCSVStream << "File" 
+        << inCSVSeparator << "Pairwise score (%)"
+        << inCSVSeparator << "Duration (s)"
+        << inCSVSeparator << "Correct chords (%)"
+        << inCSVSeparator << "Substituted chords (%)"
+        << inCSVSeparator << "Deleted chords (%)"
+        << inCSVSeparator << "Inserted chords (%)"
+        << inCSVSeparator << "Correct no-chords (%)";
+    for (size_t iChordType = 0; iChordType < numChordTypes; ++iChordType)
+    {
+        inCSVStream << inCSVSeparator << inCSVQuotes << ChordTypeQMUL(inChordEvaluation.getLabels()[iChordType].type()) << " correct (%)" << inCSVQuotes << inCSVSeparator << inCSVQuotes << ChordTypeQMUL(inChordEvaluation.getLabels()[iChordType].type()) << " proportion (%)" << inCSVQuotes;
+    }
+    for (size_t iNumOfWrongChromas = 0; iNumOfWrongChromas <= maxCardinality; ++iNumOfWrongChromas)
+    {
+        inCSVStream << inCSVSeparator << iNumOfWrongChromas << " chroma" << (iNumOfWrongChromas==1?"":"s") << " wrong (%)";
+    }
+    inCSVStream
+        << inCSVSeparator << "Both correct (%)"
+        << inCSVSeparator << "Only root correct (%)"
+        << inCSVSeparator << "Only type correct (%)"
+        << inCSVSeparator << "Both wrong (%)"
+        << inCSVSeparator << "Unique ref chords"
+        << inCSVSeparator << "Unique test chords" << endl;
+    inCSVStream << std::fixed;
+}
 
-				if (theVarMap.count("csv") > 0)
+void printChordResults(std::ostream& inOutputStream, const PairwiseEvaluation<Chord>& inChordEvaluation, const ChordEvaluationStats& inGlobalStats, const string& inChordMode)
+{
+    const double theTotalDuration = inChordEvaluation.calcTotalDuration();
+    const size_t numChordTypes = inChordEvaluation.getNumOfRefLabels()/12;
+    size_t minCardinality;
+    size_t maxCardinality;
+    calcCardinalityRange(inChordEvaluation.getLabels(), numChordTypes, minCardinality, maxCardinality);
+    
+	inOutputStream << string(inChordMode.size()+11,'*') << "\n* Chords " << inChordMode << " *\n"
+    << string(inChordMode.size()+11,'*') << endl;
+	inOutputStream << "Duration of evaluated chords: " << theTotalDuration << " s" << endl;
+	inOutputStream << "Average score: " << 100 * inChordEvaluation.calcWeightedAverageScore() << "%" << endl;
+    
+    inOutputStream << "\nChord detection results\n" << "-----------------------" << endl;
+	inOutputStream << "Correct chords: " << printResultLine(inGlobalStats.getCorrectChords(), theTotalDuration, " s") << endl;
+	inOutputStream << "Substituted chords: " << printResultLine(inGlobalStats.getChordSubstitutions(), theTotalDuration, " s") << endl;
+	inOutputStream << "Deleted chords: " << printResultLine(inGlobalStats.getChordDeletions(), theTotalDuration, " s") << endl;
+	inOutputStream << "Inserted chords: " << printResultLine(inGlobalStats.getChordInsertions(), theTotalDuration, " s") << endl;
+	inOutputStream << "Correct no-chords: " << printResultLine(inGlobalStats.getCorrectNoChords(), theTotalDuration, " s") << endl;
+    
+    inOutputStream << "\nResults per chord type\n" << "----------------------" << endl;
+    const Eigen::ArrayXXd theResultsPerType = inGlobalStats.getCorrectChordsPerType();
+    for (Eigen::ArrayXXd::Index iChordType = 0; iChordType < theResultsPerType.rows(); ++iChordType)
+    {
+        inOutputStream << ChordTypeQMUL(inChordEvaluation.getLabels()[iChordType].type()) << ": "
+            << printResultLine(theResultsPerType(iChordType,0), theResultsPerType(iChordType,1), " s") << " of "
+            << printResultLine(theResultsPerType(iChordType,1), theTotalDuration, " s") << endl;
+    }
+    
+    inOutputStream << "\nResults per number of chromas wrong\n" << "-----------------------------------" << endl;
+    inOutputStream << "0 chromas wrong: " << printResultLine(inGlobalStats.getChordsWithNWrong(0), theTotalDuration, " s") << endl;
+    inOutputStream << "  of which root correct: " << printResultLine(inGlobalStats.getCorrectChords(), theTotalDuration, " s") << endl;
+    inOutputStream << "  of which root incorrect: " << printResultLine(inGlobalStats.getChordsWithNWrong(0)-inGlobalStats.getCorrectChords(), theTotalDuration, " s") << endl;
+    for (size_t iNumOfWrongChromas = 1; iNumOfWrongChromas <= maxCardinality; ++iNumOfWrongChromas)
+    {
+        inOutputStream << iNumOfWrongChromas << " chroma" << (iNumOfWrongChromas==1?"":"s") << " wrong: " << printResultLine(inGlobalStats.getChordsWithNWrong(iNumOfWrongChromas), theTotalDuration, " s") << endl;
+        inOutputStream << "  of which " << iNumOfWrongChromas << " substitution" << (iNumOfWrongChromas==1?"":"s") << ": " << printResultLine(inGlobalStats.getChordsWithSDI(iNumOfWrongChromas, 0, 0), theTotalDuration, " s") << endl;
+        //prune impossible combinations for this set of chord types
+        if (minCardinality + iNumOfWrongChromas <= maxCardinality)
+        {
+            inOutputStream << "  of which " << iNumOfWrongChromas << " deletion" << (iNumOfWrongChromas==1?"":"s") << ": " << printResultLine(inGlobalStats.getChordsWithSDI(0, iNumOfWrongChromas, 0), theTotalDuration, " s") << endl;
+        }
+        if (maxCardinality - iNumOfWrongChromas >= minCardinality)
+        {
+            inOutputStream << "  of which " << iNumOfWrongChromas << " insertion" << (iNumOfWrongChromas==1?"":"s") << ": " << printResultLine(inGlobalStats.getChordsWithSDI(0, 0, iNumOfWrongChromas), theTotalDuration, " s") << endl;
+        }
+        for (size_t iNumSubstitutions = iNumOfWrongChromas-1; iNumSubstitutions > 0; --iNumSubstitutions)
+        {
+            const size_t numDI = iNumOfWrongChromas-iNumSubstitutions;
+            if (minCardinality + numDI <= maxCardinality)
+            {
+                inOutputStream << "  of which " << iNumSubstitutions << " substitution" << (iNumSubstitutions==1?"":"s") << ", " << numDI << " deletion" << (numDI==1?"":"s") << ": " << printResultLine(inGlobalStats.getChordsWithSDI(iNumSubstitutions, numDI, 0), theTotalDuration, " s") << endl;
+            }
+            if (maxCardinality - numDI >= minCardinality)
+            {
+                inOutputStream << "  of which " << iNumSubstitutions << " substitution" << (iNumSubstitutions==1?"":"s") << ", " << numDI << " insertion" << (numDI==1?"":"s") << ": " << printResultLine(inGlobalStats.getChordsWithSDI(iNumSubstitutions, 0, numDI), theTotalDuration, " s") << endl;
+            }
+        }
+    }
+    const double unknownWrong = inGlobalStats.getChordsWithUnknownWrong();
+    if (unknownWrong > 0.)
+    {
+        inOutputStream << "unknown chromas wrong: " << printResultLine(unknownWrong, theTotalDuration, " s") << endl;
+    }
+    
+    inOutputStream << "\nRoot/type results\n" << "-----------------" << endl;
+    inOutputStream << "Both correct: " << printResultLine(inGlobalStats.getCorrectChords(), theTotalDuration, " s") << endl;
+	inOutputStream << "Only root correct: " << printResultLine(inGlobalStats.getOnlyRootCorrect(), theTotalDuration, " s") << endl;
+	inOutputStream << "Only type correct: " << printResultLine(inGlobalStats.getOnlyTypeCorrect(), theTotalDuration, " s") << endl;
+	inOutputStream << "Both wrong: " << printResultLine(inGlobalStats.getBothRootAndTypeWrong(), theTotalDuration, " s") << endl;
+}
+
+void openConfusionMatrixFile(ofstream& outConfusionMatrixFile, const path& inConfusionMatrixPath)
+{
+    outConfusionMatrixFile.open(inConfusionMatrixPath);
+    if (!outConfusionMatrixFile.is_open())
+    {
+        throw runtime_error("Could not open confusion matrix file '" + inConfusionMatrixPath.string() + "'");
+    }
+}
+
+/** Ranks the systems under test by their average score, separately for every preset. */
+void printLeaderboard(std::ostream& inOutputStream, const string& inTitle, const vector<string>& inPresets, const vector<string>& inSystemNames, const vector<vector<double> >& inScores)
+{
+    for (size_t iPreset = 0; iPreset < inPresets.size(); ++iPreset)
+    {
+        const string theHeader = inTitle + " " + inPresets[iPreset];
+        inOutputStream << string(theHeader.size()+4,'*') << "\n* " << theHeader << " *\n" << string(theHeader.size()+4,'*') << endl;
+        // Negate the score such that equal scores keep the order of the systems after sorting
+        vector<std::pair<double, size_t> > theRanking(inSystemNames.size());
+        for (size_t iSystem = 0; iSystem < inSystemNames.size(); ++iSystem)
+        {
+            theRanking[iSystem] = std::make_pair(-inScores[iSystem][iPreset], iSystem);
+        }
+        std::sort(theRanking.begin(), theRanking.end());
+        for (size_t iRank = 0; iRank < theRanking.size(); ++iRank)
+        {
+            inOutputStream << iRank+1 << ". " << inSystemNames[theRanking[iRank].second] << ": " << 100 * inScores[theRanking[iRank].second][iPreset] << "%" << endl;
+        }
+        inOutputStream << endl;
+    }
+}
+
+void printLeaderboardCSV(std::ostream& inCSVStream, const vector<string>& inPresets, const vector<string>& inSystemNames, const vector<vector<double> >& inScores, const string& inCSVSeparator, const string& inCSVQuotes)
+{
+    inCSVStream << "System";
+    for (size_t iPreset = 0; iPreset < inPresets.size(); ++iPreset)
+    {
+        inCSVStream << inCSVSeparator << inCSVQuotes << inPresets[iPreset] << " (%)" << inCSVQuotes;
+    }
+    inCSVStream << endl << std::fixed;
+    for (size_t iSystem = 0; iSystem < inSystemNames.size(); ++iSystem)
+    {
+        inCSVStream << inCSVQuotes << inSystemNames[iSystem] << inCSVQuotes;
+        for (size_t iPreset = 0; iPreset < inPresets.size(); ++iPreset)
+        {
+            inCSVStream << inCSVSeparator << 100 * inScores[iSystem][iPreset];
+        }
+        inCSVStream << "\n";
+    }
+}
+
+/** Ranks the systems in the output file, and in a CSV file of its own on request. */
+void writeLeaderboard(std::ostream& inOutputStream, const path& inOutputPath, const string& inTitle, const vector<string>& inPresets, const vector<string>& inSystemNames, const vector<vector<double> >& inScores, const EvaluationSettings& inSettings)
+{
+    printLeaderboard(inOutputStream, inTitle, inPresets, inSystemNames, inScores);
+    if (inSettings.csv)
+    {
+        ofstream theCSVFile(path(inOutputPath).replace_extension("csv"));
+        printLeaderboardCSV(theCSVFile, inPresets, inSystemNames, inScores, inSettings.csvSeparator, inSettings.csvQuotes);
+    }
+}
+
+/** Evaluates the agreement between all annotations of every list item for
+    each of the presets. The score matrices of every item are written to a CSV
+    file per preset, the matrices aggregated over the list to the output. */
+template <typename T>
+void evaluateAgreement(std::ostream& inOutputStream, const string& inTitle, const vector<string>& inPresets, const vector<string>& inAnnotationNames,
+                       const vector<ListItem>& inListItems, const EvaluationSettings& inSettings, const path& inOutputPath,
+                       const vector<size_t>& inSchedule, const size_t inNumOfThreads, const size_t inMaxLookAhead, const size_t inReadAhead, RunLog& ioRunLog)
+{
+    const size_t theNumOfAnnotations = inAnnotationNames.size();
+    const vector<string> theSuffixes = createOutputSuffixes(inPresets);
+    vector<boost::shared_ptr<ofstream> > theCSVFiles(inPresets.size());
+    for (size_t iPreset = 0; iPreset < inPresets.size(); ++iPreset)
+    {
+        theCSVFiles[iPreset].reset(new ofstream);
+        if (inSettings.csv)
+        {
+            ofstream& theCSVFile = *theCSVFiles[iPreset];
+            theCSVFile.open(addSuffix(inOutputPath, theSuffixes[iPreset]).replace_extension("csv"));
+            theCSVFile << inPresets[iPreset] << endl;
+            theCSVFile << "File" << inSettings.csvSeparator << "Reference";
+            for (size_t iTest = 0; iTest < theNumOfAnnotations; ++iTest)
+            {
+                theCSVFile << inSettings.csvSeparator << inSettings.csvQuotes << inAnnotationNames[iTest] << " (%)" << inSettings.csvQuotes;
+            }
+            theCSVFile << endl;
+        }
+    }
+
+    vector<Eigen::ArrayXXd> theTotalDurations(inPresets.size(), Eigen::ArrayXXd::Zero(theNumOfAnnotations, theNumOfAnnotations));
+    vector<Eigen::ArrayXXd> theTotalScores(theTotalDurations);
+    vector<Eigen::ArrayXXd> theTotalWeightedScores(theTotalDurations);
+    const size_t theNumOfWorkers = std::max<size_t>(inNumOfThreads, 1);
+    vector<vector<PairwiseEvaluation<T>*> > theWorkerEvaluations = createWorkerEvaluations<T>(theNumOfWorkers, inPresets);
+    vector<AgreementJob<T> > theJobs;
+    for (vector<ListItem>::const_iterator i = inListItems.begin(); i != inListItems.end(); ++i)
+    {
+        theJobs.push_back(AgreementJob<T>(*i, inSettings, theWorkerEvaluations, inAnnotationNames));
+    }
+    ioRunLog.restore(theJobs);
+    {
+        JobPool<AgreementJob<T> > thePool(theJobs, inSchedule, inNumOfThreads, inMaxLookAhead, inReadAhead);
+        for (size_t iJob = 0; iJob < theJobs.size(); ++iJob)
+        {
+            cout << "Evaluating file " << theJobs[iJob].getName() << endl;
+            AgreementJob<T>* theJob = ioRunLog.wait(thePool, theJobs, iJob);
+            if (theJob == NULL)
+            {
+                continue;
+            }
+            for (size_t iPreset = 0; iPreset < inPresets.size(); ++iPreset)
+            {
+                theTotalDurations[iPreset] += theJob->getDurations(iPreset);
+                theTotalScores[iPreset] += theJob->getScores(iPreset);
+                theTotalWeightedScores[iPreset] += theJob->getDurations(iPreset) * theJob->getScores(iPreset);
+                if (inSettings.csv)
+                {
+                    *theCSVFiles[iPreset] << theJob->getCSVRows(iPreset) << std::flush;
+                }
+            }
+            ioRunLog.record(iJob, *theJob);
+            theJob->releaseResults();
+        }
+    }
+    deleteWorkerEvaluations(theWorkerEvaluations);
+
+    for (size_t iPreset = 0; iPreset < inPresets.size(); ++iPreset)
+    {
+        const string theHeader = inTitle + " " + inPresets[iPreset];
+        inOutputStream << string(theHeader.size()+4,'*') << "\n* " << theHeader << " *\n" << string(theHeader.size()+4,'*') << endl;
+        inOutputStream << "Weighted average score (%)" << endl;
+        printConfusionMatrix(inOutputStream, 100 * theTotalWeightedScores[iPreset] / theTotalDurations[iPreset], inAnnotationNames);
+        inOutputStream << "\nAverage score (%)" << endl;
+        printConfusionMatrix(inOutputStream, 100 * theTotalScores[iPreset] / static_cast<double>(inListItems.size() - ioRunLog.getNumOfFailures()), inAnnotationNames);
+        inOutputStream << "\nDuration of evaluated segments (s)" << endl;
+        printConfusionMatrix(inOutputStream, theTotalDurations[iPreset], inAnnotationNames);
+        inOutputStream << endl;
+    }
+}
+
+/**	Start point of the program. */
+int main(int inNumOfArguments,char* inArguments[])
+{ try {
+
+	path theOutputPath;
+	path theListPath;
+	path theRefDirPath;
+	path theTestDirPath;
+	string theRefExt;
+	string theTestExt;
+    string theRefFormat;
+    string theTestFormat;
+	double theBegin;
+	double theEnd;
+    double theMinRefDuration;
+    double theMaxRefDuration;
+	double theDelay;
+	variables_map theVarMap;
+
+	parseCommandLine(inNumOfArguments, inArguments, theOutputPath, theListPath,
+		theRefDirPath, theTestDirPath, theRefExt, theTestExt, theRefFormat, theTestFormat,
+		theBegin, theEnd, theMinRefDuration, theMaxRefDuration, theDelay, theVarMap);
+    size_t theNumOfChunks = theVarMap["chunks"].as<size_t>();
+    if (theNumOfChunks == 0)
+    {
+        theNumOfChunks = std::max(boost::thread::hardware_concurrency(), 1u);
+    }
+    if (theVarMap.count("serve") > 0)
+    {
+        // Every job sets the formats and times of its own
+        EvaluationSettings theSettings;
+        theSettings.numOfChunks = theNumOfChunks;
+        theSettings.verbose = false;
+        theSettings.csv = false;
+        if (theVarMap.count("cache") > 0)
+        {
+            theSettings.sequenceCache.reset(new SequenceCache(theVarMap["cache"].as<path>()));
+        }
+        serveJobs(theVarMap["serve"].as<path>(), theSettings);
+        return 0;
+    }
+    path theConfusionPath;
+    if (theVarMap.count("confusion") > 0)
+    {
+        theConfusionPath = theVarMap["confusion"].as<path>();
+    }
+    // Every shard writes output files of its own
+    size_t theShardIndex = 0;
+    size_t theNumOfShards = 1;
+    if (theVarMap.count("shard") > 0)
+    {
+        parseShard(theVarMap["shard"].as<string>(), theShardIndex, theNumOfShards);
+        const string theShardSuffix = "-shard" + boost::lexical_cast<string>(theShardIndex + 1) + "of" + boost::lexical_cast<string>(theNumOfShards);
+        theOutputPath = addSuffix(theOutputPath, theShardSuffix);
+        if (!theConfusionPath.empty())
+        {
+            theConfusionPath = addSuffix(theConfusionPath, theShardSuffix);
+        }
+    }
+
+	string theCSVSeparator = ",";
+    string theCSVQuotes = "\"";
+    
+	double theTotalDuration;
+	Eigen::ArrayXXd theGlobalConfusionMatrix;
+	vector<string> theLabels;
+	string theLeaderboardTitle;
+	vector<string> theLeaderboardPresets;
+	vector<vector<double> > theLeaderboardScores;
+    
+    // Every test directory holds the output of a different system
+    const vector<path> theTestDirPaths = theVarMap.count("list") > 0 ? theVarMap["testdir"].as<vector<path> >() : vector<path>(1, theTestDirPath);
+    const size_t theNumOfSystems = theTestDirPaths.size();
+    vector<string> theSystemNames(theNumOfSystems);
+    for (size_t iSystem = 0; iSystem < theNumOfSystems; ++iSystem)
+    {
+        theSystemNames[iSystem] = getSystemName(theTestDirPaths[iSystem]);
+    }
+    vector<ListItem> theListItems;
+    if (theVarMap.count("manifest") > 0)
+    {
+        theListPath = theVarMap["manifest"].as<path>();
+        theListItems = readManifest(theListPath, theBegin, theEnd);
+    }
+    else
+    {
+        vector<string> theBaseNames = readList(theListPath);
+        theListItems = constructListItems(theBaseNames, theRefDirPath, theRefExt, theTestDirPaths, theTestExt, theVarMap, theBegin, theEnd);
+    }
+    
+    EvaluationSettings theSettings;
+    theSettings.refFormat = theRefFormat;
+    theSettings.testFormat = theTestFormat;
+    theSettings.minRefDuration = theMinRefDuration;
+    theSettings.maxRefDuration = theMaxRefDuration;
+    theSettings.delay = theDelay;
+    theSettings.numOfChunks = theNumOfChunks;
+    theSettings.verbose = theVarMap.count("verbose") > 0;
+    theSettings.csv = theVarMap.count("csv") > 0;
+    theSettings.outputDir = theOutputPath.parent_path();
+    theSettings.csvSeparator = theCSVSeparator;
+    theSettings.csvQuotes = theCSVQuotes;
+    theSettings.systemSuffixes = createOutputSuffixes(theSystemNames);
+    if (theVarMap.count("cache") > 0)
+    {
+        theSettings.sequenceCache.reset(new SequenceCache(theVarMap["cache"].as<path>()));
+    }
+    if (theVarMap.count("store") > 0)
+    {
+        theSettings.resultStore.reset(new ResultStore(theVarMap["store"].as<path>()));
+    }
+    if (theVarMap.count("list") > 0 && theVarMap.count("merge") == 0)
+    {
+        vector<path> theDirPaths = theTestDirPaths;
+        theDirPaths.push_back(theRefDirPath);
+        if (theVarMap.count("timingdir") > 0)
+        {
+            theDirPaths.push_back(theVarMap["timingdir"].as<path>());
+        }
+        for (size_t i = 0; i < theDirPaths.size(); ++i)
+        {
+            if (boost::filesystem::is_regular_file(theDirPaths[i]))
+            {
+                theSettings.archives.push_back(boost::shared_ptr<const TarArchive>(new TarArchive(theDirPaths[i])));
+            }
+        }
+    }
+    RunLog theRunLog;
+    // A shard describes the whole run, such that the journals of all shards match
+    string theRunDescription;
+    const bool hasJournal = theVarMap.count("journal") > 0 || theVarMap.count("resume") > 0 || theVarMap.count("shard") > 0;
+    if (hasJournal || theVarMap.count("merge") > 0)
+    {
+        theRunDescription = describeRun(theVarMap, theListItems, theSettings);
+    }
+    if (theVarMap.count("shard") > 0)
+    {
+        theListItems = theRunLog.shard(theListItems, theShardIndex, theNumOfShards);
+    }
+    if (theVarMap.count("keepgoing") > 0)
+    {
+        theRunLog.keepGoing(addSuffix(theOutputPath, "-errors"));
+    }
+    if (!theListPath.empty() && theVarMap.count("merge") == 0)
+    {
+        validateListItems(theListItems, theSettings, theVarMap.count("keepgoing") > 0);
+    }
+    if (hasJournal)
+    {
+        theRunLog.keepJournal(path(theOutputPath).replace_extension("journal"), theRunDescription, theVarMap.count("resume") > 0);
+    }
+    else if (theVarMap.count("merge") > 0)
+    {
+        theRunLog.mergeJournals(theVarMap["merge"].as<vector<path> >(), theRunDescription);
+    }
+    
+    // Evaluate in parallel on request, otherwise run every item on this thread
+    size_t theNumOfThreads = theVarMap["jobs"].as<size_t>();
+    if (theNumOfThreads == 0)
+    {
+        theNumOfThreads = std::max(boost::thread::hardware_concurrency(), 1u);
+    }
+    vector<size_t> theSchedule(theListItems.size());
+    // Merging does not evaluate anything
+    if (theNumOfThreads > 1 && theVarMap.count("merge") == 0)
+    {
+        theSchedule = scheduleLargestFirst(theListItems, theSettings);
+    }
+    else
+    {
+        theNumOfThreads = 0;
+        for (size_t i = 0; i < theSchedule.size(); ++i)
+        {
+            theSchedule[i] = i;
+        }
+    }
+    const size_t theNumOfWorkers = std::max<size_t>(theNumOfThreads, 1);
+    const size_t theReadAhead = theVarMap["readahead"].as<size_t>();
+    // Bounds the number of evaluated items waiting to be written out in list order,
+    // while leaving room for the items that are read ahead
+    const size_t theMaxLookAhead = std::max(16 * theNumOfWorkers, theReadAhead + theNumOfWorkers);
+    
+    // Every system and chord preset gets an output file of its own when there are several,
+    // the output file itself then ranks the systems
+    const size_t theNumOfPresets = theVarMap.count("chords") > 0 ? theVarMap["chords"].as<vector<string> >().size() : 1;
+    const bool hasSeparateOutputFiles = theNumOfSystems * theNumOfPresets > 1;
+	ofstream theOutputFile;
+    if (theNumOfSystems > 1 || theNumOfPresets == 1 || theVarMap.count("agreement") > 0)
+    {
+        openOutputFile(theOutputFile, theOutputPath, theListPath, theRefDirPath, theTestDirPath);
+    }
+
+	/*************/
+	/* Agreement */
+	/*************/
+	if (theVarMap.count("agreement") > 0)
+	{
+        vector<string> theAnnotationNames(1, getSystemName(theRefDirPath));
+        theAnnotationNames.insert(theAnnotationNames.end(), theSystemNames.begin(), theSystemNames.end());
+        if (theVarMap.count("keys") > 0)
+        {
+            evaluateAgreement<Key>(theOutputFile, "Keys", vector<string>(1, theVarMap["keys"].as<string>()), theAnnotationNames,
+                theListItems, theSettings, theOutputPath, theSchedule, theNumOfThreads, theMaxLookAhead, theReadAhead, theRunLog);
+        }
+        else if (theVarMap.count("chords") > 0)
+        {
+            evaluateAgreement<Chord>(theOutputFile, "Chords", theVarMap["chords"].as<vector<string> >(), theAnnotationNames,
+                theListItems, theSettings, theOutputPath, theSchedule, theNumOfThreads, theMaxLookAhead, theReadAhead, theRunLog);
+        }
+        else
+        {
+            evaluateAgreement<Note>(theOutputFile, "Notes", vector<string>(1, theVarMap["notes"].as<string>()), theAnnotationNames,
+                theListItems, theSettings, theOutputPath, theSchedule, theNumOfThreads, theMaxLookAhead, theReadAhead, theRunLog);
+        }
+	}
+	/**********************/
+	/* Keys or global key */
+	/**********************/
+	else if (theVarMap.count("keys") > 0 || theVarMap.count("globalkey") > 0)
+	{
+		const string theKeyMode = theVarMap.count("keys") > 0 ? theVarMap["keys"].as<string>() : theVarMap["globalkey"].as<string>();
+		vector<PairwiseEvaluation<Key>*> theKeyEvaluations(theNumOfSystems);
+		for (size_t iSystem = 0; iSystem < theNumOfSystems; ++iSystem)
+		{
+			theKeyEvaluations[iSystem] = new PairwiseEvaluation<Key>(theKeyMode);
+		}
+        theLabels.resize(theKeyEvaluations.front()->getNumOfTestLabels());
+        std::transform(theKeyEvaluations.front()->getLabels().begin(), theKeyEvaluations.front()->getLabels().end(), theLabels.begin(), std::mem_fun_ref(&MusOO::KeyQMUL::str));
+
+		vector<boost::shared_ptr<ofstream> > theCSVFiles(theNumOfSystems);
+		// Kept to rewrite the CSV files during a watch
+		vector<vector<string> > theCSVHeaders(theNumOfSystems);
+		for (size_t iSystem = 0; iSystem < theNumOfSystems; ++iSystem)
+		{
+			theCSVFiles[iSystem].reset(new ofstream);
+			if (theVarMap.count("csv") > 0)
+			{
+				ofstream& theCSVFile = *theCSVFiles[iSystem];
+				theCSVFile.open(addSuffix(theOutputPath, theSettings.systemSuffixes[iSystem]).replace_extension("csv"));
+				std::ostringstream theCSVHeader;
+				theCSVHeader << theKeyMode << endl;
+				if (theVarMap.count("keys") > 0)
 				{
-					KeyEvaluationStats theStats(theKeyEvaluation->getConfusionMatrix());
-					theCSVFile << theCSVQuotes << *i << theCSVQuotes << theCSVSeparator 
-						<< 100*theKeyEvaluation->getScore() << theCSVSeparator
-						<< theKeyEvaluation->getDuration() << theCSVSeparator
-						<< theStats.getNumOfUniquesInRef() << theCSVSeparator
-                        << theStats.getNumOfUniquesInTest() << theCSVSeparator
-                        << theStats.getCorrectKeys() << theCSVSeparator
-                        << theStats.getAdjacentKeys() << theCSVSeparator
-                        << theStats.getRelativeKeys() << theCSVSeparator
-                        << theStats.getParallelKeys() << theCSVSeparator
-                        << theStats.getChromaticKeys() << endl;
+					theCSVHeader << "File" << theCSVSeparator << "Pairwise score (%)"
+						<< theCSVSeparator << "Duration (s)"
+						<< theCSVSeparator << "Unique ref keys"
+						<< theCSVSeparator << "Unique test keys"
+						<< theCSVSeparator << "Correct keys"
+						<< theCSVSeparator << "Adjacent keys"
+						<< theCSVSeparator << "Relative keys"
+						<< theCSVSeparator << "Parallel keys"
+						<< theCSVSeparator << "Chromatic keys" << endl;
 				}
-			}
-			else
-			{
-				SimilarityScoreKey theSimilarityScoreKey(theVarMap["globalkey"].as<string>());
-				Key theGlobalRefKey = findLongestKey(theRefKeys);
-				Key theGlobalTestKey = findLongestKey(theTestKeys);
-				double theScore = theSimilarityScoreKey.score(theGlobalRefKey, theGlobalTestKey);
-                theGlobalKeyScore += theScore;
-				++theGlobalConfusionMatrix(theSimilarityScoreKey.getRefIndex(), theSimilarityScoreKey.getTestIndex());
-				if (theVarMap.count("csv") > 0)
+				else
 				{
-					theCSVFile << theCSVQuotes << *i << theCSVQuotes << theCSVSeparator 
-						<< theScore << theCSVSeparator
-						<< KeyQMUL(theGlobalRefKey).str() << theCSVSeparator
-						<< KeyQMUL(theGlobalTestKey).str() << endl;
+					theCSVHeader << "File" 
+						<< theCSVSeparator << "Score" 
+						<< theCSVSeparator << "Ref key" 
+						<< theCSVSeparator << "Test key" << endl;
 				}
+				theCSVHeaders[iSystem].assign(1, theCSVHeader.str());
+				theCSVFile << theCSVHeaders[iSystem].front() << std::fixed;
 			}
- 		}
-        
-        // Global output file
-        string theUnit;
-		if (theVarMap.count("keys") > 0)
-		{
-            theUnit = " s";
-            theTotalDuration = theKeyEvaluation->calcTotalDuration();
-            theGlobalConfusionMatrix = theKeyEvaluation->calcTotalConfusionMatrix();
-			string theKeyMode = theVarMap["keys"].as<string>();
-			theOutputFile << string(theKeyMode.size()+9,'*') << "\n* Keys " << theKeyMode << " *\n" << string(theKeyMode.size()+9,'*') << endl;
-            theOutputFile << "Duration of evaluated keys: " << theTotalDuration << " s" << endl;
-            theOutputFile << "Average score: " << 100 * theKeyEvaluation->calcWeightedAverageScore() << "%\n" << endl;
-		}
-		else
-        {
-            theTotalDuration = theListItems.size();
-            theGlobalKeyScore /= theTotalDuration;
-			string theGlobalKeyMode = theVarMap["globalkey"].as<string>();
-			theOutputFile << string(theGlobalKeyMode.size()+15,'*') << "\n* Global key " << theGlobalKeyMode << " *\n" << string(theGlobalKeyMode.size()+15,'*') << endl;
-            theOutputFile << "Number of evaluated files: " << theTotalDuration << endl;
-            theOutputFile << "Average score: " << 100 * theGlobalKeyScore << "%\n" << endl;
 		}
         
-		KeyEvaluationStats theGlobalStats(theGlobalConfusionMatrix);
-        theOutputFile << "Correct keys: " << printResultLine(theGlobalStats.getCorrectKeys(), theTotalDuration, theUnit) << endl;
-        theOutputFile << "Adjacent keys: " << printResultLine(theGlobalStats.getAdjacentKeys(), theTotalDuration, theUnit) << endl;
-        theOutputFile << "Relative keys: " << printResultLine(theGlobalStats.getRelativeKeys(), theTotalDuration, theUnit) << endl;
-        theOutputFile << "Parallel keys: " << printResultLine(theGlobalStats.getParallelKeys(), theTotalDuration, theUnit) << endl;
-        theOutputFile << "Chromatic keys: " << printResultLine(theGlobalStats.getChromaticKeys(), theTotalDuration, theUnit) << endl;
-        
+        theGlobalConfusionMatrix = Eigen::ArrayXXd::Zero(theKeyEvaluations.front()->getNumOfRefLabels(), theKeyEvaluations.front()->getNumOfTestLabels());
+        double theGlobalKeyScore = 0.;
+        // The jobs of a watch get evaluated again after the run
+        const vector<string> thePresets(1, theKeyMode);
+        const vector<string> theSuffixes = createOutputSuffixes(thePresets);
+        vector<vector<PairwiseEvaluation<Key>*> > theWorkerEvaluations;
+        vector<PairwiseJob<Key> > theJobs;
+        boost::shared_ptr<PairwiseWatch<Key> > theWatch;
 		if (theVarMap.count("keys") > 0)
 		{
-            theOutputFile << "Deleted keys: " << printResultLine(theGlobalStats.getKeyDeletions(), theTotalDuration, theUnit) << endl;
-            theOutputFile << "\nCorrect no-keys: " << printResultLine(theGlobalStats.getCorrectNoKeys(), theTotalDuration, theUnit) << endl;
-            theOutputFile << "Inserted keys: " << printResultLine(theGlobalStats.getKeyInsertions(), theTotalDuration, theUnit) << endl;
-		}
+            theWorkerEvaluations = createWorkerEvaluations<Key>(theNumOfWorkers, thePresets);
+            for (vector<ListItem>::const_iterator i = theListItems.begin(); i != theListItems.end(); ++i)
+            {
+                theJobs.push_back(PairwiseJob<Key>(*i, theSettings, theWorkerEvaluations, thePresets, theSuffixes));
+            }
+            theRunLog.restore(theJobs);
+            if (theVarMap.count("watch") > 0)
+            {
+                vector<vector<PairwiseEvaluation<Key>*> > theTotals(theNumOfSystems);
+                for (size_t iSystem = 0; iSystem < theNumOfSystems; ++iSystem)
+                {
+                    theTotals[iSystem].assign(1, theKeyEvaluations[iSystem]);
+                }
+                theWatch.reset(new PairwiseWatch<Key>(theJobs, theListItems, theTotals, createCSVPaths(theOutputPath, theSettings, theSuffixes), theCSVHeaders));
+            }
+            {
+                JobPool<PairwiseJob<Key> > thePool(theJobs, theSchedule, theNumOfThreads, theMaxLookAhead, theReadAhead);
+                for (size_t iJob = 0; iJob < theJobs.size(); ++iJob)
+                {
+                    cout << "Evaluating file " << theJobs[iJob].getName() << endl;
+                    PairwiseJob<Key>* theJob = theRunLog.wait(thePool, theJobs, iJob);
+                    if (theJob == NULL)
+                    {
+                        continue;
+                    }
+                    for (size_t iSystem = 0; iSystem < theNumOfSystems; ++iSystem)
+                    {
+                        theJob->commitResults(*theKeyEvaluations[iSystem], iSystem);
+                        *theCSVFiles[iSystem] << theJob->getCSVRow(iSystem) << std::flush;
+                    }
+                    theRunLog.record(iJob, *theJob);
+                    if (theWatch)
+                    {
+                        theWatch->keep(iJob);
+                    }
+                    else
+                    {
+                        theJob->releaseResults();
+                    }
+                }
+            }
+        }
+        else
+        {
+            vector<GlobalKeyJob> theJobs;
+            for (vector<ListItem>::const_iterator i = theListItems.begin(); i != theListItems.end(); ++i)
+            {
+                theJobs.push_back(GlobalKeyJob(*i, theSettings, theKeyMode));
+            }
+            theRunLog.restore(theJobs);
+            JobPool<GlobalKeyJob> thePool(theJobs, theSchedule, theNumOfThreads, theMaxLookAhead, theReadAhead);
+            for (size_t iJob = 0; iJob < theJobs.size(); ++iJob)
+            {
+                cout << "Evaluating file " << theJobs[iJob].getName() << endl;
+                GlobalKeyJob* theJob = theRunLog.wait(thePool, theJobs, iJob);
+                if (theJob == NULL)
+                {
+                    continue;
+                }
+                theGlobalKeyScore += theJob->getScore();
+                ++theGlobalConfusionMatrix(theJob->getRefIndex(), theJob->getTestIndex());
+                *theCSVFiles.front() << theJob->getCSVRow() << std::flush;
+                theRunLog.record(iJob, *theJob);
+            }
+ 		}
+        theCSVFiles.clear();
         
-        theOutputFile << "\nResults per mode\n" << "----------------" << endl;
-        const Eigen::ArrayXXd theResultsPerMode = theGlobalStats.getCorrectKeysPerMode();
-        for (Eigen::ArrayXXd::Index iMode = 0; iMode < theResultsPerMode.rows(); ++iMode)
+        theLeaderboardTitle = theVarMap.count("keys") > 0 ? "Keys" : "Global key";
+        theLeaderboardPresets.assign(1, theKeyMode);
+        theLeaderboardScores.assign(theNumOfSystems, vector<double>(1));
+        // A watch reports again after every update
+        while (true)
+        {
+            for (size_t iSystem = 0; iSystem < theNumOfSystems; ++iSystem)
+            {
+                const PairwiseEvaluation<Key>& theKeyEvaluation = *theKeyEvaluations[iSystem];
+                // Global output file
+                ofstream theSystemOutputFile;
+                if (hasSeparateOutputFiles)
+                {
+                    openOutputFile(theSystemOutputFile, addSuffix(theOutputPath, theSettings.systemSuffixes[iSystem]), theListPath, theRefDirPath, theTestDirPaths[iSystem]);
+                }
+                ofstream& theKeyOutputFile = hasSeparateOutputFiles ? theSystemOutputFile : theOutputFile;
+                string theUnit;
+                if (theVarMap.count("keys") > 0)
+                {
+                    theUnit = " s";
+                    theTotalDuration = theKeyEvaluation.calcTotalDuration();
+                    theGlobalConfusionMatrix = theKeyEvaluation.calcTotalConfusionMatrix();
+                    theLeaderboardScores[iSystem][0] = theKeyEvaluation.calcWeightedAverageScore();
+                    theKeyOutputFile << string(theKeyMode.size()+9,'*') << "\n* Keys " << theKeyMode << " *\n" << string(theKeyMode.size()+9,'*') << endl;
+                    theKeyOutputFile << "Duration of evaluated keys: " << theTotalDuration << " s" << endl;
+                    theKeyOutputFile << "Average score: " << 100 * theKeyEvaluation.calcWeightedAverageScore() << "%\n" << endl;
+                }
+                else
+                {
+                    theTotalDuration = theListItems.size() - theRunLog.getNumOfFailures();
+                    theGlobalKeyScore /= theTotalDuration;
+                    theLeaderboardScores[iSystem][0] = theGlobalKeyScore;
+                    theKeyOutputFile << string(theKeyMode.size()+15,'*') << "\n* Global key " << theKeyMode << " *\n" << string(theKeyMode.size()+15,'*') << endl;
+                    theKeyOutputFile << "Number of evaluated files: " << theTotalDuration << endl;
+                    theKeyOutputFile << "Average score: " << 100 * theGlobalKeyScore << "%\n" << endl;
+                }
+            
+                KeyEvaluationStats theGlobalStats(theGlobalConfusionMatrix);
+                theKeyOutputFile << "Correct keys: " << printResultLine(theGlobalStats.getCorrectKeys(), theTotalDuration, theUnit) << endl;
+                theKeyOutputFile << "Adjacent keys: " << printResultLine(theGlobalStats.getAdjacentKeys(), theTotalDuration, theUnit) << endl;
+                theKeyOutputFile << "Relative keys: " << printResultLine(theGlobalStats.getRelativeKeys(), theTotalDuration, theUnit) << endl;
+                theKeyOutputFile << "Parallel keys: " << printResultLine(theGlobalStats.getParallelKeys(), theTotalDuration, theUnit) << endl;
+                theKeyOutputFile << "Chromatic keys: " << printResultLine(theGlobalStats.getChromaticKeys(), theTotalDuration, theUnit) << endl;
+            
+                if (theVarMap.count("keys") > 0)
+                {
+                    theKeyOutputFile << "Deleted keys: " << printResultLine(theGlobalStats.getKeyDeletions(), theTotalDuration, theUnit) << endl;
+                    theKeyOutputFile << "\nCorrect no-keys: " << printResultLine(theGlobalStats.getCorrectNoKeys(), theTotalDuration, theUnit) << endl;
+                    theKeyOutputFile << "Inserted keys: " << printResultLine(theGlobalStats.getKeyInsertions(), theTotalDuration, theUnit) << endl;
+                }
+            
+                theKeyOutputFile << "\nResults per mode\n" << "----------------" << endl;
+                const Eigen::ArrayXXd theResultsPerMode = theGlobalStats.getCorrectKeysPerMode();
+                for (Eigen::ArrayXXd::Index iMode = 0; iMode < theResultsPerMode.rows(); ++iMode)
+                {
+                    theKeyOutputFile << ModeQMUL(theKeyEvaluation.getLabels()[iMode].mode()) << ": "
+                        << printResultLine(theResultsPerMode(iMode,0), theResultsPerMode(iMode,1), theUnit) << " of "
+                        << printResultLine(theResultsPerMode(iMode,1), theTotalDuration, theUnit) << endl;
+                }
+            
+                // Confusion matrix
+                if (theVarMap.count("confusion") > 0)
+                {
+                    ofstream theConfusionMatrixFile;
+                    openConfusionMatrixFile(theConfusionMatrixFile, addSuffix(theConfusionPath, theSettings.systemSuffixes[iSystem]));
+                    printConfusionMatrix(theConfusionMatrixFile, theGlobalConfusionMatrix, theLabels);
+                }
+            }
+            if (!theWatch)
+            {
+                break;
+            }
+            if (theNumOfSystems > 1)
+            {
+                writeLeaderboard(theOutputFile, theOutputPath, theLeaderboardTitle, theLeaderboardPresets, theSystemNames, theLeaderboardScores, theSettings);
+            }
+            theWatch->update();
+            if (theOutputFile.is_open())
+            {
+                theOutputFile.close();
+                openOutputFile(theOutputFile, theOutputPath, theListPath, theRefDirPath, theTestDirPath);
+            }
+        }
+        for (size_t iSystem = 0; iSystem < theNumOfSystems; ++iSystem)
         {
-            theOutputFile << ModeQMUL(theKeyEvaluation->getLabels()[iMode].mode()) << ": "
-                << printResultLine(theResultsPerMode(iMode,0), theResultsPerMode(iMode,1), theUnit) << " of "
-                << printResultLine(theResultsPerMode(iMode,1), theTotalDuration, theUnit) << endl;
+            delete theKeyEvaluations[iSystem];
         }
-		delete theKeyEvaluation;
+        deleteWorkerEvaluations(theWorkerEvaluations);
 	}
 	/**********/
 	/* Chords */
 	/**********/
 	else if (theVarMap.count("chords") > 0)
 	{
-		PairwiseEvaluation<Chord> theChordEvaluation(theVarMap["chords"].as<string>());
-        theLabels.resize(theChordEvaluation.getNumOfTestLabels());
-        std::transform(theChordEvaluation.getLabels().begin(), theChordEvaluation.getLabels().end(), theLabels.begin(), std::mem_fun_ref(&MusOO::ChordQMUL::str));
-        const size_t numChordTypes = theChordEvaluation.getNumOfRefLabels()/12;
-        vector<size_t> cardinalities(numChordTypes);
-        std::transform(theChordEvaluation.getLabels().begin(), theChordEvaluation.getLabels().begin()+numChordTypes, cardinalities.begin(), std::mem_fun_ref(&MusOO::Chord::cardinality));
-        const size_t maxCardinality = *std::max_element(cardinalities.begin(), cardinalities.end());
-        const size_t minCardinality = *std::min_element(cardinalities.begin(), cardinalities.end());
-
-		ofstream theCSVFile;
-		if (theVarMap.count("csv") > 0)
-		{
-			theCSVFile.open(path(theOutputPath).replace_extension("csv"));
-			theCSVFile << theVarMap["chords"].as<string>() << endl;
-			theCSVFile << "File" 
-				<< theCSVSeparator << "Pairwise score (%)"
-                << theCSVSeparator << "Duration (s)"
-                << theCSVSeparator << "Correct chords (%)"
-                << theCSVSeparator << "Substituted chords (%)"
-                << theCSVSeparator << "Deleted chords (%)"
-                << theCSVSeparator << "Inserted chords (%)"
-                << theCSVSeparator << "Correct no-chords (%)";
-            for (size_t iChordType = 0; iChordType < numChordTypes; ++iChordType)
-            {
-                theCSVFile << theCSVSeparator << theCSVQuotes << ChordTypeQMUL(theChordEvaluation.getLabels()[iChordType].type()) << " correct (%)" << theCSVQuotes << theCSVSeparator << theCSVQuotes << ChordTypeQMUL(theChordEvaluation.getLabels()[iChordType].type()) << " proportion (%)" << theCSVQuotes;
-            }
-            for (size_t iNumOfWrongChromas = 0; iNumOfWrongChromas <= maxCardinality; ++iNumOfWrongChromas)
-            {
-                theCSVFile << theCSVSeparator << iNumOfWrongChromas << " chroma" << (iNumOfWrongChromas==1?"":"s") << " wrong (%)";
-            }
-            theCSVFile
-				<< theCSVSeparator << "Both correct (%)"
-				<< theCSVSeparator << "Only root correct (%)"
-				<< theCSVSeparator << "Only type correct (%)"
-				<< theCSVSeparator << "Both wrong (%)"
-				<< theCSVSeparator << "Unique ref chords"
-				<< theCSVSeparator << "Unique test chords" << endl;
-			theCSVFile << std::fixed;
-		}
-
-		for (vector<string>::iterator i = theListItems.begin(); i != theListItems.end(); ++i)
-		{
-            constructPaths(*i, theRefDirPath, theRefExt, theTestDirPath, theTestExt, theVarMap, theRefPath, theTestPath, theBegin, theEnd);
-			cout << "Evaluating file " << *i << endl;
-            
-			TimedChordSequence theRefChords = ChordFileUtil::readChordSequenceFromFile(theRefPath, true, theRefFormat);
-            TimedChordSequence theTestChords = ChordFileUtil::readChordSequenceFromFile(theTestPath, false, theTestFormat);
+        const vector<string>& theChordModes = theVarMap["chords"].as<vector<string> >();
+        const vector<string> theSuffixes = createOutputSuffixes(theChordModes);
+        vector<vector<PairwiseEvaluation<Chord>*> > theChordEvaluations(theNumOfSystems, vector<PairwiseEvaluation<Chord>*>(theChordModes.size()));
+        vector<vector<boost::shared_ptr<ofstream> > > theCSVFiles(theNumOfSystems, vector<boost::shared_ptr<ofstream> >(theChordModes.size()));
+        // Kept to rewrite the CSV files during a watch
+        vector<vector<string> > theCSVHeaders(theNumOfSystems, vector<string>(theChordModes.size()));
+        for (size_t iSystem = 0; iSystem < theNumOfSystems; ++iSystem)
+        {
+            for (size_t iPreset = 0; iPreset < theChordModes.size(); ++iPreset)
+            {
+                theChordEvaluations[iSystem][iPreset] = new PairwiseEvaluation<Chord>(theChordModes[iPreset]);
+                theCSVFiles[iSystem][iPreset].reset(new ofstream);
+                if (theVarMap.count("csv") > 0)
+                {
+                    theCSVFiles[iSystem][iPreset]->open(addSuffix(theOutputPath, theSettings.systemSuffixes[iSystem] + theSuffixes[iPreset]).replace_extension("csv"));
+                    std::ostringstream theCSVHeader;
+                    printChordCSVHeader(theCSVHeader, *theChordEvaluations[iSystem][iPreset], theChordModes[iPreset], theCSVSeparator, theCSVQuotes);
+                    theCSVHeaders[iSystem][iPreset] = theCSVHeader.str();
+                    *theCSVFiles[iSystem][iPreset] << theCSVHeaders[iSystem][iPreset];
+                }
+            }
+        }
 
-            ofstream theVerboseStream;
-            if (theVarMap.count("verbose"))
+        vector<vector<PairwiseEvaluation<Chord>*> > theWorkerEvaluations = createWorkerEvaluations<Chord>(theNumOfWorkers, theChordModes);
+        vector<PairwiseJob<Chord> > theJobs;
+        for (vector<ListItem>::const_iterator i = theListItems.begin(); i != theListItems.end(); ++i)
+        {
+            theJobs.push_back(PairwiseJob<Chord>(*i, theSettings, theWorkerEvaluations, theChordModes, theSuffixes));
+        }
+        theRunLog.restore(theJobs);
+        boost::shared_ptr<PairwiseWatch<Chord> > theWatch;
+        if (theVarMap.count("watch") > 0)
+        {
+            theWatch.reset(new PairwiseWatch<Chord>(theJobs, theListItems, theChordEvaluations, createCSVPaths(theOutputPath, theSettings, theSuffixes), theCSVHeaders));
+        }
+        {
+            JobPool<PairwiseJob<Chord> > thePool(theJobs, theSchedule, theNumOfThreads, theMaxLookAhead, theReadAhead);
+            for (size_t iJob = 0; iJob < theJobs.size(); ++iJob)
             {
-                path theVerbosePath = theOutputPath.parent_path() / path(*i + ".csv");
-                theVerboseStream.open(theVerbosePath);
-                theVerboseStream << "Start" << theCSVSeparator << "End" << theCSVSeparator << "RefLabel" << theCSVSeparator << "TestLabel" << theCSVSeparator << "Score" << theCSVSeparator << "Duration" << theCSVSeparator << "MappedRefLabel" << theCSVSeparator << "MappedTestLabel" << theCSVSeparator << "RefChromas" << theCSVSeparator << "TestChromas" << theCSVSeparator << "NumCommonChromas" << theCSVSeparator << "RefBass" << theCSVSeparator << "TestBass" << endl;
+                cout << "Evaluating file " << theJobs[iJob].getName() << endl;
+                PairwiseJob<Chord>* theJob = theRunLog.wait(thePool, theJobs, iJob);
+                if (theJob == NULL)
+                {
+                    continue;
+                }
+                for (size_t iSystem = 0; iSystem < theNumOfSystems; ++iSystem)
+                {
+                    for (size_t iPreset = 0; iPreset < theChordModes.size(); ++iPreset)
+                    {
+                        theJob->commitResults(*theChordEvaluations[iSystem][iPreset], iSystem, iPreset);
+                        *theCSVFiles[iSystem][iPreset] << theJob->getCSVRow(iSystem, iPreset) << std::flush;
+                    }
+                }
+                theRunLog.record(iJob, *theJob);
+                if (theWatch)
+                {
+                    theWatch->keep(iJob);
+                }
+                else
+                {
+                    theJob->releaseResults();
+                }
             }
-			theChordEvaluation.addSequencePair(theRefChords, theTestChords, theBegin, theEnd, theVerboseStream, theMinRefDuration, theMaxRefDuration, theDelay);
-			
-			if (theVarMap.count("csv") > 0)
-			{
-                theCSVFile << theCSVQuotes << *i << theCSVQuotes << theCSVSeparator;
-                ChordEvaluationStats theStats(theChordEvaluation.getConfusionMatrix(), theChordEvaluation.getLabels());
-                double theDuration = theChordEvaluation.getDuration();
-				if (theDuration > 0.)
-				{
-					theCSVFile << 100*theChordEvaluation.getScore() << theCSVSeparator << theDuration;
-                    theCSVFile
-                        << theCSVSeparator << 100*theStats.getCorrectChords()/theDuration
-                        << theCSVSeparator << 100*theStats.getChordSubstitutions()/theDuration
-                        << theCSVSeparator << 100*theStats.getChordDeletions()/theDuration
-                        << theCSVSeparator << 100*theStats.getChordInsertions()/theDuration
-                        << theCSVSeparator << 100*theStats.getCorrectNoChords()/theDuration;
-                    const Eigen::ArrayXXd theResultsPerType = theStats.getCorrectChordsPerType();
-                    for (Eigen::ArrayXXd::Index iChordType = 0; iChordType < theResultsPerType.rows(); ++iChordType)
+        }
+        theCSVFiles.clear();
+        
+        theLeaderboardTitle = "Chords";
+        theLeaderboardPresets = theChordModes;
+        theLeaderboardScores.assign(theNumOfSystems, vector<double>(theChordModes.size()));
+        // A watch reports again after every update
+        while (true)
+        {
+            for (size_t iSystem = 0; iSystem < theNumOfSystems; ++iSystem)
+            {
+                for (size_t iPreset = 0; iPreset < theChordModes.size(); ++iPreset)
+                {
+                    const PairwiseEvaluation<Chord>& theChordEvaluation = *theChordEvaluations[iSystem][iPreset];
+                    const string theSuffix = theSettings.systemSuffixes[iSystem] + theSuffixes[iPreset];
+                    theLeaderboardScores[iSystem][iPreset] = theChordEvaluation.calcWeightedAverageScore();
+                    // Global output file
+                    ofstream theSeparateOutputFile;
+                    if (hasSeparateOutputFiles)
                     {
-                        theCSVFile
-                            << theCSVSeparator << 100*theResultsPerType(iChordType,0)/theResultsPerType(iChordType,1)
-                            << theCSVSeparator << 100*theResultsPerType(iChordType,1)/theDuration;
+                        openOutputFile(theSeparateOutputFile, addSuffix(theOutputPath, theSuffix), theListPath, theRefDirPath, theTestDirPaths[iSystem]);
                     }
-                    for (size_t iNumOfWrongChromas = 0; iNumOfWrongChromas <= maxCardinality; ++iNumOfWrongChromas)
+                    ofstream& theChordOutputFile = hasSeparateOutputFiles ? theSeparateOutputFile : theOutputFile;
+                    theLabels.resize(theChordEvaluation.getNumOfTestLabels());
+                    std::transform(theChordEvaluation.getLabels().begin(), theChordEvaluation.getLabels().end(), theLabels.begin(), std::mem_fun_ref(&MusOO::ChordQMUL::str));
+                    Eigen::SparseMatrix<double> theGlobalSparseConfusionMatrix;
+                    if (theChordEvaluation.isSparse())
                     {
-                        theCSVFile << theCSVSeparator << 100*theStats.getChordsWithNWrong(iNumOfWrongChromas)/theDuration;
+                        theGlobalSparseConfusionMatrix = theChordEvaluation.calcTotalSparseConfusionMatrix();
                     }
-                    theCSVFile
-                        << theCSVSeparator << 100*theStats.getCorrectChords()/theDuration
-						<< theCSVSeparator << 100*theStats.getOnlyRootCorrect()/theDuration
-						<< theCSVSeparator<< 100*theStats.getOnlyTypeCorrect()/theDuration
-						<< theCSVSeparator << 100*theStats.getBothRootAndTypeWrong()/theDuration;
-				}
-				else
-				{
-					theCSVFile << "n/a" << theCSVSeparator << theDuration;
-                    for (size_t i = 0; i < 9+2*numChordTypes+maxCardinality+1; ++i)
+                    else
                     {
-                        theCSVFile << theCSVSeparator << "n/a";
+                        theGlobalConfusionMatrix = theChordEvaluation.calcTotalConfusionMatrix();
                     }
-				}
-                theCSVFile << theCSVSeparator << theStats.getNumOfUniquesInRef() << theCSVSeparator << theStats.getNumOfUniquesInTest() << endl;
-			}
-		}
-		theCSVFile.close();
-        
-        // Global output file
-        theTotalDuration = theChordEvaluation.calcTotalDuration();
-		string theChordMode = theVarMap["chords"].as<string>();
-		theOutputFile << string(theChordMode.size()+11,'*') << "\n* Chords " << theChordMode << " *\n"
-        << string(theChordMode.size()+11,'*') << endl;
-		theOutputFile << "Duration of evaluated chords: " << theTotalDuration << " s" << endl;
-		theOutputFile << "Average score: " << 100 * theChordEvaluation.calcWeightedAverageScore() << "%" << endl;
-        
-        theGlobalConfusionMatrix = theChordEvaluation.calcTotalConfusionMatrix();
-		ChordEvaluationStats theGlobalStats(theGlobalConfusionMatrix, theChordEvaluation.getLabels());
-        theOutputFile << "\nChord detection results\n" << "-----------------------" << endl;
-		theOutputFile << "Correct chords: " << printResultLine(theGlobalStats.getCorrectChords(), theTotalDuration, " s") << endl;
-		theOutputFile << "Substituted chords: " << printResultLine(theGlobalStats.getChordSubstitutions(), theTotalDuration, " s") << endl;
-		theOutputFile << "Deleted chords: " << printResultLine(theGlobalStats.getChordDeletions(), theTotalDuration, " s") << endl;
-		theOutputFile << "Inserted chords: " << printResultLine(theGlobalStats.getChordInsertions(), theTotalDuration, " s") << endl;
-		theOutputFile << "Correct no-chords: " << printResultLine(theGlobalStats.getCorrectNoChords(), theTotalDuration, " s") << endl;
-        
-        theOutputFile << "\nResults per chord type\n" << "----------------------" << endl;
-        const Eigen::ArrayXXd theResultsPerType = theGlobalStats.getCorrectChordsPerType();
-        for (Eigen::ArrayXXd::Index iChordType = 0; iChordType < theResultsPerType.rows(); ++iChordType)
-        {
-            theOutputFile << ChordTypeQMUL(theChordEvaluation.getLabels()[iChordType].type()) << ": "
-                << printResultLine(theResultsPerType(iChordType,0), theResultsPerType(iChordType,1), " s") << " of "
-                << printResultLine(theResultsPerType(iChordType,1), theTotalDuration, " s") << endl;
-        }
-        
-        theOutputFile << "\nResults per number of chromas wrong\n" << "-----------------------------------" << endl;
-        theOutputFile << "0 chromas wrong: " << printResultLine(theGlobalStats.getChordsWithNWrong(0), theTotalDuration, " s") << endl;
-        theOutputFile << "  of which root correct: " << printResultLine(theGlobalStats.getCorrectChords(), theTotalDuration, " s") << endl;
-        theOutputFile << "  of which root incorrect: " << printResultLine(theGlobalStats.getChordsWithNWrong(0)-theGlobalStats.getCorrectChords(), theTotalDuration, " s") << endl;
-        for (size_t iNumOfWrongChromas = 1; iNumOfWrongChromas <= maxCardinality; ++iNumOfWrongChromas)
-        {
-            theOutputFile << iNumOfWrongChromas << " chroma" << (iNumOfWrongChromas==1?"":"s") << " wrong: " << printResultLine(theGlobalStats.getChordsWithNWrong(iNumOfWrongChromas), theTotalDuration, " s") << endl;
-            theOutputFile << "  of which " << iNumOfWrongChromas << " substitution" << (iNumOfWrongChromas==1?"":"s") << ": " << printResultLine(theGlobalStats.getChordsWithSDI(iNumOfWrongChromas, 0, 0), theTotalDuration, " s") << endl;
-            //prune impossible combinations for this set of chord types
-            if (minCardinality + iNumOfWrongChromas <= maxCardinality)
+                    const ChordEvaluationStats theGlobalStats = theChordEvaluation.isSparse() ? ChordEvaluationStats(theGlobalSparseConfusionMatrix, theChordEvaluation.getLabels()) : ChordEvaluationStats(theGlobalConfusionMatrix, theChordEvaluation.getLabels());
+                    printChordResults(theChordOutputFile, theChordEvaluation, theGlobalStats, theChordModes[iPreset]);
+                
+                    // Confusion matrix
+                    if (theVarMap.count("confusion") > 0)
+                    {
+                        ofstream theConfusionMatrixFile;
+                        openConfusionMatrixFile(theConfusionMatrixFile, addSuffix(theConfusionPath, theSuffix));
+                        if (theChordEvaluation.isSparse())
+                        {
+                            printConfusionMatrix(theConfusionMatrixFile, theGlobalSparseConfusionMatrix, theLabels);
+                        }
+                        else
+                        {
+                            printConfusionMatrix(theConfusionMatrixFile, theGlobalConfusionMatrix, theLabels);
+                        }
+                    }
+                }
+            }
+            if (!theWatch)
             {
-                theOutputFile << "  of which " << iNumOfWrongChromas << " deletion" << (iNumOfWrongChromas==1?"":"s") << ": " << printResultLine(theGlobalStats.getChordsWithSDI(0, iNumOfWrongChromas, 0), theTotalDuration, " s") << endl;
+                break;
             }
-            if (maxCardinality - iNumOfWrongChromas >= minCardinality)
+            if (theNumOfSystems > 1)
             {
-                theOutputFile << "  of which " << iNumOfWrongChromas << " insertion" << (iNumOfWrongChromas==1?"":"s") << ": " << printResultLine(theGlobalStats.getChordsWithSDI(0, 0, iNumOfWrongChromas), theTotalDuration, " s") << endl;
+                writeLeaderboard(theOutputFile, theOutputPath, theLeaderboardTitle, theLeaderboardPresets, theSystemNames, theLeaderboardScores, theSettings);
             }
-            for (size_t iNumSubstitutions = iNumOfWrongChromas-1; iNumSubstitutions > 0; --iNumSubstitutions)
+            theWatch->update();
+            if (theOutputFile.is_open())
             {
-                const size_t numDI = iNumOfWrongChromas-iNumSubstitutions;
-                if (minCardinality + numDI <= maxCardinality)
-                {
-                    theOutputFile << "  of which " << iNumSubstitutions << " substitution" << (iNumSubstitutions==1?"":"s") << ", " << numDI << " deletion" << (numDI==1?"":"s") << ": " << printResultLine(theGlobalStats.getChordsWithSDI(iNumSubstitutions, numDI, 0), theTotalDuration, " s") << endl;
-                }
-                if (maxCardinality - numDI >= minCardinality)
-                {
-                    theOutputFile << "  of which " << iNumSubstitutions << " substitution" << (iNumSubstitutions==1?"":"s") << ", " << numDI << " insertion" << (numDI==1?"":"s") << ": " << printResultLine(theGlobalStats.getChordsWithSDI(iNumSubstitutions, 0, numDI), theTotalDuration, " s") << endl;
-                }
+                theOutputFile.close();
+                openOutputFile(theOutputFile, theOutputPath, theListPath, theRefDirPath, theTestDirPath);
             }
         }
-        const double unknownWrong = theGlobalStats.getChordsWithUnknownWrong();
-        if (unknownWrong > 0.)
+        for (size_t iSystem = 0; iSystem < theNumOfSystems; ++iSystem)
         {
-            theOutputFile << "unknown chromas wrong: " << printResultLine(unknownWrong, theTotalDuration, " s") << endl;
+            for (size_t iPreset = 0; iPreset < theChordModes.size(); ++iPreset)
+            {
+                delete theChordEvaluations[iSystem][iPreset];
+            }
         }
-        
-        theOutputFile << "\nRoot/type results\n" << "-----------------" << endl;
-        theOutputFile << "Both correct: " << printResultLine(theGlobalStats.getCorrectChords(), theTotalDuration, " s") << endl;
-		theOutputFile << "Only root correct: " << printResultLine(theGlobalStats.getOnlyRootCorrect(), theTotalDuration, " s") << endl;
-		theOutputFile << "Only type correct: " << printResultLine(theGlobalStats.getOnlyTypeCorrect(), theTotalDuration, " s") << endl;
-		theOutputFile << "Both wrong: " << printResultLine(theGlobalStats.getBothRootAndTypeWrong(), theTotalDuration, " s") << endl;
+        deleteWorkerEvaluations(theWorkerEvaluations);
 	}
 	/*********/
 	/* Notes */
 	/*********/
 	else if (theVarMap.count("notes") > 0)
 	{
-		PairwiseEvaluation<Note> theNoteEvaluation(theVarMap["notes"].as<string>());
-        theLabels.resize(theNoteEvaluation.getNumOfTestLabels());
-        std::transform(theNoteEvaluation.getLabels().begin(), theNoteEvaluation.getLabels().end(), theLabels.begin(), std::mem_fun_ref(&MusOO::NoteMidi::str));
-
-		ofstream theCSVFile;
-		if (theVarMap.count("csv") > 0)
+		const string theNoteMode = theVarMap["notes"].as<string>();
+		vector<PairwiseEvaluation<Note>*> theNoteEvaluations(theNumOfSystems);
+		vector<boost::shared_ptr<ofstream> > theCSVFiles(theNumOfSystems);
+		// Kept to rewrite the CSV files during a watch
+		vector<vector<string> > theCSVHeaders(theNumOfSystems);
+		for (size_t iSystem = 0; iSystem < theNumOfSystems; ++iSystem)
 		{
-			theCSVFile.open(path(theOutputPath).replace_extension("csv"));
-			theCSVFile << theVarMap["notes"].as<string>() << endl;
-			theCSVFile << "File" 
-				<< theCSVSeparator << "Pairwise score (%)"
-				<< theCSVSeparator << "Duration (s)" 
-				<< theCSVSeparator << "Correct notes (%)" 
-				<< theCSVSeparator << "Octave error (%)" 
-				<< theCSVSeparator << "Fifth error (%)" 
-				<< theCSVSeparator << "Chromatic up error (%)"
-				<< theCSVSeparator << "Chromatic down error (%)"
-				<< theCSVSeparator << "Correct no-notes (%)" 
-				<< theCSVSeparator << "Note deletions (%)" 
-				<< theCSVSeparator << "Note insertions (%)"  << endl;
-			theCSVFile << std::fixed;
+			theNoteEvaluations[iSystem] = new PairwiseEvaluation<Note>(theNoteMode);
+			theCSVFiles[iSystem].reset(new ofstream);
+			if (theVarMap.count("csv") > 0)
+			{
+				ofstream& theCSVFile = *theCSVFiles[iSystem];
+				theCSVFile.open(addSuffix(theOutputPath, theSettings.systemSuffixes[iSystem]).replace_extension("csv"));
+				std::ostringstream theCSVHeader;
+				theCSVHeader << theNoteMode << endl;
+				theCSVHeader << "File" 
+					<< theCSVSeparator << "Pairwise score (%)"
+					<< theCSVSeparator << "Duration (s)" 
+					<< theCSVSeparator << "Correct notes (%)" 
+					<< theCSVSeparator << "Octave error (%)" 
+					<< theCSVSeparator << "Fifth error (%)" 
+					<< theCSVSeparator << "Chromatic up error (%)"
+					<< theCSVSeparator << "Chromatic down error (%)"
+					<< theCSVSeparator << "Correct no-notes (%)" 
+					<< theCSVSeparator << "Note deletions (%)" 
+					<< theCSVSeparator << "Note insertions (%)"  << endl;
+				theCSVHeaders[iSystem].assign(1, theCSVHeader.str());
+				theCSVFile << theCSVHeaders[iSystem].front() << std::fixed;
+			}
 		}
+        theLabels.resize(theNoteEvaluations.front()->getNumOfTestLabels());
+        std::transform(theNoteEvaluations.front()->getLabels().begin(), theNoteEvaluations.front()->getLabels().end(), theLabels.begin(), std::mem_fun_ref(&MusOO::NoteMidi::str));
 
-		for (vector<string>::iterator i = theListItems.begin(); i != theListItems.end(); ++i)
-		{
-            constructPaths(*i, theRefDirPath, theRefExt, theTestDirPath, theTestExt, theVarMap, theRefPath, theTestPath, theBegin, theEnd);
-			cout << "Evaluating file " << *i << endl;
-
-			NoteFileMaps theTestFile(theTestPath.string());
-			NoteSequence theTestNotes = theTestFile.readAll();
-
-			NoteFileMaps theRefFile(theRefPath.string());
-			NoteSequence theRefNotes = theRefFile.readAll();
-
-            ofstream theVerboseStream;
-            if (theVarMap.count("verbose"))
+        const vector<string> thePresets(1, theNoteMode);
+        const vector<string> theSuffixes = createOutputSuffixes(thePresets);
+        vector<vector<PairwiseEvaluation<Note>*> > theWorkerEvaluations = createWorkerEvaluations<Note>(theNumOfWorkers, thePresets);
+        vector<PairwiseJob<Note> > theJobs;
+        for (vector<ListItem>::const_iterator i = theListItems.begin(); i != theListItems.end(); ++i)
+        {
+            theJobs.push_back(PairwiseJob<Note>(*i, theSettings, theWorkerEvaluations, thePresets, theSuffixes));
+        }
+        theRunLog.restore(theJobs);
+        boost::shared_ptr<PairwiseWatch<Note> > theWatch;
+        if (theVarMap.count("watch") > 0)
+        {
+            vector<vector<PairwiseEvaluation<Note>*> > theTotals(theNumOfSystems);
+            for (size_t iSystem = 0; iSystem < theNumOfSystems; ++iSystem)
             {
-                path theVerbosePath = theOutputPath.parent_path() / path(*i + ".csv");
-                theVerboseStream.open(theVerbosePath);
+                theTotals[iSystem].assign(1, theNoteEvaluations[iSystem]);
             }
-			theNoteEvaluation.addSequencePair(theRefNotes, theTestNotes, theBegin, theEnd, theVerboseStream, theMinRefDuration, theMaxRefDuration, theDelay);
-
-			if (theVarMap.count("csv") > 0)
+            theWatch.reset(new PairwiseWatch<Note>(theJobs, theListItems, theTotals, createCSVPaths(theOutputPath, theSettings, theSuffixes), theCSVHeaders));
+        }
+        {
+            JobPool<PairwiseJob<Note> > thePool(theJobs, theSchedule, theNumOfThreads, theMaxLookAhead, theReadAhead);
+            for (size_t iJob = 0; iJob < theJobs.size(); ++iJob)
             {
-                NoteEvaluationStats theStats(theNoteEvaluation.getConfusionMatrix());
-                double theDuration = theNoteEvaluation.getDuration();
-				theCSVFile << theCSVQuotes << *i << theCSVQuotes << theCSVSeparator
-					<< 100*theNoteEvaluation.getScore() << theCSVSeparator
-					<< theDuration << theCSVSeparator
-					<< 100*theStats.getCorrectNotes()/theDuration << theCSVSeparator
-					<< 100*theStats.getOctaveErrors()/theDuration << theCSVSeparator
-					<< 100*theStats.getFifthErrors()/theDuration << theCSVSeparator
-					<< 100*theStats.getChromaticUpErrors()/theDuration << theCSVSeparator
-					<< 100*theStats.getChromaticDownErrors()/theDuration
-					<< 100*theStats.getCorrectNoNotes()/theDuration << theCSVSeparator
-					<< 100*theStats.getNoteDeletions()/theDuration << theCSVSeparator
-					<< 100*theStats.getNoteInsertions()/theDuration << theCSVSeparator << endl;
-			}
-		}
-		theCSVFile.close();
-        
-        // Global output file
-        theTotalDuration = theNoteEvaluation.calcTotalDuration();
-		string theNoteMode = theVarMap["notes"].as<string>();
-		theOutputFile << string(theNoteMode.size()+10,'*') << "\n* Notes " << theNoteMode << " *\n"
-        << string(theNoteMode.size()+10,'*') << endl;
-		theOutputFile << "Duration of evaluated notes: " << theTotalDuration << " s" << endl;
-		theOutputFile << "Average score: " << 100 * theNoteEvaluation.calcWeightedAverageScore() << "%\n" << endl;
-        
-        theGlobalConfusionMatrix = theNoteEvaluation.calcTotalConfusionMatrix();
-		NoteEvaluationStats theGlobalStats(theGlobalConfusionMatrix);
-		theOutputFile << "Correct notes: " << printResultLine(theGlobalStats.getCorrectNotes(), theTotalDuration, " s") << endl;
-		theOutputFile << "Octave errors: " << printResultLine(theGlobalStats.getOctaveErrors(), theTotalDuration, " s") << endl;
-		theOutputFile << "Fifth errors: " << printResultLine(theGlobalStats.getFifthErrors(), theTotalDuration, " s") << endl;
-		theOutputFile << "Chromatic up errors: " << printResultLine(theGlobalStats.getChromaticUpErrors(), theTotalDuration, " s") << endl;
-		theOutputFile << "Chromatic down errors: " << printResultLine(theGlobalStats.getChromaticDownErrors(), theTotalDuration, " s") << endl;
-		theOutputFile << "Deleted notes: " << printResultLine(theGlobalStats.getNoteDeletions(), theTotalDuration, " s") << endl;
+                cout << "Evaluating file " << theJobs[iJob].getName() << endl;
+                PairwiseJob<Note>* theJob = theRunLog.wait(thePool, theJobs, iJob);
+                if (theJob == NULL)
+                {
+                    continue;
+                }
+                for (size_t iSystem = 0; iSystem < theNumOfSystems; ++iSystem)
+                {
+                    theJob->commitResults(*theNoteEvaluations[iSystem], iSystem);
+                    *theCSVFiles[iSystem] << theJob->getCSVRow(iSystem) << std::flush;
+                }
+                theRunLog.record(iJob, *theJob);
+                if (theWatch)
+                {
+                    theWatch->keep(iJob);
+                }
+                else
+                {
+                    theJob->releaseResults();
+                }
+            }
+        }
+		theCSVFiles.clear();
         
-		theOutputFile << "\nCorrect no-notes: " << printResultLine(theGlobalStats.getCorrectNoNotes(), theTotalDuration, " s") << endl;
-		theOutputFile << "Inserted notes: " << printResultLine(theGlobalStats.getNoteInsertions(), theTotalDuration, " s") << endl;
+        theLeaderboardTitle = "Notes";
+        theLeaderboardPresets = thePresets;
+        theLeaderboardScores.assign(theNumOfSystems, vector<double>(1));
+        // A watch reports again after every update
+        while (true)
+        {
+            for (size_t iSystem = 0; iSystem < theNumOfSystems; ++iSystem)
+            {
+                const PairwiseEvaluation<Note>& theNoteEvaluation = *theNoteEvaluations[iSystem];
+                // Global output file
+                ofstream theSystemOutputFile;
+                if (hasSeparateOutputFiles)
+                {
+                    openOutputFile(theSystemOutputFile, addSuffix(theOutputPath, theSettings.systemSuffixes[iSystem]), theListPath, theRefDirPath, theTestDirPaths[iSystem]);
+                }
+                ofstream& theNoteOutputFile = hasSeparateOutputFiles ? theSystemOutputFile : theOutputFile;
+                theTotalDuration = theNoteEvaluation.calcTotalDuration();
+                theLeaderboardScores[iSystem][0] = theNoteEvaluation.calcWeightedAverageScore();
+                theNoteOutputFile << string(theNoteMode.size()+10,'*') << "\n* Notes " << theNoteMode << " *\n"
+                << string(theNoteMode.size()+10,'*') << endl;
+                theNoteOutputFile << "Duration of evaluated notes: " << theTotalDuration << " s" << endl;
+                theNoteOutputFile << "Average score: " << 100 * theNoteEvaluation.calcWeightedAverageScore() << "%\n" << endl;
+            
+                theGlobalConfusionMatrix = theNoteEvaluation.calcTotalConfusionMatrix();
+                NoteEvaluationStats theGlobalStats(theGlobalConfusionMatrix);
+                theNoteOutputFile << "Correct notes: " << printResultLine(theGlobalStats.getCorrectNotes(), theTotalDuration, " s") << endl;
+                theNoteOutputFile << "Octave errors: " << printResultLine(theGlobalStats.getOctaveErrors(), theTotalDuration, " s") << endl;
+                theNoteOutputFile << "Fifth errors: " << printResultLine(theGlobalStats.getFifthErrors(), theTotalDuration, " s") << endl;
+                theNoteOutputFile << "Chromatic up errors: " << printResultLine(theGlobalStats.getChromaticUpErrors(), theTotalDuration, " s") << endl;
+                theNoteOutputFile << "Chromatic down errors: " << printResultLine(theGlobalStats.getChromaticDownErrors(), theTotalDuration, " s") << endl;
+                theNoteOutputFile << "Deleted notes: " << printResultLine(theGlobalStats.getNoteDeletions(), theTotalDuration, " s") << endl;
+            
+                theNoteOutputFile << "\nCorrect no-notes: " << printResultLine(theGlobalStats.getCorrectNoNotes(), theTotalDuration, " s") << endl;
+                theNoteOutputFile << "Inserted notes: " << printResultLine(theGlobalStats.getNoteInsertions(), theTotalDuration, " s") << endl;
+            
+                // Confusion matrix
+                if (theVarMap.count("confusion") > 0)
+                {
+                    ofstream theConfusionMatrixFile;
+                    openConfusionMatrixFile(theConfusionMatrixFile, addSuffix(theConfusionPath, theSettings.systemSuffixes[iSystem]));
+                    printConfusionMatrix(theConfusionMatrixFile, theGlobalConfusionMatrix, theLabels);
+                }
+            }
+            if (!theWatch)
+            {
+                break;
+            }
+            if (theNumOfSystems > 1)
+            {
+                writeLeaderboard(theOutputFile, theOutputPath, theLeaderboardTitle, theLeaderboardPresets, theSystemNames, theLeaderboardScores, theSettings);
+            }
+            theWatch->update();
+            if (theOutputFile.is_open())
+            {
+                theOutputFile.close();
+                openOutputFile(theOutputFile, theOutputPath, theListPath, theRefDirPath, theTestDirPath);
+            }
+        }
+        for (size_t iSystem = 0; iSystem < theNumOfSystems; ++iSystem)
+        {
+            delete theNoteEvaluations[iSystem];
+        }
+        deleteWorkerEvaluations(theWorkerEvaluations);
 	}
 	/****************/
 	/* Segmentation */
@@ -787,28 +1846,26 @@ int main(int inNumOfArguments,char* inArguments[])
 			theCSVFile << std::fixed;
 		}
         
-		for (vector<string>::iterator i = theListItems.begin(); i != theListItems.end(); ++i)
-		{
-            constructPaths(*i, theRefDirPath, theRefExt, theTestDirPath, theTestExt, theVarMap, theRefPath, theTestPath, theBegin, theEnd);
-			cout << "Evaluating file " << *i << endl;
-            
-			LabFile<std::string> theRefFile(theRefPath.string(), true);
-            LabFile<std::string> theTestFile(theTestPath.string(), true);
-            theSegmentationEvaluation.addSequencePair(theRefFile.readAll(), theTestFile.readAll());
-            
-			if (theVarMap.count("csv") > 0)
-			{
-                theCSVFile << theCSVQuotes << *i << theCSVQuotes
-                << theCSVSeparator << theSegmentationEvaluation.getDuration()
-                << theCSVSeparator << theSegmentationEvaluation.getNumRefSegments()
-                << theCSVSeparator << theSegmentationEvaluation.getNumTestSegments()
-                << theCSVSeparator << theSegmentationEvaluation.getCombinedHammingMeasureWorst()
-                << theCSVSeparator << theSegmentationEvaluation.getCombinedHammingMeasureHarmonic()
-                << theCSVSeparator << theSegmentationEvaluation.getUnderSegmentation()
-                << theCSVSeparator << theSegmentationEvaluation.getOverSegmentation()
-                << endl;
-			}
-		}
+        vector<SegmentationJob> theJobs;
+        for (vector<ListItem>::const_iterator i = theListItems.begin(); i != theListItems.end(); ++i)
+        {
+            theJobs.push_back(SegmentationJob(*i, theSettings, theVarMap["segmentation"].as<string>(), tol));
+        }
+        theRunLog.restore(theJobs);
+        {
+            JobPool<SegmentationJob> thePool(theJobs, theSchedule, theNumOfThreads, theMaxLookAhead, theReadAhead);
+            for (size_t iJob = 0; iJob < theJobs.size(); ++iJob)
+            {
+                cout << "Evaluating file " << theJobs[iJob].getName() << endl;
+                SegmentationJob* theJob = theRunLog.wait(thePool, theJobs, iJob);
+                if (theJob != NULL)
+                {
+                    theSegmentationEvaluation.append(theJob->getEvaluation());
+                    theCSVFile << theJob->getCSVRow() << std::flush;
+                    theRunLog.record(iJob, *theJob);
+                }
+            }
+        }
 		theCSVFile.close();
         
         // Global output file
@@ -825,21 +1882,20 @@ int main(int inNumOfArguments,char* inArguments[])
         theOutputFile << "Average over-segmentation: " << theSegmentationEvaluation.calcAverageOverSegmentation() << endl;
     }
 
-    /********************/
-	/* Confusion matrix */
-    /********************/
-	if (theVarMap.count("confusion") && theVarMap.count("segmentation") == 0)
+    /***************/
+	/* Leaderboard */
+    /***************/
+	if (theNumOfSystems > 1 && theVarMap.count("agreement") == 0)
 	{
-		ofstream theConfusionMatrixFile(theVarMap["confusion"].as<path>());
-		if (!theConfusionMatrixFile.is_open())
-		{
-			throw runtime_error("Could not open confusion matrix file '" +
-				theVarMap["confusion"].as<path>().string() + "'");
-		}
-		printConfusionMatrix(theConfusionMatrixFile, theGlobalConfusionMatrix, theLabels);
+		writeLeaderboard(theOutputFile, theOutputPath, theLeaderboardTitle, theLeaderboardPresets, theSystemNames, theLeaderboardScores, theSettings);
 	}
 
 	cout << "Total execution time: " << static_cast<double>(clock())/CLOCKS_PER_SEC << "s" << endl;
+	if (theRunLog.getNumOfFailures() > 0)
+	{
+		cerr << theRunLog.getNumOfFailures() << " of " << theListItems.size() << " file(s) could not be evaluated, see '" << theRunLog.getErrorReportPath().string() << "'" << endl;
+		return 1;
+	}
 	return 0;
 }
 catch (exception& e)
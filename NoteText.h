@@ -0,0 +1,28 @@
+#ifndef NoteText_h
+#define NoteText_h
+
+//============================================================================
+/**
+	Class parsing a note from its MIDI number, or "N" for silence, as the
+	MAPS note files and the sequence cache store them.
+
+	@author		agent
+	@date		20261016
+*/
+//============================================================================
+#include <string>
+#include <boost/lexical_cast.hpp>
+#include "MusOO/NoteMidi.h"
+
+class NoteText : public MusOO::NoteMidi
+{
+public:
+
+	/** Constructor. Throws if inText is not a whole number or "N". */
+	NoteText(const std::string& inText)
+	: MusOO::NoteMidi(inText == "N" ? MusOO::NoteMidi(MusOO::Note::silence()) : MusOO::NoteMidi(boost::lexical_cast<int>(inText)))
+	{
+	}
+};
+
+#endif	// #ifndef NoteText_h
@@ -9,6 +9,7 @@
 
 // Includes
 #include <iomanip>
+#include <set>
 #include "MusOO/KeyQMUL.h"
 #include "MusOO/ChordQMUL.h"
 #include "PairwiseEvaluation.h"
@@ -20,28 +21,52 @@ using std::set;
 using std::endl;
 using namespace MusOO;
 
+template <>
+SimilarityScore<Key>* PairwiseEvaluation<Key>::createSimilarityScore(const std::string& inScoreSelect)
+{
+	return new SimilarityScoreKey(inScoreSelect);
+}
+
 template <>
 PairwiseEvaluation<Key>::PairwiseEvaluation(const std::string& inScoreSelect)
+: m_ScoreSelect(inScoreSelect)
 {
-	m_SimilarityScore = new SimilarityScoreKey(inScoreSelect);
+	m_SimilarityScore = createSimilarityScore(inScoreSelect);
 	m_NumOfRefLabels = m_SimilarityScore->getNumOfRefLabels();
     m_NumOfTestLabels = m_SimilarityScore->getNumOfTestLabels();
+    reset();
+}
+
+template <>
+SimilarityScore<Chord>* PairwiseEvaluation<Chord>::createSimilarityScore(const std::string& inScoreSelect)
+{
+	return new SimilarityScoreChord(inScoreSelect);
 }
 
 template <>
 PairwiseEvaluation<Chord>::PairwiseEvaluation(const std::string& inScoreSelect)
+: m_ScoreSelect(inScoreSelect)
 {
-	m_SimilarityScore = new SimilarityScoreChord(inScoreSelect);
+	m_SimilarityScore = createSimilarityScore(inScoreSelect);
 	m_NumOfRefLabels = m_SimilarityScore->getNumOfRefLabels();
     m_NumOfTestLabels = m_SimilarityScore->getNumOfTestLabels();
+    reset();
+}
+
+template <>
+SimilarityScore<Note>* PairwiseEvaluation<Note>::createSimilarityScore(const std::string& inScoreSelect)
+{
+	return new SimilarityScoreNote(inScoreSelect);
 }
 
 template <>
 PairwiseEvaluation<Note>::PairwiseEvaluation(const std::string& inScoreSelect)
+: m_ScoreSelect(inScoreSelect)
 {
-	m_SimilarityScore = new SimilarityScoreNote(inScoreSelect);
+	m_SimilarityScore = createSimilarityScore(inScoreSelect);
 	m_NumOfRefLabels = m_SimilarityScore->getNumOfRefLabels();
     m_NumOfTestLabels = m_SimilarityScore->getNumOfTestLabels();
+    reset();
 }
 
 template <>
@@ -97,3 +122,30 @@ void printConfusionMatrix(std::ostream& inOutputStream, const Eigen::ArrayXXd& i
 		inOutputStream << endl;
 	}
 }
+
+void printConfusionMatrix(std::ostream& inOutputStream, const Eigen::SparseMatrix<double>& inConfusionMatrix,
+						  const std::vector<std::string>& inLabels, const std::string inSeparator /*= ","*/,
+                          const std::string inQuote /*= "\""*/)
+{
+	inOutputStream << "reference\test" << inSeparator << inQuote;
+	copy(inLabels.begin(), inLabels.begin()+inConfusionMatrix.cols()-1, std::ostream_iterator<std::string>(inOutputStream, (inQuote+inSeparator+inQuote).c_str()));
+	inOutputStream << inLabels[inConfusionMatrix.cols()-1] << inQuote << endl;
+	// Row-major copy, so the non-zeros of each row can be visited in order
+	const Eigen::SparseMatrix<double, Eigen::RowMajor> theRows(inConfusionMatrix);
+	for (int i = 0; i < theRows.rows(); ++i)
+	{
+		inOutputStream << inQuote << inLabels[i] << inQuote;
+		Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator theEntry(theRows, i);
+		for (int j = 0; j < theRows.cols(); ++j)
+		{
+			double theValue = 0.;
+			if (theEntry && theEntry.col() == j)
+			{
+				theValue = theEntry.value();
+				++theEntry;
+			}
+			inOutputStream << inSeparator << std::fixed << std::setprecision(9) << theValue;
+		}
+		inOutputStream << endl;
+	}
+}
@@ -6,6 +6,10 @@
 	Template class representing a frame based evaluation of two timed sequences
 	of musical properties.
 
+	Only the results of the last file are kept, the reductions over the data
+	set are folded into running totals as files get added, such that memory
+	use does not depend on the number of files.
+
 	@author		Johan Pauwels
 	@date		20100913
 */
@@ -13,13 +17,17 @@
 
 #include "MusOO/TimedLabel.h"
 #include <Eigen/Core>
+#include <Eigen/SparseCore>
 #include <vector>
-#include <set>
+#include <functional>
 #include <iostream>
 #include <iterator>
 #include <limits>
-#include <numeric>
 #include <algorithm>
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/exception_ptr.hpp>
 
 template<typename T>
 class SimilarityScore;
@@ -30,6 +38,22 @@ class PairwiseEvaluation
 public:
 
 	typedef std::vector<MusOO::TimedLabel<T> > LabelSequence;
+    /** A stretch of time during which neither the reference nor the test label changes. */
+    struct SegmentPair
+    {
+        double onset;
+        double offset;
+        T refLabel;
+        T testLabel;
+    };
+    typedef std::vector<SegmentPair> SegmentPairSequence;
+    /** The score of a segment pair and the cell of the confusion matrix it adds to. */
+    struct SegmentScore
+    {
+        double score;
+        size_t refIndex;
+        size_t testIndex;
+    };
 
 	/** Default constructor. */
 	PairwiseEvaluation(const std::string& inScoreSelect);
@@ -38,60 +62,212 @@ public:
     virtual ~PairwiseEvaluation();
 
 	void addSequencePair(const LabelSequence& inRefSequence, const LabelSequence& inTestSequence, double inStartTime, double inEndTime, std::ostream& inVerboseOStream, const double inMinRefDuration = 0., const double inMaxRefDuration = std::numeric_limits<double>::infinity(), const double inDelay = 0.);
+    /** Splits two sequences into the segment pairs that addSequencePair evaluates, such that they can be evaluated
+        by several instances with different presets without going over the sequences again. Long sequences can be
+        split into inNumOfChunks chunks of change times that get swept on as many threads. */
+    static void collectSegmentPairs(const LabelSequence& inRefSequence, const LabelSequence& inTestSequence, double inStartTime, double inEndTime, SegmentPairSequence& outSegmentPairs, const double inMinRefDuration = 0., const double inMaxRefDuration = std::numeric_limits<double>::infinity(), const double inDelay = 0., const size_t inNumOfChunks = 1);
+    /** Evaluates the segment pairs of a single file, as if the sequences they were collected from were added. Without
+        verbose output, many segment pairs can be split into inNumOfChunks chunks that get scored on as many threads.
+        The scores are added up in order afterwards, so the results do not depend on the number of chunks. */
+    void addSegmentPairs(const SegmentPairSequence& inSegmentPairs, std::ostream& inVerboseOStream, const size_t inNumOfChunks = 1);
+    /** Adds the results of a file that has been evaluated by another instance with the same preset. */
+    void addResult(const double inDuration, const double inScore, const Eigen::ArrayXXd& inConfusionMatrix);
+    void addResult(const double inDuration, const double inScore, const Eigen::SparseMatrix<double>& inConfusionMatrix);
+    /** Takes back the results of a file that have been added before. */
+    void removeResult(const double inDuration, const double inScore, const Eigen::ArrayXXd& inConfusionMatrix);
+    void removeResult(const double inDuration, const double inScore, const Eigen::SparseMatrix<double>& inConfusionMatrix);
+    /** Forgets the results of all files added so far. */
+    void reset();
 
 	const std::vector<T>& getLabels() const;
 	const Eigen::ArrayXXd::Index getNumOfRefLabels() const;
 	const Eigen::ArrayXXd::Index getNumOfTestLabels() const;
+    /** Whether the confusion matrices are accumulated sparsely, which is the case when the label set is too large for a
+        dense matrix per file. Only the sparse or the dense confusion matrix getters can be used, depending on this. */
+    const bool isSparse() const;
 
-    // Get results of last file
+    // Get results of last file evaluated by addSequencePair
     const double getDuration() const;
     const double getScore() const;
     const Eigen::ArrayXXd& getConfusionMatrix() const;
+    const Eigen::SparseMatrix<double>& getSparseConfusionMatrix() const;
     
     // Reductions over data set
     const double calcTotalDuration() const;
     const Eigen::ArrayXXd calcTotalConfusionMatrix() const;
+    const Eigen::SparseMatrix<double> calcTotalSparseConfusionMatrix() const;
     const double calcAverageScore() const;
     const double calcWeightedAverageScore() const;
     
 protected:
+    /** The times and reference durations to which a sweep over the change times is limited, and the delay of the test
+        sequence. When the offsets of both sequences are in order, a sweep can find where to start by binary search. */
+    struct SweepLimits
+    {
+        double startTime;
+        double endTime;
+        double minRefDuration;
+        double maxRefDuration;
+        double delay;
+        bool areOffsetsOrdered;
+    };
+    /** Whether a segment ends before a time, once shifted back by the delay. */
+    struct EndsBefore
+    {
+        double delay;
+        bool operator()(const MusOO::TimedLabel<T>& inSegment, const double inTime) const
+        {
+            return inSegment.offset() - delay < inTime;
+        }
+    };
+    /** Puts the onsets and offsets of both sequences that lie within [inStartTime, inEndTime), together with the start
+        and end time, in ascending order without duplicates. The boundaries of a well-formed sequence are already ordered,
+        so both sequences only need to be merged. Unsorted or overlapping segments fall back to a full sort. */
+    static void collectChangeTimes(const LabelSequence& inRefSequence, const LabelSequence& inTestSequence, const double inStartTime, const double inEndTime, const double inDelay, std::vector<double>& outChangeTimes);
+    /** Collects the segment pairs that end at the change times from inFirstChange up to inLastChange. A sweep over
+        consecutive ranges gives the same segment pairs as one over all change times, because the segments in which
+        a sweep is at any change time can be found from the start of the sequences. */
+    static void sweepChangeTimes(const LabelSequence& inRefSequence, const LabelSequence& inTestSequence, const SweepLimits& inLimits, const std::vector<double>& inChangeTimes, const size_t inFirstChange, const size_t inLastChange, SegmentPairSequence& outSegmentPairs);
+    /** The index of the first segment that does not end before inTime once shifted back by inDelay, or of the last
+        segment if they all do, which is where a sweep is after passing inTime. */
+    static const size_t findSweepIndex(const LabelSequence& inSequence, const double inTime, const double inDelay, const bool inAreOffsetsOrdered);
+    static const bool areOffsetsOrdered(const LabelSequence& inSequence);
+    /** Scores the segment pairs from inFirstPair up to inLastPair with inSimilarityScore. */
+    static void scoreSegmentPairs(SimilarityScore<T>* inSimilarityScore, const SegmentPairSequence& inSegmentPairs, const size_t inFirstPair, const size_t inLastPair, std::vector<SegmentScore>& outSegmentScores);
+    /** The number of chunks with at least s_MinChunkSize elements each, up to inNumOfChunks. */
+    static const size_t calcNumOfChunks(const size_t inNumOfElements, const size_t inNumOfChunks);
+    /** Runs a chunk, keeping what it throws in outError, since an exception cannot leave a thread. */
+    static void runChunk(const boost::function<void ()>& inChunk, boost::exception_ptr& outError);
+    /** Waits for all chunks, then rethrows the first error any of them kept. */
+    static void joinChunks(boost::thread_group& ioThreads, const std::vector<boost::exception_ptr>& inErrors);
+    static SimilarityScore<T>* createSimilarityScore(const std::string& inScoreSelect);
+    /** Collects the onsets and offsets of a sequence that lie within [inStartTime, inEndTime), shifted back by inDelay. */
+    static void collectBoundaries(const LabelSequence& inSequence, const double inStartTime, const double inEndTime, const double inDelay, std::vector<double>& outBoundaries);
     void printVerboseOutput(std::ostream& inVerboseOStream, const double theStartTime, const double theEndTime, const T& theRefLabel, const T& theTestLabel, const T& theMappedRefLabel, const T& theMappedTestLabel, const double theScore, const double theSegmentLength) const;
 	
 	SimilarityScore<T>* m_SimilarityScore;
+    std::string m_ScoreSelect;
+    // Scores the chunks after the first, created when first needed
+    std::vector<SimilarityScore<T>*> m_ChunkSimilarityScores;
     Eigen::ArrayXXd::Index m_NumOfRefLabels;
     Eigen::ArrayXXd::Index m_NumOfTestLabels;
     
-    std::vector<double> m_Durations;
-    std::vector<double> m_Scores;
-    std::vector<Eigen::ArrayXXd> m_ConfusionMatrices;
+    double m_Duration;
+    double m_Score;
+    Eigen::ArrayXXd m_ConfusionMatrix;
+    Eigen::SparseMatrix<double> m_SparseConfusionMatrix;
+    
+    size_t m_NumOfFiles;
+    double m_TotalDuration;
+    double m_TotalScore;
+    double m_TotalWeightedScore;
+    Eigen::ArrayXXd m_TotalConfusionMatrix;
+    Eigen::SparseMatrix<double> m_TotalSparseConfusionMatrix;
 
 private:
 
+    void addToTotals(const double inDuration, const double inScore);
+    void removeFromTotals(const double inDuration, const double inScore);
+
+    static const Eigen::ArrayXXd::Index s_MaxNumOfDenseConfusionCells = 16384;
+    // Fewer change times or segment pairs per chunk are not worth a thread
+    static const size_t s_MinChunkSize = 4096;
+
 
 };
 
 void printConfusionMatrix(std::ostream& inOutputStream, const Eigen::ArrayXXd& inConfusionMatrix,
 						  const std::vector<std::string>& inLabels, const std::string inSeparator = ",",
                           const std::string inQuote = "\"");
+void printConfusionMatrix(std::ostream& inOutputStream, const Eigen::SparseMatrix<double>& inConfusionMatrix,
+						  const std::vector<std::string>& inLabels, const std::string inSeparator = ",",
+                          const std::string inQuote = "\"");
 
 template <typename T>
 PairwiseEvaluation<T>::~PairwiseEvaluation()
 {
 	delete m_SimilarityScore;
+    for (size_t iChunk = 0; iChunk < m_ChunkSimilarityScores.size(); ++iChunk)
+    {
+        delete m_ChunkSimilarityScores[iChunk];
+    }
 }
 
 template <typename T>
 void PairwiseEvaluation<T>::addSequencePair(const LabelSequence& inRefSequence, const LabelSequence& inTestSequence, double inStartTime, double inEndTime, std::ostream& inVerboseOStream, const double inMinRefDuration /*= 0.*/, const double inMaxRefDuration /*= std::numeric_limits<double>::infinity()*/, const double inDelay /*= 0.*/)
 {
-    m_ConfusionMatrices.push_back(Eigen::ArrayXXd::Zero(m_NumOfRefLabels, m_NumOfTestLabels));
-    Eigen::ArrayXXd& curConfusionMatrix = m_ConfusionMatrices.back();
-	m_Scores.push_back(0.);
-    double& curScore = m_Scores.back();
-	double theCurTime = inStartTime;
+    SegmentPairSequence theSegmentPairs;
+    collectSegmentPairs(inRefSequence, inTestSequence, inStartTime, inEndTime, theSegmentPairs, inMinRefDuration, inMaxRefDuration, inDelay);
+    addSegmentPairs(theSegmentPairs, inVerboseOStream);
+}
+
+template <typename T>
+void PairwiseEvaluation<T>::collectSegmentPairs(const LabelSequence& inRefSequence, const LabelSequence& inTestSequence, double inStartTime, double inEndTime, SegmentPairSequence& outSegmentPairs, const double inMinRefDuration /*= 0.*/, const double inMaxRefDuration /*= std::numeric_limits<double>::infinity()*/, const double inDelay /*= 0.*/, const size_t inNumOfChunks /*= 1*/)
+{
+    outSegmentPairs.clear();
+	//test whether end time is set
+	if (inEndTime <= inStartTime)
+	{
+		inEndTime = inRefSequence.empty() ? 0. : inRefSequence.back().offset();
+	}
+    
+	//collect all transition times of both reference and test sequence
+    std::vector<double> theChangeTimes;
+    collectChangeTimes(inRefSequence, inTestSequence, inStartTime, inEndTime, inDelay, theChangeTimes);
+    
+    //every chunk ends at the change time where the next one starts
+    const size_t theNumOfChunks = calcNumOfChunks(theChangeTimes.size()-1, inNumOfChunks);
+    std::vector<size_t> theChunkStarts(theNumOfChunks+1);
+    for (size_t iChunk = 0; iChunk <= theNumOfChunks; ++iChunk)
+    {
+        theChunkStarts[iChunk] = 1 + iChunk * (theChangeTimes.size()-1) / theNumOfChunks;
+    }
+    SweepLimits theLimits;
+    theLimits.startTime = inStartTime;
+    theLimits.endTime = inEndTime;
+    theLimits.minRefDuration = inMinRefDuration;
+    theLimits.maxRefDuration = inMaxRefDuration;
+    theLimits.delay = inDelay;
+    theLimits.areOffsetsOrdered = theNumOfChunks > 1 && areOffsetsOrdered(inRefSequence) && areOffsetsOrdered(inTestSequence);
+    std::vector<SegmentPairSequence> theChunkSegmentPairs(theNumOfChunks-1);
+    std::vector<boost::exception_ptr> theChunkErrors(theNumOfChunks);
+    boost::thread_group theThreads;
+    try
+    {
+        for (size_t iChunk = 1; iChunk < theNumOfChunks; ++iChunk)
+        {
+            const boost::function<void ()> theChunk = boost::bind(&PairwiseEvaluation<T>::sweepChangeTimes, boost::cref(inRefSequence), boost::cref(inTestSequence), theLimits, boost::cref(theChangeTimes), theChunkStarts[iChunk], theChunkStarts[iChunk+1], boost::ref(theChunkSegmentPairs[iChunk-1]));
+            theThreads.create_thread(boost::bind(&PairwiseEvaluation<T>::runChunk, theChunk, boost::ref(theChunkErrors[iChunk])));
+        }
+    }
+    catch (...)
+    {
+        theThreads.join_all();
+        throw;
+    }
+    outSegmentPairs.reserve(theChangeTimes.size());
+    runChunk(boost::bind(&PairwiseEvaluation<T>::sweepChangeTimes, boost::cref(inRefSequence), boost::cref(inTestSequence), theLimits, boost::cref(theChangeTimes), theChunkStarts[0], theChunkStarts[1], boost::ref(outSegmentPairs)), theChunkErrors[0]);
+    joinChunks(theThreads, theChunkErrors);
+    for (size_t iChunk = 0; iChunk < theChunkSegmentPairs.size(); ++iChunk)
+    {
+        outSegmentPairs.insert(outSegmentPairs.end(), theChunkSegmentPairs[iChunk].begin(), theChunkSegmentPairs[iChunk].end());
+    }
+}
+
+template <typename T>
+void PairwiseEvaluation<T>::sweepChangeTimes(const LabelSequence& inRefSequence, const LabelSequence& inTestSequence, const SweepLimits& inLimits, const std::vector<double>& inChangeTimes, const size_t inFirstChange, const size_t inLastChange, SegmentPairSequence& outSegmentPairs)
+{
+	//the first segment starts at the start time, even if a delayed test boundary lies before it
+	double theCurTime = inFirstChange > 1 ? inChangeTimes[inFirstChange-1] : inLimits.startTime;
 	double thePrevTime;
-	double theSegmentLength;
     size_t theRefIndex = 0;
 	size_t theTestIndex = 0;
+    if (inFirstChange > 1)
+    {
+        //start in the segments where a sweep over the preceding change times ends
+        theRefIndex = findSweepIndex(inRefSequence, theCurTime, 0., inLimits.areOffsetsOrdered);
+        theTestIndex = findSweepIndex(inTestSequence, theCurTime, inLimits.delay, inLimits.areOffsetsOrdered);
+    }
     
 	//set end time of test and reference sequence
 	double theRefEndTime = 0.;
@@ -102,49 +278,15 @@ void PairwiseEvaluation<T>::addSequencePair(const LabelSequence& inRefSequence,
 	}
 	if (!inTestSequence.empty())
 	{
-		theTestEndTime = inTestSequence.back().offset() - inDelay;
+		theTestEndTime = inTestSequence.back().offset() - inLimits.delay;
 	}
     
-	//test whether end time is set
-	if (inEndTime <= inStartTime)
-	{
-		inEndTime = theRefEndTime;
-	}
-    
-	//collect all transition times of both reference and test sequence
-    std::set<double> theChangeTimes;
-	for (size_t i = 0; i < inRefSequence.size(); i++)
-	{
-		if (inRefSequence[i].onset() >= inStartTime && inRefSequence[i].onset() < inEndTime)
-		{
-			theChangeTimes.insert(inRefSequence[i].onset());
-		}
-		if (inRefSequence[i].offset() >= inStartTime && inRefSequence[i].offset() < inEndTime)
-		{
-			theChangeTimes.insert(inRefSequence[i].offset());
-		}
-	}
-	for (size_t i = 0; i < inTestSequence.size(); i++)
-	{
-		if (inTestSequence[i].onset() >= inStartTime && inTestSequence[i].onset() < inEndTime)
-		{
-			theChangeTimes.insert(inTestSequence[i].onset()-inDelay);
-		}
-		if (inTestSequence[i].offset() >= inStartTime && inTestSequence[i].offset() < inEndTime)
-		{
-			theChangeTimes.insert(inTestSequence[i].offset()-inDelay);
-		}
-	}
-	//add test length to change times
-	theChangeTimes.insert(inStartTime);
-	theChangeTimes.insert(inEndTime);
     
 	//run over all the times of chord change
-	for (std::set<double>::iterator i = ++theChangeTimes.begin(); i != theChangeTimes.end(); ++i)
+	for (size_t iChange = inFirstChange; iChange < inLastChange; ++iChange)
 	{
 		thePrevTime = theCurTime;
-		theCurTime = *i;
-		theSegmentLength = theCurTime - thePrevTime;
+		theCurTime = inChangeTimes[iChange];
         
 		//advance chord segments until in the first segment that ends after the current time
 		//or until in the last chord segment
@@ -152,73 +294,364 @@ void PairwiseEvaluation<T>::addSequencePair(const LabelSequence& inRefSequence,
 		{
 			theRefIndex++;
 		}
-		while (theTestIndex+1 < inTestSequence.size() && inTestSequence[theTestIndex].offset()-inDelay < theCurTime)
+		while (theTestIndex+1 < inTestSequence.size() && inTestSequence[theTestIndex].offset()-inLimits.delay < theCurTime)
 		{
 			theTestIndex++;
 		}
 		/***********************************/
 		/* Classification of ended segment */
 		/***********************************/
-        T theRefLabel;
+        SegmentPair theSegmentPair;
+        theSegmentPair.onset = thePrevTime;
+        theSegmentPair.offset = theCurTime;
         double theRefDuration;
 		//label in reference
 		if (theCurTime <= theRefEndTime && theCurTime > inRefSequence[theRefIndex].onset())
 		{
-            theRefLabel = inRefSequence[theRefIndex].label();
-            theRefDuration = std::min(inRefSequence[theRefIndex].offset(), inEndTime) - std::max(inRefSequence[theRefIndex].onset(), inStartTime);
+            theSegmentPair.refLabel = inRefSequence[theRefIndex].label();
+            theRefDuration = std::min(inRefSequence[theRefIndex].offset(), inLimits.endTime) - std::max(inRefSequence[theRefIndex].onset(), inLimits.startTime);
 		}
 		//no label in reference
 		else
 		{
-			theRefLabel = T::silence();
-            if (theRefIndex > 0 && inRefSequence[theRefIndex-1].offset() >= inStartTime)
+			theSegmentPair.refLabel = T::silence();
+            if (theRefIndex > 0 && inRefSequence[theRefIndex-1].offset() >= inLimits.startTime)
             {
-                theRefDuration = std::min(inRefSequence[theRefIndex].onset(), inEndTime) - inRefSequence[theRefIndex-1].offset();
+                theRefDuration = std::min(inRefSequence[theRefIndex].onset(), inLimits.endTime) - inRefSequence[theRefIndex-1].offset();
             }
             else
             {
-                theRefDuration = std::min(inRefSequence[theRefIndex].onset(), inEndTime) - inStartTime;
+                theRefDuration = std::min(inRefSequence[theRefIndex].onset(), inLimits.endTime) - inLimits.startTime;
             }
 		}
-        T theTestLabel;
         //label in test
-        if (theCurTime <= theTestEndTime && theCurTime > inTestSequence[theTestIndex].onset()-inDelay)
+        if (theCurTime <= theTestEndTime && theCurTime > inTestSequence[theTestIndex].onset()-inLimits.delay)
         {
-            theTestLabel = inTestSequence[theTestIndex].label();
+            theSegmentPair.testLabel = inTestSequence[theTestIndex].label();
         }
         //no label in test
         else
         {
-            theTestLabel = T::silence();
+            theSegmentPair.testLabel = T::silence();
         }
         
-        if (theRefDuration >= inMinRefDuration && theRefDuration <= inMaxRefDuration)
+        if (theRefDuration >= inLimits.minRefDuration && theRefDuration <= inLimits.maxRefDuration)
+        {
+            outSegmentPairs.push_back(theSegmentPair);
+        }
+	}
+}
+
+template <typename T>
+const size_t PairwiseEvaluation<T>::findSweepIndex(const LabelSequence& inSequence, const double inTime, const double inDelay, const bool inAreOffsetsOrdered)
+{
+    if (inSequence.empty())
+    {
+        return 0;
+    }
+    const EndsBefore theEndsBefore = {inDelay};
+    if (inAreOffsetsOrdered)
+    {
+        return std::lower_bound(inSequence.begin(), inSequence.end()-1, inTime, theEndsBefore) - inSequence.begin();
+    }
+    //without order, the segments that end later can lie anywhere before
+    size_t theIndex = 0;
+    while (theIndex+1 < inSequence.size() && theEndsBefore(inSequence[theIndex], inTime))
+    {
+        theIndex++;
+    }
+    return theIndex;
+}
+
+template <typename T>
+const bool PairwiseEvaluation<T>::areOffsetsOrdered(const LabelSequence& inSequence)
+{
+    for (size_t i = 1; i < inSequence.size(); ++i)
+    {
+        if (inSequence[i].offset() < inSequence[i-1].offset())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+void PairwiseEvaluation<T>::addSegmentPairs(const SegmentPairSequence& inSegmentPairs, std::ostream& inVerboseOStream, const size_t inNumOfChunks /*= 1*/)
+{
+    //the verbose output needs the mapped labels of every segment, so it is only written by a single chunk
+    std::vector<SegmentScore> theSegmentScores;
+    const size_t theNumOfChunks = inVerboseOStream.good() ? 1 : calcNumOfChunks(inSegmentPairs.size(), inNumOfChunks);
+    if (theNumOfChunks > 1)
+    {
+        while (m_ChunkSimilarityScores.size() < theNumOfChunks-1)
         {
-            double theSegmentScore = m_SimilarityScore->score(theRefLabel, theTestLabel);
-            // NemaEval implementation errors recreation
-            //        if (theCurTime > theTestEndTime || theCurTime <= inTestSequence[theTestIndex].onset()-inDelay || theCurTime <= inRefSequence[theRefIndex].onset())
-            //        {
-            //            theScore = 0.;
-            //        }
-            if (theSegmentScore >= 0)
+            m_ChunkSimilarityScores.push_back(createSimilarityScore(m_ScoreSelect));
+        }
+        theSegmentScores.resize(inSegmentPairs.size());
+        std::vector<boost::exception_ptr> theChunkErrors(theNumOfChunks);
+        boost::thread_group theThreads;
+        try
+        {
+            for (size_t iChunk = 1; iChunk < theNumOfChunks; ++iChunk)
             {
-                curConfusionMatrix(m_SimilarityScore->getRefIndex(), m_SimilarityScore->getTestIndex()) += theSegmentLength;
-                curScore += theSegmentScore * theSegmentLength;
+                const boost::function<void ()> theChunk = boost::bind(&PairwiseEvaluation<T>::scoreSegmentPairs, m_ChunkSimilarityScores[iChunk-1], boost::cref(inSegmentPairs), iChunk * inSegmentPairs.size() / theNumOfChunks, (iChunk+1) * inSegmentPairs.size() / theNumOfChunks, boost::ref(theSegmentScores));
+                theThreads.create_thread(boost::bind(&PairwiseEvaluation<T>::runChunk, theChunk, boost::ref(theChunkErrors[iChunk])));
             }
-            /******************/
-            /* Verbose output */
-            /******************/
-            if (inVerboseOStream.good())
+        }
+        catch (...)
+        {
+            theThreads.join_all();
+            throw;
+        }
+        runChunk(boost::bind(&PairwiseEvaluation<T>::scoreSegmentPairs, m_SimilarityScore, boost::cref(inSegmentPairs), 0, inSegmentPairs.size() / theNumOfChunks, boost::ref(theSegmentScores)), theChunkErrors[0]);
+        joinChunks(theThreads, theChunkErrors);
+    }
+    std::vector<Eigen::Triplet<double> > theConfusionEntries;
+    if (isSparse())
+    {
+        theConfusionEntries.reserve(inSegmentPairs.size());
+    }
+    else
+    {
+        m_ConfusionMatrix.setZero(m_NumOfRefLabels, m_NumOfTestLabels);
+    }
+	m_Score = 0.;
+    for (typename SegmentPairSequence::const_iterator i = inSegmentPairs.begin(); i != inSegmentPairs.end(); ++i)
+    {
+        const double theSegmentLength = i->offset - i->onset;
+        SegmentScore theSegmentScore;
+        if (theSegmentScores.empty())
+        {
+            theSegmentScore.score = m_SimilarityScore->score(i->refLabel, i->testLabel);
+            theSegmentScore.refIndex = m_SimilarityScore->getRefIndex();
+            theSegmentScore.testIndex = m_SimilarityScore->getTestIndex();
+        }
+        else
+        {
+            theSegmentScore = theSegmentScores[i - inSegmentPairs.begin()];
+        }
+        // NemaEval implementation errors recreation
+        //        if (theCurTime > theTestEndTime || theCurTime <= inTestSequence[theTestIndex].onset()-inDelay || theCurTime <= inRefSequence[theRefIndex].onset())
+        //        {
+        //            theScore = 0.;
+        //        }
+        if (theSegmentScore.score >= 0)
+        {
+            if (isSparse())
             {
-                printVerboseOutput(inVerboseOStream, thePrevTime, theCurTime, theRefLabel, theTestLabel, m_SimilarityScore->getMappedRefLabel(), m_SimilarityScore->getMappedTestLabel(), theSegmentScore, theSegmentLength);
+                theConfusionEntries.push_back(Eigen::Triplet<double>(theSegmentScore.refIndex, theSegmentScore.testIndex, theSegmentLength));
             }
+            else
+            {
+                m_ConfusionMatrix(theSegmentScore.refIndex, theSegmentScore.testIndex) += theSegmentLength;
+            }
+            m_Score += theSegmentScore.score * theSegmentLength;
+        }
+        /******************/
+        /* Verbose output */
+        /******************/
+        if (inVerboseOStream.good())
+        {
+            printVerboseOutput(inVerboseOStream, i->onset, i->offset, i->refLabel, i->testLabel, m_SimilarityScore->getMappedRefLabel(), m_SimilarityScore->getMappedTestLabel(), theSegmentScore.score, theSegmentLength);
         }
 	}
-    m_Durations.push_back(curConfusionMatrix.sum());
-    const double& curDuration = m_Durations.back();
-    if (curDuration > 0.)
+    if (isSparse())
     {
-        curScore /= curDuration;
+        // Entries with the same indices get summed
+        m_SparseConfusionMatrix.resize(m_NumOfRefLabels, m_NumOfTestLabels);
+        m_SparseConfusionMatrix.setFromTriplets(theConfusionEntries.begin(), theConfusionEntries.end());
+        m_Duration = m_SparseConfusionMatrix.sum();
+        m_TotalSparseConfusionMatrix += m_SparseConfusionMatrix;
+    }
+    else
+    {
+        m_Duration = m_ConfusionMatrix.sum();
+        m_TotalConfusionMatrix += m_ConfusionMatrix;
+    }
+    if (m_Duration > 0.)
+    {
+        m_Score /= m_Duration;
+    }
+    addToTotals(m_Duration, m_Score);
+}
+
+template <typename T>
+void PairwiseEvaluation<T>::scoreSegmentPairs(SimilarityScore<T>* inSimilarityScore, const SegmentPairSequence& inSegmentPairs, const size_t inFirstPair, const size_t inLastPair, std::vector<SegmentScore>& outSegmentScores)
+{
+    for (size_t iPair = inFirstPair; iPair < inLastPair; ++iPair)
+    {
+        outSegmentScores[iPair].score = inSimilarityScore->score(inSegmentPairs[iPair].refLabel, inSegmentPairs[iPair].testLabel);
+        outSegmentScores[iPair].refIndex = inSimilarityScore->getRefIndex();
+        outSegmentScores[iPair].testIndex = inSimilarityScore->getTestIndex();
+    }
+}
+
+template <typename T>
+const size_t PairwiseEvaluation<T>::calcNumOfChunks(const size_t inNumOfElements, const size_t inNumOfChunks)
+{
+    return std::max<size_t>(std::min(inNumOfChunks, inNumOfElements / s_MinChunkSize), 1);
+}
+
+template <typename T>
+void PairwiseEvaluation<T>::runChunk(const boost::function<void ()>& inChunk, boost::exception_ptr& outError)
+{
+    try
+    {
+        inChunk();
+    }
+    catch (...)
+    {
+        outError = boost::current_exception();
+    }
+}
+
+template <typename T>
+void PairwiseEvaluation<T>::joinChunks(boost::thread_group& ioThreads, const std::vector<boost::exception_ptr>& inErrors)
+{
+    ioThreads.join_all();
+    for (size_t iChunk = 0; iChunk < inErrors.size(); ++iChunk)
+    {
+        if (inErrors[iChunk])
+        {
+            boost::rethrow_exception(inErrors[iChunk]);
+        }
+    }
+}
+
+template <typename T>
+void PairwiseEvaluation<T>::collectChangeTimes(const LabelSequence& inRefSequence, const LabelSequence& inTestSequence, const double inStartTime, const double inEndTime, const double inDelay, std::vector<double>& outChangeTimes)
+{
+    std::vector<double> theRefTimes;
+    std::vector<double> theTestTimes;
+    collectBoundaries(inRefSequence, inStartTime, inEndTime, 0., theRefTimes);
+    collectBoundaries(inTestSequence, inStartTime, inEndTime, inDelay, theTestTimes);
+    
+    outChangeTimes.clear();
+    outChangeTimes.reserve(theRefTimes.size() + theTestTimes.size() + 2);
+    if (std::adjacent_find(theRefTimes.begin(), theRefTimes.end(), std::greater<double>()) == theRefTimes.end() &&
+        std::adjacent_find(theTestTimes.begin(), theTestTimes.end(), std::greater<double>()) == theTestTimes.end())
+    {
+        std::vector<double>::const_iterator iRef = theRefTimes.begin();
+        std::vector<double>::const_iterator iTest = theTestTimes.begin();
+        while (iRef != theRefTimes.end() || iTest != theTestTimes.end())
+        {
+            double theNextTime;
+            if (iTest == theTestTimes.end() || (iRef != theRefTimes.end() && *iRef < *iTest))
+            {
+                theNextTime = *iRef++;
+            }
+            else
+            {
+                theNextTime = *iTest++;
+            }
+            if (outChangeTimes.empty() || outChangeTimes.back() < theNextTime)
+            {
+                outChangeTimes.push_back(theNextTime);
+            }
+        }
+        //add test length to change times
+        const double theLimits[] = {inStartTime, inEndTime};
+        for (size_t iLimit = 0; iLimit < 2; ++iLimit)
+        {
+            std::vector<double>::iterator theInsertPos = std::lower_bound(outChangeTimes.begin(), outChangeTimes.end(), theLimits[iLimit]);
+            if (theInsertPos == outChangeTimes.end() || theLimits[iLimit] < *theInsertPos)
+            {
+                outChangeTimes.insert(theInsertPos, theLimits[iLimit]);
+            }
+        }
+    }
+    else
+    {
+        outChangeTimes.insert(outChangeTimes.end(), theRefTimes.begin(), theRefTimes.end());
+        outChangeTimes.insert(outChangeTimes.end(), theTestTimes.begin(), theTestTimes.end());
+        outChangeTimes.push_back(inStartTime);
+        outChangeTimes.push_back(inEndTime);
+        std::sort(outChangeTimes.begin(), outChangeTimes.end());
+        outChangeTimes.erase(std::unique(outChangeTimes.begin(), outChangeTimes.end()), outChangeTimes.end());
+    }
+}
+
+template <typename T>
+void PairwiseEvaluation<T>::collectBoundaries(const LabelSequence& inSequence, const double inStartTime, const double inEndTime, const double inDelay, std::vector<double>& outBoundaries)
+{
+    outBoundaries.reserve(2 * inSequence.size());
+	for (size_t i = 0; i < inSequence.size(); i++)
+	{
+		if (inSequence[i].onset() >= inStartTime && inSequence[i].onset() < inEndTime)
+		{
+			outBoundaries.push_back(inSequence[i].onset()-inDelay);
+		}
+		if (inSequence[i].offset() >= inStartTime && inSequence[i].offset() < inEndTime)
+		{
+			outBoundaries.push_back(inSequence[i].offset()-inDelay);
+		}
+	}
+}
+
+template <typename T>
+void PairwiseEvaluation<T>::addResult(const double inDuration, const double inScore, const Eigen::ArrayXXd& inConfusionMatrix)
+{
+    m_TotalConfusionMatrix += inConfusionMatrix;
+    addToTotals(inDuration, inScore);
+}
+
+template <typename T>
+void PairwiseEvaluation<T>::addResult(const double inDuration, const double inScore, const Eigen::SparseMatrix<double>& inConfusionMatrix)
+{
+    m_TotalSparseConfusionMatrix += inConfusionMatrix;
+    addToTotals(inDuration, inScore);
+}
+
+template <typename T>
+void PairwiseEvaluation<T>::removeResult(const double inDuration, const double inScore, const Eigen::ArrayXXd& inConfusionMatrix)
+{
+    m_TotalConfusionMatrix -= inConfusionMatrix;
+    removeFromTotals(inDuration, inScore);
+}
+
+template <typename T>
+void PairwiseEvaluation<T>::removeResult(const double inDuration, const double inScore, const Eigen::SparseMatrix<double>& inConfusionMatrix)
+{
+    m_TotalSparseConfusionMatrix -= inConfusionMatrix;
+    m_TotalSparseConfusionMatrix.prune(0.);
+    removeFromTotals(inDuration, inScore);
+}
+
+template <typename T>
+void PairwiseEvaluation<T>::addToTotals(const double inDuration, const double inScore)
+{
+    ++m_NumOfFiles;
+    m_TotalDuration += inDuration;
+    m_TotalScore += inScore;
+    m_TotalWeightedScore += inDuration * inScore;
+}
+
+template <typename T>
+void PairwiseEvaluation<T>::removeFromTotals(const double inDuration, const double inScore)
+{
+    --m_NumOfFiles;
+    m_TotalDuration -= inDuration;
+    m_TotalScore -= inScore;
+    m_TotalWeightedScore -= inDuration * inScore;
+}
+
+template <typename T>
+void PairwiseEvaluation<T>::reset()
+{
+    m_Duration = 0.;
+    m_Score = 0.;
+    m_NumOfFiles = 0;
+    m_TotalDuration = 0.;
+    m_TotalScore = 0.;
+    m_TotalWeightedScore = 0.;
+    if (isSparse())
+    {
+        m_TotalSparseConfusionMatrix.resize(m_NumOfRefLabels, m_NumOfTestLabels);
+    }
+    else
+    {
+        m_TotalConfusionMatrix.setZero(m_NumOfRefLabels, m_NumOfTestLabels);
     }
 }
 
@@ -240,51 +673,64 @@ const Eigen::ArrayXXd::Index PairwiseEvaluation<T>::getNumOfTestLabels() const
 	return m_NumOfTestLabels;
 }
 
+template <typename T>
+const bool PairwiseEvaluation<T>::isSparse() const
+{
+	return m_NumOfRefLabels * m_NumOfTestLabels > s_MaxNumOfDenseConfusionCells;
+}
+
 template <typename T>
 const double PairwiseEvaluation<T>::getDuration() const
 {
-    return m_Durations.back();
+    return m_Duration;
 }
 
 template <typename T>
 const double PairwiseEvaluation<T>::getScore() const
 {
-    return m_Scores.back();
+    return m_Score;
 }
 
 template <typename T>
 const Eigen::ArrayXXd& PairwiseEvaluation<T>::getConfusionMatrix() const
 {
-    return m_ConfusionMatrices.back();
+    return m_ConfusionMatrix;
+}
+
+template <typename T>
+const Eigen::SparseMatrix<double>& PairwiseEvaluation<T>::getSparseConfusionMatrix() const
+{
+    return m_SparseConfusionMatrix;
 }
 
 template <typename T>
 const double PairwiseEvaluation<T>::calcTotalDuration() const
 {
-    return std::accumulate(m_Durations.begin(), m_Durations.end(), 0.);
+    return m_TotalDuration;
 }
 
 template <typename T>
 const Eigen::ArrayXXd PairwiseEvaluation<T>::calcTotalConfusionMatrix() const
 {
-    Eigen::ArrayXXd retTotalConfusionMatrix(Eigen::ArrayXXd::Zero(m_NumOfRefLabels, m_NumOfTestLabels));
-    for (std::vector<Eigen::ArrayXXd>::const_iterator iConfMat = m_ConfusionMatrices.begin(); iConfMat !=m_ConfusionMatrices.end(); ++iConfMat)
-    {
-        retTotalConfusionMatrix += *iConfMat;
-    }
-    return retTotalConfusionMatrix;
+    return m_TotalConfusionMatrix;
+}
+
+template <typename T>
+const Eigen::SparseMatrix<double> PairwiseEvaluation<T>::calcTotalSparseConfusionMatrix() const
+{
+    return m_TotalSparseConfusionMatrix;
 }
 
 template <typename T>
 const double PairwiseEvaluation<T>::calcAverageScore() const
 {
-    return std::accumulate(m_Scores.begin(), m_Scores.end(), 0.) / static_cast<double>(m_Scores.size());
+    return m_TotalScore / static_cast<double>(m_NumOfFiles);
 }
 
 template <typename T>
 const double PairwiseEvaluation<T>::calcWeightedAverageScore() const
 {
-    return std::inner_product(m_Durations.begin(), m_Durations.end(), m_Scores.begin(), 0.) / calcTotalDuration();
+    return m_TotalWeightedScore / calcTotalDuration();
 }
 
 #endif	// #ifndef PairwiseEvaluation_h
@@ -0,0 +1,169 @@
+#ifndef PairwiseWatch_h
+#define PairwiseWatch_h
+
+//============================================================================
+/**
+	Template class keeping the totals of a pairwise evaluation up to date
+	while the files under test change.
+
+	Every item of which a test file gets written is evaluated again, after
+	which its earlier results in the totals and the CSV files are replaced by
+	the new ones. An item that cannot be evaluated keeps its earlier results.
+
+	@author		agent
+	@date		20261017
+*/
+//============================================================================
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <iostream>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include "PairwiseEvaluation.h"
+#include "EvaluationJobs.h"
+#include "FileWatcher.h"
+
+template <typename T>
+class PairwiseWatch
+{
+public:
+
+	/** Constructor. Starts watching the directories of the test files of
+		inListItems, of which ioJobs are the jobs. inCSVPaths and inCSVHeaders
+		hold the path and header of the CSV file of every system under test
+		and preset, and are empty without CSV output. */
+	PairwiseWatch(std::vector<PairwiseJob<T> >& ioJobs, const std::vector<ListItem>& inListItems, const std::vector<std::vector<PairwiseEvaluation<T>*> >& inTotals,
+		const std::vector<std::vector<boost::filesystem::path> >& inCSVPaths, const std::vector<std::vector<std::string> >& inCSVHeaders);
+
+	/** Marks the results of the job at inIndex as committed to the totals,
+		such that they get replaced when it is evaluated again. */
+	void keep(const size_t inIndex);
+
+	/** Blocks until test files have been written, then evaluates their items
+		again and rewrites the CSV files. */
+	void update();
+
+private:
+
+	PairwiseWatch(const PairwiseWatch&);
+	PairwiseWatch& operator=(const PairwiseWatch&);
+
+	void writeCSVFiles() const;
+
+	FileWatcher m_Watcher;
+	std::vector<PairwiseJob<T> >& m_Jobs;
+	const std::vector<std::vector<PairwiseEvaluation<T>*> > m_Totals;
+	std::vector<bool> m_IsCommitted;
+	// The items that need to be evaluated again when a file under test gets written
+	std::map<boost::filesystem::path, std::vector<size_t> > m_ItemsPerFile;
+	// Per system under test and preset, empty without CSV output
+	const std::vector<std::vector<boost::filesystem::path> > m_CSVPaths;
+	// What precedes the rows in every CSV file, as written at the start of the run
+	const std::vector<std::vector<std::string> > m_CSVHeaders;
+};
+
+template <typename T>
+PairwiseWatch<T>::PairwiseWatch(std::vector<PairwiseJob<T> >& ioJobs, const std::vector<ListItem>& inListItems, const std::vector<std::vector<PairwiseEvaluation<T>*> >& inTotals,
+	const std::vector<std::vector<boost::filesystem::path> >& inCSVPaths, const std::vector<std::vector<std::string> >& inCSVHeaders)
+: m_Jobs(ioJobs), m_Totals(inTotals), m_IsCommitted(ioJobs.size(), false), m_CSVPaths(inCSVPaths), m_CSVHeaders(inCSVHeaders)
+{
+	std::set<boost::filesystem::path> theDirPaths;
+	for (size_t iItem = 0; iItem < inListItems.size(); ++iItem)
+	{
+		for (size_t iSystem = 0; iSystem < inListItems[iItem].testPaths.size(); ++iSystem)
+		{
+			const boost::filesystem::path& theTestPath = inListItems[iItem].testPaths[iSystem];
+			const boost::filesystem::path theDirPath = theTestPath.has_parent_path() ? theTestPath.parent_path() : boost::filesystem::path(".");
+			// Named the way the watcher reports written files
+			m_ItemsPerFile[theDirPath / theTestPath.filename()].push_back(iItem);
+			theDirPaths.insert(theDirPath);
+		}
+	}
+	for (std::set<boost::filesystem::path>::const_iterator i = theDirPaths.begin(); i != theDirPaths.end(); ++i)
+	{
+		if (boost::filesystem::is_directory(*i))
+		{
+			m_Watcher.watch(*i);
+		}
+	}
+}
+
+template <typename T>
+void PairwiseWatch<T>::keep(const size_t inIndex)
+{
+	m_IsCommitted[inIndex] = true;
+}
+
+template <typename T>
+void PairwiseWatch<T>::update()
+{
+	std::cout << "Watching the files under test for changes" << std::endl;
+	std::set<size_t> theItems;
+	while (theItems.empty())
+	{
+		const std::vector<boost::filesystem::path> theWrittenPaths = m_Watcher.waitForWrites();
+		for (size_t iPath = 0; iPath < theWrittenPaths.size(); ++iPath)
+		{
+			std::map<boost::filesystem::path, std::vector<size_t> >::const_iterator theFile = m_ItemsPerFile.find(theWrittenPaths[iPath]);
+			if (theFile != m_ItemsPerFile.end())
+			{
+				theItems.insert(theFile->second.begin(), theFile->second.end());
+			}
+		}
+	}
+	for (std::set<size_t>::const_iterator iItem = theItems.begin(); iItem != theItems.end(); ++iItem)
+	{
+		std::cout << "Evaluating file " << m_Jobs[*iItem].getName() << std::endl;
+		// The old results stay with the job until they have been retracted
+		PairwiseJob<T> theJob(m_Jobs[*iItem]);
+		try
+		{
+			theJob.load();
+			theJob(0);
+		}
+		catch (std::exception& e)
+		{
+			std::cerr << "Could not evaluate file " << theJob.getName() << ": " << e.what() << std::endl;
+			continue;
+		}
+		for (size_t iSystem = 0; iSystem < m_Totals.size(); ++iSystem)
+		{
+			for (size_t iPreset = 0; iPreset < m_Totals[iSystem].size(); ++iPreset)
+			{
+				if (m_IsCommitted[*iItem])
+				{
+					m_Jobs[*iItem].retractResults(*m_Totals[iSystem][iPreset], iSystem, iPreset);
+				}
+				theJob.commitResults(*m_Totals[iSystem][iPreset], iSystem, iPreset);
+			}
+		}
+		m_Jobs[*iItem] = theJob;
+		m_IsCommitted[*iItem] = true;
+	}
+	writeCSVFiles();
+}
+
+template <typename T>
+void PairwiseWatch<T>::writeCSVFiles() const
+{
+	for (size_t iSystem = 0; iSystem < m_CSVPaths.size(); ++iSystem)
+	{
+		for (size_t iPreset = 0; iPreset < m_CSVPaths[iSystem].size(); ++iPreset)
+		{
+			boost::filesystem::ofstream theCSVFile(m_CSVPaths[iSystem][iPreset]);
+			theCSVFile << m_CSVHeaders[iSystem][iPreset];
+			for (size_t iJob = 0; iJob < m_Jobs.size(); ++iJob)
+			{
+				if (m_IsCommitted[iJob])
+				{
+					theCSVFile << m_Jobs[iJob].getCSVRow(iSystem, iPreset);
+				}
+			}
+		}
+	}
+}
+
+#endif	// #ifndef PairwiseWatch_h
@@ -0,0 +1,167 @@
+//============================================================================
+/**
+	Implementation file for ResultStore.h
+
+	@author		agent
+	@date		20261016
+*/
+//============================================================================
+
+// Includes
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/functional/hash.hpp>
+#include "ResultStore.h"
+
+using std::string;
+using std::vector;
+using boost::filesystem::path;
+using boost::uint32_t;
+using boost::uint64_t;
+
+namespace
+{
+	const char s_Magic[4] = {'M', 'R', 'E', 'S'};
+	// Needs to change whenever the evaluation gives different results
+	const uint32_t s_Version = 1;
+
+	// Followed by the cells and the key
+	struct EntryHeader
+	{
+		char magic[4];
+		uint32_t version;
+		double duration;
+		double score;
+		uint32_t numOfRows;
+		uint32_t numOfColumns;
+		uint32_t numOfCells;
+		uint32_t keySize;
+	};
+
+	// 64-bit FNV-1a
+	const uint64_t s_HashOffset = 14695981039346656037ULL;
+	const uint64_t s_HashPrime = 1099511628211ULL;
+}
+
+ResultStore::ContentHash::ContentHash()
+: m_Hash(s_HashOffset), m_Size(0)
+{
+}
+
+void ResultStore::ContentHash::add(const char* inBegin, const char* inEnd)
+{
+	for (const char* theByte = inBegin; theByte != inEnd; ++theByte)
+	{
+		m_Hash = (m_Hash ^ static_cast<unsigned char>(*theByte)) * s_HashPrime;
+	}
+	m_Size += inEnd - inBegin;
+}
+
+const string ResultStore::ContentHash::str() const
+{
+	std::ostringstream theText;
+	theText << std::hex << std::setfill('0') << std::setw(16) << m_Hash << "-" << std::dec << m_Size;
+	return theText.str();
+}
+
+ResultStore::ResultStore(const path& inStoreDir)
+: m_StoreDir(inStoreDir)
+{
+	boost::filesystem::create_directories(m_StoreDir);
+}
+
+ResultStore::~ResultStore()
+{
+}
+
+bool ResultStore::read(const string& inKey, const size_t inNumOfRows, const size_t inNumOfColumns, Result& outResult) const
+{
+	boost::filesystem::ifstream theFile(createEntryPath(inKey), std::ios::binary);
+	if (!theFile.is_open())
+	{
+		return false;
+	}
+	EntryHeader theHeader;
+	if (!theFile.read(reinterpret_cast<char*>(&theHeader), sizeof(theHeader)) ||
+		std::memcmp(theHeader.magic, s_Magic, sizeof(s_Magic)) != 0 || theHeader.version != s_Version ||
+		theHeader.numOfRows != inNumOfRows || theHeader.numOfColumns != inNumOfColumns || theHeader.keySize != inKey.size())
+	{
+		return false;
+	}
+	outResult.confusionCells.resize(theHeader.numOfCells);
+	if (theHeader.numOfCells > 0 && !theFile.read(reinterpret_cast<char*>(&outResult.confusionCells[0]), theHeader.numOfCells * sizeof(Cell)))
+	{
+		return false;
+	}
+	// Different keys can hash to the same entry
+	string theKey(theHeader.keySize, '\0');
+	if (theHeader.keySize > 0 && !theFile.read(&theKey[0], theHeader.keySize))
+	{
+		return false;
+	}
+	if (theKey != inKey)
+	{
+		return false;
+	}
+	for (size_t iCell = 0; iCell < outResult.confusionCells.size(); ++iCell)
+	{
+		if (outResult.confusionCells[iCell].row >= inNumOfRows || outResult.confusionCells[iCell].column >= inNumOfColumns)
+		{
+			return false;
+		}
+	}
+	outResult.duration = theHeader.duration;
+	outResult.score = theHeader.score;
+	return true;
+}
+
+void ResultStore::write(const string& inKey, const size_t inNumOfRows, const size_t inNumOfColumns, const Result& inResult) const
+{
+	EntryHeader theHeader;
+	std::memcpy(theHeader.magic, s_Magic, sizeof(s_Magic));
+	theHeader.version = s_Version;
+	theHeader.duration = inResult.duration;
+	theHeader.score = inResult.score;
+	theHeader.numOfRows = static_cast<uint32_t>(inNumOfRows);
+	theHeader.numOfColumns = static_cast<uint32_t>(inNumOfColumns);
+	theHeader.numOfCells = static_cast<uint32_t>(inResult.confusionCells.size());
+	theHeader.keySize = static_cast<uint32_t>(inKey.size());
+
+	// Write to a file of our own first, such that readers never see a partial entry
+	boost::system::error_code theError;
+	const path theTempPath = m_StoreDir / boost::filesystem::unique_path("%%%%-%%%%-%%%%-%%%%.tmp", theError);
+	if (theError)
+	{
+		return;
+	}
+	{
+		boost::filesystem::ofstream theFile(theTempPath, std::ios::binary);
+		theFile.write(reinterpret_cast<const char*>(&theHeader), sizeof(theHeader));
+		if (!inResult.confusionCells.empty())
+		{
+			theFile.write(reinterpret_cast<const char*>(&inResult.confusionCells[0]), inResult.confusionCells.size() * sizeof(Cell));
+		}
+		theFile.write(inKey.data(), inKey.size());
+		if (!theFile.good())
+		{
+			theFile.close();
+			boost::filesystem::remove(theTempPath, theError);
+			return;
+		}
+	}
+	boost::filesystem::rename(theTempPath, createEntryPath(inKey), theError);
+	if (theError)
+	{
+		boost::filesystem::remove(theTempPath, theError);
+	}
+}
+
+const path ResultStore::createEntryPath(const string& inKey) const
+{
+	std::ostringstream theName;
+	theName << std::hex << std::setfill('0') << std::setw(2*sizeof(size_t)) << boost::hash<string>()(inKey) << ".res";
+	return m_StoreDir / theName.str();
+}
@@ -0,0 +1,77 @@
+#ifndef ResultStore_h
+#define ResultStore_h
+
+//============================================================================
+/**
+	Class representing an on-disk store of the results of evaluating a pair
+	of files, such that a later run only needs to evaluate the pairs that
+	have changed.
+
+	Every result is kept in its own file, named after a hash of its key. It
+	holds the duration, the score and the non-zero cells of the confusion
+	matrix. The key is made by the caller from hashes of the contents of the
+	files and every setting that affects the result. New entries are written
+	to a temporary file that is renamed into place, so several processes can
+	share a store directory.
+
+	@author		agent
+	@date		20261016
+*/
+//============================================================================
+#include <string>
+#include <vector>
+#include <boost/filesystem/path.hpp>
+#include <boost/cstdint.hpp>
+
+class ResultStore
+{
+public:
+
+	/** Hash of the contents of a file, which can be fed in pieces. */
+	class ContentHash
+	{
+	public:
+		ContentHash();
+		void add(const char* inBegin, const char* inEnd);
+		/** The hash and the number of bytes, as text. */
+		const std::string str() const;
+	private:
+		boost::uint64_t m_Hash;
+		boost::uint64_t m_Size;
+	};
+
+	struct Cell
+	{
+		boost::uint32_t row;
+		boost::uint32_t column;
+		double value;
+	};
+
+	struct Result
+	{
+		double duration;
+		double score;
+		// Only the non-zero cells of the confusion matrix
+		std::vector<Cell> confusionCells;
+	};
+
+	/** Constructor. Creates the store directory if it does not exist yet. */
+	ResultStore(const boost::filesystem::path& inStoreDir);
+
+	/** Destructor. */
+	virtual ~ResultStore();
+
+	/** Fills outResult with the result stored for inKey. Returns false if
+		there is no such entry or if its confusion matrix has another size. */
+	bool read(const std::string& inKey, const size_t inNumOfRows, const size_t inNumOfColumns, Result& outResult) const;
+	/** Stores inResult for inKey. Entries that cannot be written are skipped. */
+	void write(const std::string& inKey, const size_t inNumOfRows, const size_t inNumOfColumns, const Result& inResult) const;
+
+private:
+
+	const boost::filesystem::path createEntryPath(const std::string& inKey) const;
+
+	const boost::filesystem::path m_StoreDir;
+};
+
+#endif	// #ifndef ResultStore_h
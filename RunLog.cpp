@@ -0,0 +1,70 @@
+//============================================================================
+/**
+	Implementation file for RunLog.h
+
+	@author		agent
+	@date		20261017
+*/
+//============================================================================
+
+// Includes
+#include "RunLog.h"
+
+using std::string;
+using std::vector;
+using std::runtime_error;
+using boost::filesystem::path;
+
+RunLog::RunLog()
+: m_KeepGoing(false), m_NumOfFailures(0), m_IsMerging(false), m_FirstItem(0), m_ItemStep(1)
+{
+}
+
+void RunLog::keepJournal(const path& inJournalPath, const string& inRunDescription, const bool inResume)
+{
+	m_Journal.reset(new Journal(inJournalPath, inRunDescription, inResume));
+}
+
+void RunLog::mergeJournals(const vector<path>& inJournalPaths, const string& inRunDescription)
+{
+	m_Journal.reset(new Journal(inJournalPaths, inRunDescription));
+	m_IsMerging = true;
+}
+
+const vector<ListItem> RunLog::shard(const vector<ListItem>& inListItems, const size_t inShardIndex, const size_t inNumOfShards)
+{
+	m_FirstItem = inShardIndex;
+	m_ItemStep = inNumOfShards;
+	vector<ListItem> theShardItems;
+	for (size_t iItem = m_FirstItem; iItem < inListItems.size(); iItem += m_ItemStep)
+	{
+		theShardItems.push_back(inListItems[iItem]);
+	}
+	return theShardItems;
+}
+
+void RunLog::keepGoing(const path& inErrorReportPath)
+{
+	m_KeepGoing = true;
+	m_ErrorReportPath = inErrorReportPath;
+	m_ErrorReport.open(m_ErrorReportPath);
+	if (!m_ErrorReport.is_open())
+	{
+		throw runtime_error("Could not open error report '" + m_ErrorReportPath.string() + "'");
+	}
+}
+
+const size_t RunLog::getNumOfFailures() const
+{
+	return m_NumOfFailures;
+}
+
+const path& RunLog::getErrorReportPath() const
+{
+	return m_ErrorReportPath;
+}
+
+const size_t RunLog::getItemIndex(const size_t inIndex) const
+{
+	return m_FirstItem + inIndex * m_ItemStep;
+}
@@ -0,0 +1,139 @@
+#ifndef RunLog_h
+#define RunLog_h
+
+//============================================================================
+/**
+	Class keeping track of the list items of a run.
+
+	With a journal, the results of every item are recorded once they have
+	been committed, such that the run can be resumed. When the run keeps
+	going, items that cannot be evaluated are written to an error report and
+	left out of the results instead of stopping the run. A shard evaluates
+	every n-th item of the list only, its journal refers to the items by their
+	index in the whole list, such that the journals of all shards can be
+	merged.
+
+	@author		agent
+	@date		20261017
+*/
+//============================================================================
+#include <string>
+#include <vector>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/shared_ptr.hpp>
+#include "Journal.h"
+#include "JobPool.h"
+#include "EvaluationJobs.h"
+
+class RunLog
+{
+public:
+
+	/** Constructor. Without any of the calls below, nothing gets recorded
+		and the first failing item stops the run. */
+	RunLog();
+
+	void keepJournal(const boost::filesystem::path& inJournalPath, const std::string& inRunDescription, const bool inResume);
+
+	/** Takes all results from the journals of the shards of a run, which
+		need to hold every item between them. */
+	void mergeJournals(const std::vector<boost::filesystem::path>& inJournalPaths, const std::string& inRunDescription);
+
+	/** Selects every inNumOfShards-th item of the list, starting from the one
+		at inShardIndex, and returns them. */
+	const std::vector<ListItem> shard(const std::vector<ListItem>& inListItems, const size_t inShardIndex, const size_t inNumOfShards);
+
+	void keepGoing(const boost::filesystem::path& inErrorReportPath);
+
+	/** Restores the results of the jobs that have been recorded in the journal. */
+	template <typename Job>
+	void restore(std::vector<Job>& ioJobs) const;
+
+	/** Waits for the job at inIndex and returns it. Returns NULL if it failed
+		and the run keeps going, after adding the error to the report. */
+	template <typename Job>
+	Job* wait(JobPool<Job>& inPool, std::vector<Job>& inJobs, const size_t inIndex);
+
+	/** Records the results of a job in the journal, once they have been committed. */
+	template <typename Job>
+	void record(const size_t inIndex, const Job& inJob);
+
+	const size_t getNumOfFailures() const;
+	const boost::filesystem::path& getErrorReportPath() const;
+
+private:
+
+	RunLog(const RunLog&);
+	RunLog& operator=(const RunLog&);
+
+	/** The index in the whole list of the job at inIndex. */
+	const size_t getItemIndex(const size_t inIndex) const;
+
+	boost::shared_ptr<Journal> m_Journal;
+	bool m_KeepGoing;
+	boost::filesystem::path m_ErrorReportPath;
+	boost::filesystem::ofstream m_ErrorReport;
+	size_t m_NumOfFailures;
+	bool m_IsMerging;
+	size_t m_FirstItem;
+	size_t m_ItemStep;
+};
+
+template <typename Job>
+void RunLog::restore(std::vector<Job>& ioJobs) const
+{
+	if (!m_Journal)
+	{
+		return;
+	}
+	std::string theResults;
+	for (size_t iJob = 0; iJob < ioJobs.size(); ++iJob)
+	{
+		if (m_Journal->find(getItemIndex(iJob), ioJobs[iJob].getName(), theResults))
+		{
+			std::istringstream theStream(theResults);
+			ioJobs[iJob].restore(theStream);
+		}
+		else if (m_IsMerging)
+		{
+			throw std::runtime_error("The results of '" + ioJobs[iJob].getName() + "' are not in any of the journals to merge");
+		}
+	}
+}
+
+template <typename Job>
+Job* RunLog::wait(JobPool<Job>& inPool, std::vector<Job>& inJobs, const size_t inIndex)
+{
+	try
+	{
+		return &inPool.wait(inIndex);
+	}
+	catch (std::exception& e)
+	{
+		if (!m_KeepGoing)
+		{
+			throw;
+		}
+		std::cerr << "Could not evaluate file " << inJobs[inIndex].getName() << ": " << e.what() << std::endl;
+		m_ErrorReport << inJobs[inIndex].getName() << ": " << e.what() << std::endl;
+		++m_NumOfFailures;
+		return NULL;
+	}
+}
+
+template <typename Job>
+void RunLog::record(const size_t inIndex, const Job& inJob)
+{
+	if (m_Journal && !inJob.isRestored())
+	{
+		std::ostringstream theResults;
+		inJob.save(theResults);
+		m_Journal->record(getItemIndex(inIndex), inJob.getName(), theResults.str());
+	}
+}
+
+#endif	// #ifndef RunLog_h
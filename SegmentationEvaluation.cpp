@@ -11,8 +11,62 @@
 #include <numeric>
 #include <functional>
 #include <stdexcept>
+#include <istream>
+#include <ostream>
+#include <boost/cstdint.hpp>
 #include "SegmentationEvaluation.h"
 
+namespace
+{
+    template <typename V>
+    void writeValues(std::ostream& inStream, const std::vector<V>& inValues)
+    {
+        const boost::uint64_t theSize = inValues.size();
+        inStream.write(reinterpret_cast<const char*>(&theSize), sizeof(theSize));
+        if (!inValues.empty())
+        {
+            inStream.write(reinterpret_cast<const char*>(&inValues[0]), inValues.size() * sizeof(V));
+        }
+    }
+
+    template <typename V>
+    void readValues(std::istream& inStream, std::vector<V>& outValues)
+    {
+        boost::uint64_t theSize = 0;
+        inStream.read(reinterpret_cast<char*>(&theSize), sizeof(theSize));
+        outValues.clear();
+        // Grows with what can be read, such that a corrupt size does not exhaust memory
+        V theValue;
+        for (boost::uint64_t i = 0; i < theSize && inStream.read(reinterpret_cast<char*>(&theValue), sizeof(V)); ++i)
+        {
+            outValues.push_back(theValue);
+        }
+    }
+
+    void writeArrays(std::ostream& inStream, const std::vector<Eigen::ArrayXd>& inArrays)
+    {
+        const boost::uint64_t theSize = inArrays.size();
+        inStream.write(reinterpret_cast<const char*>(&theSize), sizeof(theSize));
+        for (size_t i = 0; i < inArrays.size(); ++i)
+        {
+            writeValues(inStream, std::vector<double>(inArrays[i].data(), inArrays[i].data() + inArrays[i].size()));
+        }
+    }
+
+    void readArrays(std::istream& inStream, std::vector<Eigen::ArrayXd>& outArrays)
+    {
+        boost::uint64_t theSize = 0;
+        inStream.read(reinterpret_cast<char*>(&theSize), sizeof(theSize));
+        outArrays.clear();
+        std::vector<double> theValues;
+        for (boost::uint64_t i = 0; i < theSize && inStream; ++i)
+        {
+            readValues(inStream, theValues);
+            outArrays.push_back(Eigen::Map<const Eigen::ArrayXd>(theValues.empty() ? NULL : &theValues[0], theValues.size()));
+        }
+    }
+}
+
 SegmentationEvaluation::SegmentationEvaluation(const std::string& inVariant, const std::vector<double>& inTolerances)
 : m_Variant(inVariant)
 , m_Tolerances(inTolerances)
@@ -33,6 +87,52 @@ void SegmentationEvaluation::reset()
     m_CombinedHammingMeasureHarmonic.clear();
 }
 
+void SegmentationEvaluation::append(const SegmentationEvaluation& inOther)
+{
+    m_Durations.insert(m_Durations.end(), inOther.m_Durations.begin(), inOther.m_Durations.end());
+    m_NumRefSegments.insert(m_NumRefSegments.end(), inOther.m_NumRefSegments.begin(), inOther.m_NumRefSegments.end());
+    m_NumTestSegments.insert(m_NumTestSegments.end(), inOther.m_NumTestSegments.begin(), inOther.m_NumTestSegments.end());
+    m_Recalls.insert(m_Recalls.end(), inOther.m_Recalls.begin(), inOther.m_Recalls.end());
+    m_Precisions.insert(m_Precisions.end(), inOther.m_Precisions.begin(), inOther.m_Precisions.end());
+    m_Fmeasures.insert(m_Fmeasures.end(), inOther.m_Fmeasures.begin(), inOther.m_Fmeasures.end());
+    m_MissedBoundaries.insert(m_MissedBoundaries.end(), inOther.m_MissedBoundaries.begin(), inOther.m_MissedBoundaries.end());
+    m_SegmentFragmentations.insert(m_SegmentFragmentations.end(), inOther.m_SegmentFragmentations.begin(), inOther.m_SegmentFragmentations.end());
+    m_CombinedHammingMeasureWorst.insert(m_CombinedHammingMeasureWorst.end(), inOther.m_CombinedHammingMeasureWorst.begin(), inOther.m_CombinedHammingMeasureWorst.end());
+    m_CombinedHammingMeasureHarmonic.insert(m_CombinedHammingMeasureHarmonic.end(), inOther.m_CombinedHammingMeasureHarmonic.begin(), inOther.m_CombinedHammingMeasureHarmonic.end());
+}
+
+void SegmentationEvaluation::save(std::ostream& inStream) const
+{
+    writeValues(inStream, m_Durations);
+    writeValues(inStream, m_NumRefSegments);
+    writeValues(inStream, m_NumTestSegments);
+    writeArrays(inStream, m_Recalls);
+    writeArrays(inStream, m_Precisions);
+    writeArrays(inStream, m_Fmeasures);
+    writeValues(inStream, m_MissedBoundaries);
+    writeValues(inStream, m_SegmentFragmentations);
+    writeValues(inStream, m_CombinedHammingMeasureWorst);
+    writeValues(inStream, m_CombinedHammingMeasureHarmonic);
+}
+
+void SegmentationEvaluation::restore(std::istream& inStream)
+{
+    readValues(inStream, m_Durations);
+    readValues(inStream, m_NumRefSegments);
+    readValues(inStream, m_NumTestSegments);
+    readArrays(inStream, m_Recalls);
+    readArrays(inStream, m_Precisions);
+    readArrays(inStream, m_Fmeasures);
+    readValues(inStream, m_MissedBoundaries);
+    readValues(inStream, m_SegmentFragmentations);
+    readValues(inStream, m_CombinedHammingMeasureWorst);
+    readValues(inStream, m_CombinedHammingMeasureHarmonic);
+    if (!inStream)
+    {
+        throw std::runtime_error("Could not read segmentation results");
+    }
+}
+
 void SegmentationEvaluation::addSequencePair(const LabelSequence& inRefSequence, const LabelSequence& inTestSequence)
 {
     //    class Onsetor //onset functor
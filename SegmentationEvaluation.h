@@ -10,6 +10,7 @@
  */
 //============================================================================
 #include <vector>
+#include <iosfwd>
 #include <Eigen/Core>
 #include "MusOO/TimedLabel.h"
 
@@ -23,6 +24,12 @@ public:
 	SegmentationEvaluation(const std::string& inVariant, const std::vector<double>& inTolerances);
     
     void reset();
+    /** Appends the results of all files evaluated by another instance. */
+    void append(const SegmentationEvaluation& inOther);
+    /** Writes the results of all files evaluated so far, such that restore
+        reads them back into another instance. */
+    void save(std::ostream& inStream) const;
+    void restore(std::istream& inStream);
 	void addSequencePair(const LabelSequence& inRefSequence, const LabelSequence& inTestSequence/*, double inStartTime, double inEndTime, std::ostream& inVerboseOStream, const double inDelay = 0.*/);
     
     // Get results of last file
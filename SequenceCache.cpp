@@ -0,0 +1,329 @@
+//============================================================================
+/**
+	Implementation file for SequenceCache.h
+
+	@author		agent
+	@date		20261016
+*/
+//============================================================================
+
+// Includes
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <iomanip>
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "MusOO/KeyQMUL.h"
+#include "MusOO/ChordQMUL.h"
+#include "MusOO/NoteMidi.h"
+#include "SequenceCache.h"
+#include "LabelInterner.h"
+#include "NoteText.h"
+
+using std::string;
+using std::vector;
+using boost::filesystem::path;
+using boost::uint32_t;
+using boost::uint64_t;
+using boost::int64_t;
+using namespace MusOO;
+
+namespace
+{
+	const char s_Magic[4] = {'M', 'S', 'Q', 'C'};
+	const uint32_t s_Version = 1;
+
+	// Followed by the segments, the end offsets of the labels, the key and the labels themselves
+	struct EntryHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t fileSize;
+		int64_t lastWriteTime;
+		uint32_t numOfSegments;
+		uint32_t numOfLabels;
+		uint32_t keySize;
+		uint32_t labelsSize;
+	};
+
+	bool getFileStatus(const path& inFilePath, uint64_t& outFileSize, int64_t& outLastWriteTime)
+	{
+		boost::system::error_code theError;
+		outFileSize = boost::filesystem::file_size(inFilePath, theError);
+		if (theError)
+		{
+			return false;
+		}
+		outLastWriteTime = boost::filesystem::last_write_time(inFilePath, theError);
+		return !theError;
+	}
+}
+
+SequenceCache::SequenceCache(const path& inCacheDir)
+: m_CacheDir(inCacheDir)
+{
+	boost::filesystem::create_directories(m_CacheDir);
+}
+
+SequenceCache::~SequenceCache()
+{
+}
+
+template <>
+const string SequenceCache::encodeLabel<Key>(const Key& inLabel)
+{
+	return KeyQMUL(inLabel).str();
+}
+
+template <>
+const Key SequenceCache::decodeLabel<Key>(const string& inText)
+{
+	return LabelInterner<KeyQMUL, Key>::intern(inText);
+}
+
+template <>
+const string SequenceCache::encodeLabel<Chord>(const Chord& inLabel)
+{
+	return ChordQMUL(inLabel).str();
+}
+
+template <>
+const Chord SequenceCache::decodeLabel<Chord>(const string& inText)
+{
+	return LabelInterner<ChordQMUL, Chord>::intern(inText);
+}
+
+template <>
+const string SequenceCache::encodeLabel<Note>(const Note& inLabel)
+{
+	if (inLabel == Note::silence())
+	{
+		return "N";
+	}
+	return boost::lexical_cast<string>(NoteMidi(inLabel).number());
+}
+
+template <>
+const Note SequenceCache::decodeLabel<Note>(const string& inText)
+{
+	return LabelInterner<NoteText, Note>::intern(inText);
+}
+
+template <typename T>
+bool SequenceCache::read(const path& inFilePath, const bool inIsReference, const string& inFormat, vector<TimedLabel<T> >& outSequence) const
+{
+	vector<Segment> theSegments;
+	vector<string> theLabelTexts;
+	if (!readEntry(inFilePath, createKey(inFilePath, inIsReference, inFormat), theSegments, theLabelTexts))
+	{
+		return false;
+	}
+	vector<T> theLabels;
+	theLabels.reserve(theLabelTexts.size());
+	for (size_t iLabel = 0; iLabel < theLabelTexts.size(); ++iLabel)
+	{
+		theLabels.push_back(decodeLabel<T>(theLabelTexts[iLabel]));
+	}
+	outSequence.clear();
+	outSequence.reserve(theSegments.size());
+	for (size_t iSegment = 0; iSegment < theSegments.size(); ++iSegment)
+	{
+		outSequence.push_back(TimedLabel<T>(theSegments[iSegment].onset, theSegments[iSegment].offset, theLabels[theSegments[iSegment].label]));
+	}
+	return true;
+}
+
+template <typename T>
+void SequenceCache::write(const path& inFilePath, const bool inIsReference, const string& inFormat, const vector<TimedLabel<T> >& inSequence) const
+{
+	vector<Segment> theSegments(inSequence.size());
+	vector<string> theLabelTexts;
+	vector<T> theLabels;
+	std::map<string, uint32_t> theLabelIndices;
+	try
+	{
+		for (size_t iSegment = 0; iSegment < inSequence.size(); ++iSegment)
+		{
+			const string theText = encodeLabel<T>(inSequence[iSegment].label());
+			std::map<string, uint32_t>::iterator theIndex = theLabelIndices.find(theText);
+			if (theIndex == theLabelIndices.end())
+			{
+				// Only store labels that come back unchanged
+				if (decodeLabel<T>(theText) != inSequence[iSegment].label())
+				{
+					return;
+				}
+				theIndex = theLabelIndices.insert(std::make_pair(theText, static_cast<uint32_t>(theLabelTexts.size()))).first;
+				theLabelTexts.push_back(theText);
+				theLabels.push_back(inSequence[iSegment].label());
+			}
+			else if (theLabels[theIndex->second] != inSequence[iSegment].label())
+			{
+				// Two different labels with the same text
+				return;
+			}
+			theSegments[iSegment].onset = inSequence[iSegment].onset();
+			theSegments[iSegment].offset = inSequence[iSegment].offset();
+			theSegments[iSegment].label = theIndex->second;
+			theSegments[iSegment].reserved = 0;
+		}
+	}
+	catch (std::exception&)
+	{
+		return;
+	}
+	writeEntry(inFilePath, createKey(inFilePath, inIsReference, inFormat), theSegments, theLabelTexts);
+}
+
+const string SequenceCache::createKey(const path& inFilePath, const bool inIsReference, const string& inFormat) const
+{
+	return boost::filesystem::absolute(inFilePath).string() + (inIsReference ? "\nref\n" : "\ntest\n") + inFormat;
+}
+
+const path SequenceCache::createEntryPath(const string& inKey) const
+{
+	std::ostringstream theName;
+	theName << std::hex << std::setfill('0') << std::setw(2*sizeof(size_t)) << boost::hash<string>()(inKey) << ".seq";
+	return m_CacheDir / theName.str();
+}
+
+bool SequenceCache::readEntry(const path& inFilePath, const string& inKey, vector<Segment>& outSegments, vector<string>& outLabels) const
+{
+	const path theEntryPath = createEntryPath(inKey);
+	uint64_t theFileSize;
+	int64_t theLastWriteTime;
+	boost::system::error_code theError;
+	if (!boost::filesystem::exists(theEntryPath, theError) || !getFileStatus(inFilePath, theFileSize, theLastWriteTime))
+	{
+		return false;
+	}
+	try
+	{
+		boost::interprocess::file_mapping theFile(theEntryPath.string().c_str(), boost::interprocess::read_only);
+		boost::interprocess::mapped_region theRegion(theFile, boost::interprocess::read_only);
+		const char* theData = static_cast<const char*>(theRegion.get_address());
+		const size_t theSize = theRegion.get_size();
+
+		EntryHeader theHeader;
+		if (theSize < sizeof(theHeader))
+		{
+			return false;
+		}
+		std::memcpy(&theHeader, theData, sizeof(theHeader));
+		const size_t theSegmentsSize = theHeader.numOfSegments * sizeof(Segment);
+		const size_t theLabelEndsSize = theHeader.numOfLabels * sizeof(uint32_t);
+		if (std::memcmp(theHeader.magic, s_Magic, sizeof(s_Magic)) != 0 || theHeader.version != s_Version ||
+			theHeader.fileSize != theFileSize || theHeader.lastWriteTime != theLastWriteTime ||
+			theSize != sizeof(theHeader) + theSegmentsSize + theLabelEndsSize + theHeader.keySize + theHeader.labelsSize)
+		{
+			return false;
+		}
+		const char* theSegments = theData + sizeof(theHeader);
+		const char* theLabelEnds = theSegments + theSegmentsSize;
+		const char* theKey = theLabelEnds + theLabelEndsSize;
+		const char* theLabels = theKey + theHeader.keySize;
+		// Different keys can hash to the same entry
+		if (inKey.compare(0, string::npos, theKey, theHeader.keySize) != 0)
+		{
+			return false;
+		}
+
+		outLabels.resize(theHeader.numOfLabels);
+		uint32_t theLabelBegin = 0;
+		for (size_t iLabel = 0; iLabel < outLabels.size(); ++iLabel)
+		{
+			uint32_t theLabelEnd;
+			std::memcpy(&theLabelEnd, theLabelEnds + iLabel * sizeof(uint32_t), sizeof(uint32_t));
+			if (theLabelEnd < theLabelBegin || theLabelEnd > theHeader.labelsSize)
+			{
+				return false;
+			}
+			outLabels[iLabel].assign(theLabels + theLabelBegin, theLabels + theLabelEnd);
+			theLabelBegin = theLabelEnd;
+		}
+		outSegments.resize(theHeader.numOfSegments);
+		if (theSegmentsSize > 0)
+		{
+			std::memcpy(&outSegments[0], theSegments, theSegmentsSize);
+		}
+		for (size_t iSegment = 0; iSegment < outSegments.size(); ++iSegment)
+		{
+			if (outSegments[iSegment].label >= theHeader.numOfLabels)
+			{
+				return false;
+			}
+		}
+	}
+	catch (std::exception&)
+	{
+		return false;
+	}
+	return true;
+}
+
+void SequenceCache::writeEntry(const path& inFilePath, const string& inKey, const vector<Segment>& inSegments, const vector<string>& inLabels) const
+{
+	EntryHeader theHeader;
+	std::memcpy(theHeader.magic, s_Magic, sizeof(s_Magic));
+	theHeader.version = s_Version;
+	if (!getFileStatus(inFilePath, theHeader.fileSize, theHeader.lastWriteTime))
+	{
+		return;
+	}
+	theHeader.numOfSegments = static_cast<uint32_t>(inSegments.size());
+	theHeader.numOfLabels = static_cast<uint32_t>(inLabels.size());
+	theHeader.keySize = static_cast<uint32_t>(inKey.size());
+	vector<uint32_t> theLabelEnds(inLabels.size());
+	string theLabels;
+	for (size_t iLabel = 0; iLabel < inLabels.size(); ++iLabel)
+	{
+		theLabels += inLabels[iLabel];
+		theLabelEnds[iLabel] = static_cast<uint32_t>(theLabels.size());
+	}
+	theHeader.labelsSize = static_cast<uint32_t>(theLabels.size());
+
+	// Write to a file of our own first, such that readers never see a partial entry
+	boost::system::error_code theError;
+	const path theTempPath = m_CacheDir / boost::filesystem::unique_path("%%%%-%%%%-%%%%-%%%%.tmp", theError);
+	if (theError)
+	{
+		return;
+	}
+	{
+		boost::filesystem::ofstream theFile(theTempPath, std::ios::binary);
+		theFile.write(reinterpret_cast<const char*>(&theHeader), sizeof(theHeader));
+		if (!inSegments.empty())
+		{
+			theFile.write(reinterpret_cast<const char*>(&inSegments[0]), inSegments.size() * sizeof(Segment));
+		}
+		if (!theLabelEnds.empty())
+		{
+			theFile.write(reinterpret_cast<const char*>(&theLabelEnds[0]), theLabelEnds.size() * sizeof(uint32_t));
+		}
+		theFile.write(inKey.data(), inKey.size());
+		theFile.write(theLabels.data(), theLabels.size());
+		if (!theFile.good())
+		{
+			theFile.close();
+			boost::filesystem::remove(theTempPath, theError);
+			return;
+		}
+	}
+	boost::filesystem::rename(theTempPath, createEntryPath(inKey), theError);
+	if (theError)
+	{
+		boost::filesystem::remove(theTempPath, theError);
+	}
+}
+
+template bool SequenceCache::read<Key>(const path&, const bool, const string&, vector<TimedLabel<Key> >&) const;
+template bool SequenceCache::read<Chord>(const path&, const bool, const string&, vector<TimedLabel<Chord> >&) const;
+template bool SequenceCache::read<Note>(const path&, const bool, const string&, vector<TimedLabel<Note> >&) const;
+template void SequenceCache::write<Key>(const path&, const bool, const string&, const vector<TimedLabel<Key> >&) const;
+template void SequenceCache::write<Chord>(const path&, const bool, const string&, const vector<TimedLabel<Chord> >&) const;
+template void SequenceCache::write<Note>(const path&, const bool, const string&, const vector<TimedLabel<Note> >&) const;
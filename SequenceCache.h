@@ -0,0 +1,70 @@
+#ifndef SequenceCache_h
+#define SequenceCache_h
+
+//============================================================================
+/**
+	Class representing an on-disk cache of parsed label sequences.
+
+	Every sequence is stored in its own file, which is memory mapped when
+	read. It consists of a header, the segments as fixed size records that
+	index a table of distinct labels and that table itself, such that every
+	label only needs to be parsed once per file. Entries are keyed by the
+	path, size and modification time of the annotation file and by the format
+	it was read with. New entries are written to a temporary file that is
+	renamed into place, so several processes can share a cache directory.
+
+	@author		agent
+	@date		20261016
+*/
+//============================================================================
+#include <string>
+#include <vector>
+#include <boost/filesystem/path.hpp>
+#include <boost/cstdint.hpp>
+#include "MusOO/TimedLabel.h"
+
+class SequenceCache
+{
+public:
+
+	/** Constructor. Creates the cache directory if it does not exist yet. */
+	SequenceCache(const boost::filesystem::path& inCacheDir);
+
+	/** Destructor. */
+	virtual ~SequenceCache();
+
+	/** Fills outSequence with the cached sequence of inFilePath read with
+		inFormat. Returns false if there is no such entry or if the file has
+		changed since the entry was written. */
+	template <typename T>
+	bool read(const boost::filesystem::path& inFilePath, const bool inIsReference, const std::string& inFormat, std::vector<MusOO::TimedLabel<T> >& outSequence) const;
+	/** Stores the sequence parsed from inFilePath with inFormat. Sequences
+		with labels that do not survive the conversion to text are skipped,
+		as are entries that cannot be written. */
+	template <typename T>
+	void write(const boost::filesystem::path& inFilePath, const bool inIsReference, const std::string& inFormat, const std::vector<MusOO::TimedLabel<T> >& inSequence) const;
+
+private:
+
+	struct Segment
+	{
+		double onset;
+		double offset;
+		boost::uint32_t label;
+		boost::uint32_t reserved;
+	};
+
+	const std::string createKey(const boost::filesystem::path& inFilePath, const bool inIsReference, const std::string& inFormat) const;
+	const boost::filesystem::path createEntryPath(const std::string& inKey) const;
+	bool readEntry(const boost::filesystem::path& inFilePath, const std::string& inKey, std::vector<Segment>& outSegments, std::vector<std::string>& outLabels) const;
+	void writeEntry(const boost::filesystem::path& inFilePath, const std::string& inKey, const std::vector<Segment>& inSegments, const std::vector<std::string>& inLabels) const;
+
+	template <typename T>
+	static const std::string encodeLabel(const T& inLabel);
+	template <typename T>
+	static const T decodeLabel(const std::string& inText);
+
+	const boost::filesystem::path m_CacheDir;
+};
+
+#endif	// #ifndef SequenceCache_h
@@ -0,0 +1,254 @@
+#ifndef ServedEvaluations_h
+#define ServedEvaluations_h
+
+//============================================================================
+/**
+	Template class representing the evaluations of a server for one kind of
+	label, together with the parsing of the jobs that clients send to it.
+
+	The presets are only constructed for the first job that selects them, and
+	every reference sequence is only parsed again after the contents of its
+	file have changed.
+
+	@author		agent
+	@date		20261017
+*/
+//============================================================================
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <limits>
+#include <iostream>
+#include <stdexcept>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/program_options.hpp>
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+#include "MusOO/TimedLabel.h"
+#include "MusOO/KeyQMUL.h"
+#include "MusOO/ChordQMUL.h"
+#include "MusOO/NoteMidi.h"
+#include "PairwiseEvaluation.h"
+#include "EvaluationJobs.h"
+#include "AnnotationFile.h"
+#include "MappedLabFile.h"
+#include "NoteText.h"
+
+/** Reads a job sent to the server, which consists of the single file options
+	of the command line, with one or more presets in any mode but 'globalkey'
+	and 'segmentation', on a single line. */
+inline void parseServerJob(const std::string& inLine, boost::program_options::variables_map& outVarMap)
+{
+	using boost::program_options::value;
+	boost::program_options::options_description theJobOptions;
+	theJobOptions.add_options()
+		("chords", value<std::vector<std::string> >()->multitoken(), "chords presets")
+		("keys", value<std::vector<std::string> >()->multitoken(), "keys presets")
+		("notes", value<std::vector<std::string> >()->multitoken(), "notes presets")
+		("reffile", value<boost::filesystem::path>(), "file with reference annotation")
+		("testfile", value<boost::filesystem::path>(), "file to evaluate, or '-' for the lines that follow the job")
+		("refformat", value<std::string>()->default_value("auto"), "format of the reference file")
+		("testformat", value<std::string>()->default_value("auto"), "format of the file under test")
+		("confusion", "Return the non-zero cells of the confusion matrices")
+		("begin", value<double>()->default_value(0.), "the start time in seconds")
+		("end", value<double>()->default_value(0.), "the end time in seconds")
+		("minduration", value<double>()->default_value(0.), "minimum duration of the reference labels")
+		("maxduration", value<double>()->default_value(std::numeric_limits<double>::infinity()), "maximum duration of the reference labels")
+		("delay", value<double>()->default_value(0.), "time delay of the file to evaluate")
+		;
+	boost::program_options::store(boost::program_options::command_line_parser(boost::program_options::split_unix(inLine)).options(theJobOptions).run(), outVarMap);
+	boost::program_options::notify(outVarMap);
+	if (outVarMap.count("chords") + outVarMap.count("keys") + outVarMap.count("notes") != 1)
+	{
+		throw std::invalid_argument("Please select a single 'chords', 'keys' or 'notes' mode");
+	}
+	if (outVarMap.count("reffile") == 0 || outVarMap.count("testfile") == 0)
+	{
+		throw std::invalid_argument("Please specifiy a reference and a test file");
+	}
+}
+
+template <typename T>
+class ServedEvaluations
+{
+public:
+
+	/** Constructor. Every job gets evaluated with inSettings, apart from the
+		formats that it selects itself. */
+	ServedEvaluations(const EvaluationSettings& inSettings);
+
+	/** Destructor. */
+	virtual ~ServedEvaluations();
+
+	/** Evaluates the files of inJob with every preset in inPresets, and
+		writes a line with the duration and score per preset to outResponse,
+		followed by the non-zero cells of its confusion matrix on request.
+		inInlineTest holds the sequence under test for a test file '-'. */
+	void evaluate(const boost::program_options::variables_map& inJob, const std::vector<std::string>& inPresets, const std::string& inInlineTest, std::ostream& outResponse);
+
+private:
+
+	ServedEvaluations(const ServedEvaluations&);
+	ServedEvaluations& operator=(const ServedEvaluations&);
+
+	struct ParsedSequence
+	{
+		bool isParsed;
+		// Of the file the sequence has been parsed from
+		std::string contentHash;
+		std::vector<MusOO::TimedLabel<T> > sequence;
+	};
+
+	PairwiseEvaluation<T>& getEvaluation(const std::string& inPreset);
+	const std::vector<MusOO::TimedLabel<T> >& readReference(const boost::filesystem::path& inRefPath, const EvaluationSettings& inSettings);
+
+	static bool parseInlineSequence(const std::string& inText, std::vector<MusOO::TimedLabel<T> >& outSequence);
+	static const std::string printLabel(const T& inLabel);
+
+	const EvaluationSettings* m_Settings;
+	std::map<std::string, PairwiseEvaluation<T>*> m_Evaluations;
+	// Per reference file and format
+	std::map<std::pair<boost::filesystem::path, std::string>, ParsedSequence> m_References;
+};
+
+template <typename T>
+ServedEvaluations<T>::ServedEvaluations(const EvaluationSettings& inSettings)
+: m_Settings(&inSettings)
+{
+}
+
+template <typename T>
+ServedEvaluations<T>::~ServedEvaluations()
+{
+	for (typename std::map<std::string, PairwiseEvaluation<T>*>::iterator i = m_Evaluations.begin(); i != m_Evaluations.end(); ++i)
+	{
+		delete i->second;
+	}
+}
+
+template <typename T>
+void ServedEvaluations<T>::evaluate(const boost::program_options::variables_map& inJob, const std::vector<std::string>& inPresets, const std::string& inInlineTest, std::ostream& outResponse)
+{
+	EvaluationSettings theSettings = *m_Settings;
+	theSettings.refFormat = inJob["refformat"].as<std::string>();
+	theSettings.testFormat = inJob["testformat"].as<std::string>();
+	const std::vector<MusOO::TimedLabel<T> >& theRefSequence = readReference(inJob["reffile"].as<boost::filesystem::path>(), theSettings);
+	std::vector<MusOO::TimedLabel<T> > theTestSequence;
+	if (inJob["testfile"].as<boost::filesystem::path>() == "-")
+	{
+		if (!parseInlineSequence(inInlineTest, theTestSequence))
+		{
+			throw std::runtime_error("The sequence under test is not in the three-column lab format");
+		}
+	}
+	else
+	{
+		readLabelSequence(inJob["testfile"].as<boost::filesystem::path>(), false, theSettings, theTestSequence);
+	}
+
+	typename PairwiseEvaluation<T>::SegmentPairSequence theSegmentPairs;
+	PairwiseEvaluation<T>::collectSegmentPairs(theRefSequence, theTestSequence, inJob["begin"].as<double>(), inJob["end"].as<double>(), theSegmentPairs, inJob["minduration"].as<double>(), inJob["maxduration"].as<double>(), inJob["delay"].as<double>(), theSettings.numOfChunks);
+	// A stream without buffer suppresses the verbose output
+	std::ostream theNoVerboseStream(NULL);
+	for (size_t iPreset = 0; iPreset < inPresets.size(); ++iPreset)
+	{
+		PairwiseEvaluation<T>& theEvaluation = getEvaluation(inPresets[iPreset]);
+		// Only the results of this job are needed
+		theEvaluation.reset();
+		theEvaluation.addSegmentPairs(theSegmentPairs, theNoVerboseStream, theSettings.numOfChunks);
+		outResponse << "result\t" << inPresets[iPreset] << "\t" << theEvaluation.getDuration() << "\t" << theEvaluation.getScore() << "\n";
+		if (inJob.count("confusion") > 0)
+		{
+			// Row-major, so the cells of every reference label come together
+			const Eigen::SparseMatrix<double, Eigen::RowMajor> theConfusionMatrix = theEvaluation.isSparse() ? Eigen::SparseMatrix<double, Eigen::RowMajor>(theEvaluation.getSparseConfusionMatrix()) : Eigen::SparseMatrix<double, Eigen::RowMajor>(theEvaluation.getConfusionMatrix().matrix().sparseView());
+			const std::vector<T>& theLabels = theEvaluation.getLabels();
+			for (int iRow = 0; iRow < theConfusionMatrix.outerSize(); ++iRow)
+			{
+				for (typename Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator theCell(theConfusionMatrix, iRow); theCell; ++theCell)
+				{
+					outResponse << "confusion\t" << inPresets[iPreset] << "\t" << printLabel(theLabels[theCell.row()]) << "\t" << printLabel(theLabels[theCell.col()]) << "\t" << theCell.value() << "\n";
+				}
+			}
+		}
+	}
+}
+
+template <typename T>
+PairwiseEvaluation<T>& ServedEvaluations<T>::getEvaluation(const std::string& inPreset)
+{
+	PairwiseEvaluation<T>*& theEvaluation = m_Evaluations[inPreset];
+	if (theEvaluation == NULL)
+	{
+		try
+		{
+			theEvaluation = new PairwiseEvaluation<T>(inPreset);
+		}
+		catch (...)
+		{
+			m_Evaluations.erase(inPreset);
+			throw;
+		}
+	}
+	return *theEvaluation;
+}
+
+template <typename T>
+const std::vector<MusOO::TimedLabel<T> >& ServedEvaluations<T>::readReference(const boost::filesystem::path& inRefPath, const EvaluationSettings& inSettings)
+{
+	const boost::filesystem::path theRefPath = boost::filesystem::absolute(inRefPath);
+	if (!AnnotationFile::exists(theRefPath, inSettings.archives))
+	{
+		throw std::runtime_error("'" + inRefPath.string() + "' is not an existing file");
+	}
+	// Unlike its size and modification time, the contents tell apart a file rewritten within the same second
+	const std::string theContentHash = AnnotationFile(theRefPath, inSettings.archives).hashContents();
+	ParsedSequence& theReference = m_References[std::make_pair(theRefPath, inSettings.refFormat)];
+	if (!theReference.isParsed || theReference.contentHash != theContentHash)
+	{
+		theReference.isParsed = false;
+		readLabelSequence(theRefPath, true, inSettings, theReference.sequence);
+		theReference.contentHash = theContentHash;
+		theReference.isParsed = true;
+	}
+	return theReference.sequence;
+}
+
+template <>
+inline bool ServedEvaluations<MusOO::Key>::parseInlineSequence(const std::string& inText, std::vector<MusOO::TimedLabel<MusOO::Key> >& outSequence)
+{
+	return MappedLabFile(inText.data(), inText.data() + inText.size()).readSegments<MusOO::KeyQMUL>(outSequence);
+}
+
+template <>
+inline const std::string ServedEvaluations<MusOO::Key>::printLabel(const MusOO::Key& inLabel)
+{
+	return MusOO::KeyQMUL(inLabel).str();
+}
+
+template <>
+inline bool ServedEvaluations<MusOO::Chord>::parseInlineSequence(const std::string& inText, std::vector<MusOO::TimedLabel<MusOO::Chord> >& outSequence)
+{
+	return MappedLabFile(inText.data(), inText.data() + inText.size()).readSegments<MusOO::ChordQMUL>(outSequence);
+}
+
+template <>
+inline const std::string ServedEvaluations<MusOO::Chord>::printLabel(const MusOO::Chord& inLabel)
+{
+	return MusOO::ChordQMUL(inLabel).str();
+}
+
+template <>
+inline bool ServedEvaluations<MusOO::Note>::parseInlineSequence(const std::string& inText, std::vector<MusOO::TimedLabel<MusOO::Note> >& outSequence)
+{
+	return MappedLabFile(inText.data(), inText.data() + inText.size()).readSegments<NoteText>(outSequence);
+}
+
+template <>
+inline const std::string ServedEvaluations<MusOO::Note>::printLabel(const MusOO::Note& inLabel)
+{
+	return MusOO::NoteMidi(inLabel).str();
+}
+
+#endif	// #ifndef ServedEvaluations_h
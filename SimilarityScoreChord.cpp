@@ -23,6 +23,17 @@ using std::invalid_argument;
 
 using namespace MusOO;
 
+size_t SimilarityScoreChord::ChordTypeHash::operator()(const ChordType& inChordType) const
+{
+	const set<Chroma> theChromas = Chord(s_firstChroma, inChordType).chromas();
+	size_t theHash = 0;
+	for (set<Chroma>::const_iterator theChromaIt = theChromas.begin(); theChromaIt != theChromas.end(); ++theChromaIt)
+	{
+		theHash |= size_t(1) << Interval(s_firstChroma, *theChromaIt).circleStepsCW();
+	}
+	return theHash;
+}
+
 SimilarityScoreChord::SimilarityScoreChord(const std::string& inPreset)
 {
 	if (!inPreset.compare("Mirex2009"))
@@ -185,8 +196,67 @@ SimilarityScoreChord::SimilarityScoreChord(const std::string& inPreset)
 
 void SimilarityScoreChord::initialize(const std::string& inMapping, const std::set<ChordType> inInputLimitingSet, const std::set<ChordType> inOutputLimitingSet, const std::string& inScoring)
 {
-	m_Mapping = inMapping;
-    m_Scoring = inScoring;
+	m_MappingName = inMapping;
+	if (inMapping == "mirex09")
+	{
+		m_Mapping = MappingMirex09;
+	}
+	else if (inMapping == "triads")
+	{
+		m_Mapping = MappingTriads;
+	}
+	else if (inMapping == "triadsWithBass")
+	{
+		m_Mapping = MappingTriadsWithBass;
+	}
+	else if (inMapping == "tetrads")
+	{
+		m_Mapping = MappingTetrads;
+	}
+	else if (inMapping == "tetradsWithBass")
+	{
+		m_Mapping = MappingTetradsWithBass;
+	}
+	else if (inMapping == "root")
+	{
+		m_Mapping = MappingRoot;
+	}
+	else if (inMapping == "bass")
+	{
+		m_Mapping = MappingBass;
+	}
+	else if (inMapping == "none")
+	{
+		m_Mapping = MappingNone;
+	}
+	else
+	{
+		throw runtime_error("Unknown mapping '" + inMapping + "'");
+	}
+	if (inScoring == "exact")
+	{
+		m_Scoring = ScoringExact;
+	}
+	else if (inScoring == "mirex2010")
+	{
+		m_Scoring = ScoringMirex2010;
+	}
+	else if (inScoring == "chromarecall")
+	{
+		m_Scoring = ScoringChromaRecall;
+	}
+	else if (inScoring == "chromaprecision")
+	{
+		m_Scoring = ScoringChromaPrecision;
+	}
+	else if (inScoring == "chromafmeasure")
+	{
+		m_Scoring = ScoringChromaFmeasure;
+	}
+	else
+	{
+		throw runtime_error("Unknown scoring function '" + inScoring + "'");
+	}
 	m_InputLimitingSet = inInputLimitingSet;
     m_MappedTypes.clear();
     this->m_Labels.clear();
@@ -205,13 +275,13 @@ void SimilarityScoreChord::initialize(const std::string& inMapping, const std::s
 	else
     {
         // Mapped types as used in confusion matrix are determined by mapping
-        if (!m_Mapping.compare("mirex09"))
+        if (m_Mapping == MappingMirex09)
         {
             m_MappedTypes.insert(ChordType::major());
             m_MappedTypes.insert(ChordType::minor());
             m_MappedTypes.insert(ChordType::none());
         }
-        else if (!m_Mapping.compare("triads"))
+        else if (m_Mapping == MappingTriads)
         {
             m_MappedTypes.insert(ChordType::major());
             m_MappedTypes.insert(ChordType::minor());
@@ -223,7 +293,7 @@ void SimilarityScoreChord::initialize(const std::string& inMapping, const std::s
             m_MappedTypes.insert(ChordType::minorSharpFifth());
             m_MappedTypes.insert(ChordType::none());
         }
-        else if (!m_Mapping.compare("triadsWithBass"))
+        else if (m_Mapping == MappingTriadsWithBass)
         {
             insertInversions(m_MappedTypes, ChordType::major());
             insertInversions(m_MappedTypes, ChordType::minor());
@@ -235,7 +305,7 @@ void SimilarityScoreChord::initialize(const std::string& inMapping, const std::s
             insertInversions(m_MappedTypes, ChordType::minorSharpFifth());
             m_MappedTypes.insert(ChordType::none());
         }
-        else if (!m_Mapping.compare("tetrads"))
+        else if (m_Mapping == MappingTetrads)
         {
             m_MappedTypes.insert(ChordType::major());
             m_MappedTypes.insert(ChordType::minor());
@@ -267,7 +337,7 @@ void SimilarityScoreChord::initialize(const std::string& inMapping, const std::s
             m_MappedTypes.insert(ChordType::suspendedSecond().addInterval(Interval::majorSixth()));
             m_MappedTypes.insert(ChordType::none());
         }
-        else if (!m_Mapping.compare("tetradsWithBass"))
+        else if (m_Mapping == MappingTetradsWithBass)
         {
             insertInversions(m_MappedTypes, ChordType::major());
             insertInversions(m_MappedTypes, ChordType::minor());
@@ -299,25 +369,21 @@ void SimilarityScoreChord::initialize(const std::string& inMapping, const std::s
             insertInversions(m_MappedTypes, ChordType::suspendedSecond().addInterval(Interval::majorSixth()));
             m_MappedTypes.insert(ChordType::none());
         }
-        else if (m_Mapping == "none" || m_Mapping == "bass" || m_Mapping == "root")
+        else
         {
             m_MappedTypes.insert(ChordType::rootOnly());
             m_MappedTypes.insert(ChordType::none());
         }
-        else
-        {
-            throw runtime_error("Unknown mapping '" + m_Mapping + "'");
-        }
     }
 
 	// If output limiting set specified, take intersection of output limiting and mapped set
 	if (!inOutputLimitingSet.empty())
 	{
-        if (m_Mapping == "bass" || m_Mapping == "root")
+        if (m_Mapping == MappingBass || m_Mapping == MappingRoot)
         {
-            throw invalid_argument("You can't use an output limiting set together with a '" + m_Mapping + "' mapping");
+            throw invalid_argument("You can't use an output limiting set together with a '" + m_MappingName + "' mapping");
         }
-        else if (m_Mapping == "none")
+        else if (m_Mapping == MappingNone)
         {
             m_MappedTypes = inOutputLimitingSet;
         }
@@ -338,6 +404,14 @@ void SimilarityScoreChord::initialize(const std::string& inMapping, const std::s
     }
     
 	m_NumOfMappedTypes = m_MappedTypes.size();
+    m_MappedTypeIndices.clear();
+    for (set<ChordType>::const_iterator theTypeIt = m_MappedTypes.begin(); theTypeIt != m_MappedTypes.end(); ++theTypeIt)
+    {
+        m_MappedTypeIndices.insert(std::make_pair(*theTypeIt, m_MappedTypeIndices.size()));
+    }
+    m_ChordIds.clear();
+    m_InternedChords.clear();
+    m_PairScores.clear();
     m_NumOfTrueChords = 12*m_NumOfMappedTypes;
     if (includeNoChords)
     {
@@ -350,7 +424,7 @@ void SimilarityScoreChord::initialize(const std::string& inMapping, const std::s
     
     // Generate labels from mapped chord types
     const vector<Chroma> theChromas = Chroma::circleOfFifths(s_firstChroma);
-    if (m_Mapping != "bass" && m_Mapping != "root" && m_Mapping != "none")
+    if (m_Mapping != MappingBass && m_Mapping != MappingRoot && m_Mapping != MappingNone)
     {
         this->m_NumOfTestLabels = m_NumOfTrueChords + 13;
         for (vector<Chroma>::const_iterator theChromaIt = theChromas.begin(); theChromaIt != theChromas.end(); ++theChromaIt)
@@ -384,25 +458,56 @@ SimilarityScoreChord::~SimilarityScoreChord()
 
 const double SimilarityScoreChord::score(const Chord& inRefChord, const Chord& inTestChord)
 {
-    this->m_RefIndex = calcChordIndex(inRefChord, this->m_MappedRefLabel);
-    this->m_TestIndex = calcChordIndex(inTestChord, this->m_MappedTestLabel);
+    const size_t theRefId = internChord(inRefChord);
+    const size_t theTestId = internChord(inTestChord);
+    ChordMapping& theRefMapping = m_InternedChords[theRefId];
+    ChordMapping& theTestMapping = m_InternedChords[theTestId];
+    this->m_RefIndex = theRefMapping.index;
+    this->m_MappedRefLabel = theRefMapping.mappedChord;
+    this->m_TestIndex = theTestMapping.index;
+    this->m_MappedTestLabel = theTestMapping.mappedChord;
+
+    // Score table is filled lazily, since the chord vocabulary is open
+    if (theRefId >= m_PairScores.size())
+    {
+        m_PairScores.resize(theRefId + 1);
+    }
+    if (theTestId >= m_PairScores[theRefId].size())
+    {
+        m_PairScores[theRefId].resize(theTestId + 1);
+    }
+    PairScore& thePairScore = m_PairScores[theRefId][theTestId];
+    if (!thePairScore.isKnown)
+    {
+        thePairScore.score = calcScore(theRefMapping, theTestMapping);
+        thePairScore.testIndex = this->m_TestIndex;
+        thePairScore.isKnown = true;
+    }
+    this->m_TestIndex = thePairScore.testIndex;
+    return thePairScore.score;
+}
+
+const double SimilarityScoreChord::calcScore(ChordMapping& ioRefMapping, ChordMapping& ioTestMapping)
+{
+    const Chord& inRefChord = ioRefMapping.chord;
+    const Chord& inTestChord = ioTestMapping.chord;
     
     // Check input and output limiting set and check for unmappable chords in reference sequence
-    if ((m_InputLimitingSet.empty() || m_InputLimitingSet.count(inRefChord.type()) > 0) &&
+    if (ioRefMapping.inInputLimitingSet &&
         //(m_OutputLimitingSet.empty() || m_OutputLimitingSet.count(this->m_MappedRefLabel.type()) > 0) &&
         (this->m_RefIndex < this->m_NumOfRefLabels))
     {
         // Check for unmappable chords in test sequence
         if ((this->m_MappedTestLabel.type() == ChordType::rootOnly() ||
              this->m_MappedTestLabel.type() == ChordType::power()) &&
-            m_Mapping != "root" && m_Mapping != "bass" && m_Mapping != "none")
+            m_Mapping != MappingRoot && m_Mapping != MappingBass && m_Mapping != MappingNone)
         {
             throw invalid_argument("The chord '" + ChordQMUL(inTestChord).str() + "' in the test sequence cannot be mapped using the current evaluating rules");
         }
         
-        if (m_Scoring == "exact")
+        if (m_Scoring == ScoringExact)
         {
-            if (inRefChord.root() == inTestChord.root() && calcMappedChordType(inRefChord.type().withoutSpelling()) == calcMappedChordType(inTestChord.type().withoutSpelling()))
+            if (inRefChord.root() == inTestChord.root() && lookupMappedUnspelledType(inRefChord, ioRefMapping) == lookupMappedUnspelledType(inTestChord, ioTestMapping))
             {
                 this->m_TestIndex = this->m_RefIndex; //in case unspelled original chord gets mapped to a different chord than the spelled original
                 return 1.;
@@ -412,7 +517,7 @@ const double SimilarityScoreChord::score(const Chord& inRefChord, const Chord& i
                 return 0.;
             }
         }
-        else if (m_Scoring == "mirex2010")
+        else if (m_Scoring == ScoringMirex2010)
         {
             size_t theNumOfCommonChromas = inRefChord.commonChromas(inTestChord).size();
             if (theNumOfCommonChromas > 2 ||
@@ -426,7 +531,7 @@ const double SimilarityScoreChord::score(const Chord& inRefChord, const Chord& i
                 return 0.;
             }
         }
-        else if (m_Scoring == "chromarecall")
+        else if (m_Scoring == ScoringChromaRecall)
         {
             if (inRefChord.isTrueChord())
             {
@@ -445,7 +550,7 @@ const double SimilarityScoreChord::score(const Chord& inRefChord, const Chord& i
                 }
             }
         }
-        else if (m_Scoring == "chromaprecision")
+        else if (m_Scoring == ScoringChromaPrecision)
         {
             if (inTestChord.isTrueChord())
             {
@@ -463,7 +568,7 @@ const double SimilarityScoreChord::score(const Chord& inRefChord, const Chord& i
                 }
             }
         }
-        else if (m_Scoring == "chromafmeasure")
+        else // ScoringChromaFmeasure
         {
             if (inRefChord.isTrueChord() && inTestChord.isTrueChord())
             {
@@ -481,10 +586,6 @@ const double SimilarityScoreChord::score(const Chord& inRefChord, const Chord& i
                 }
             }
         }
-        else
-        {
-            throw runtime_error("Unknown scoring function '" + m_Scoring + "'");
-        }
     }
     else
     {
@@ -493,6 +594,34 @@ const double SimilarityScoreChord::score(const Chord& inRefChord, const Chord& i
     }
 }
 
+const size_t SimilarityScoreChord::internChord(const MusOO::Chord& inChord)
+{
+    const std::pair<Chroma, ChordType> theKey(inChord.root(), inChord.type());
+    std::map<std::pair<Chroma, ChordType>, size_t>::const_iterator theIdIt = m_ChordIds.find(theKey);
+    if (theIdIt == m_ChordIds.end())
+    {
+        ChordMapping theMapping;
+        theMapping.chord = inChord;
+        theMapping.index = calcChordIndex(inChord, theMapping.mappedChord);
+        theMapping.inInputLimitingSet = m_InputLimitingSet.empty() || m_InputLimitingSet.count(inChord.type()) > 0;
+        // Only needed (and defined) for exact scoring, so filled in on first use
+        theMapping.hasMappedUnspelledType = false;
+        m_InternedChords.push_back(theMapping);
+        theIdIt = m_ChordIds.insert(std::make_pair(theKey, m_InternedChords.size() - 1)).first;
+    }
+    return theIdIt->second;
+}
+
+const ChordType& SimilarityScoreChord::lookupMappedUnspelledType(const MusOO::Chord& inChord, ChordMapping& ioMapping) const
+{
+    if (!ioMapping.hasMappedUnspelledType)
+    {
+        ioMapping.mappedUnspelledType = calcMappedChordType(inChord.type().withoutSpelling());
+        ioMapping.hasMappedUnspelledType = true;
+    }
+    return ioMapping.mappedUnspelledType;
+}
+
 const size_t SimilarityScoreChord::calcChordIndex(const MusOO::Chord& inChord, MusOO::Chord& outMappedChord) const
 {
 	if (inChord == Chord::silence() || inChord == Chord::none())
@@ -505,7 +634,7 @@ const size_t SimilarityScoreChord::calcChordIndex(const MusOO::Chord& inChord, M
         outMappedChord = Chord::undefined();
         return this->m_NumOfTestLabels;
     }
-    else if (m_Mapping == "bass")
+    else if (m_Mapping == MappingBass)
     {
         outMappedChord = Chord(inChord.bass(true), ChordType::rootOnly());
         return Interval(s_firstChroma, inChord.bass(true)).circleStepsCW();
@@ -514,12 +643,12 @@ const size_t SimilarityScoreChord::calcChordIndex(const MusOO::Chord& inChord, M
 	{
         const ChordType theMappedChordType = calcMappedChordType(inChord.type());
         outMappedChord = Chord(inChord.root(), theMappedChordType);
-        set<ChordType>::const_iterator theTypeIt = m_MappedTypes.find(theMappedChordType);
+        boost::unordered_map<ChordType, size_t, ChordTypeHash>::const_iterator theTypeIt = m_MappedTypeIndices.find(theMappedChordType);
 		// Check whether the type belongs to the mapped set
-		if (theTypeIt != m_MappedTypes.end())
+		if (theTypeIt != m_MappedTypeIndices.end())
 		{
             int theRootIndex = Interval(s_firstChroma, inChord.root()).circleStepsCW();
-			return theRootIndex * m_NumOfMappedTypes + distance(m_MappedTypes.begin(), theTypeIt);
+			return theRootIndex * m_NumOfMappedTypes + theTypeIt->second;
 		}
         else if (theMappedChordType != ChordType::rootOnly() && theMappedChordType != ChordType::power())
         {
@@ -538,33 +667,34 @@ const size_t SimilarityScoreChord::calcChordIndex(const MusOO::Chord& inChord, M
 const ChordType SimilarityScoreChord::calcMappedChordType(const ChordType& inChordType) const
 {
     //mapping
-    if (!m_Mapping.compare("mirex09"))
+    if (m_Mapping == MappingMirex09)
     {
         return mirexMapping(inChordType);
     }
-    else if (!m_Mapping.compare("triads"))
+    else if (m_Mapping == MappingTriads)
     {
         return inChordType.triad(false);
     }
-    else if (!m_Mapping.compare("triadsWithBass"))
+    else if (m_Mapping == MappingTriadsWithBass)
     {
         return inChordType.triad(true);
     }
-    else if (!m_Mapping.compare("tetrads"))
+    else if (m_Mapping == MappingTetrads)
     {
         return inChordType.tetrad(false);
     }
-    else if (!m_Mapping.compare("tetradsWithBass"))
+    else if (m_Mapping == MappingTetradsWithBass)
     {
         return inChordType.tetrad(true);
     }
-    else if (m_Mapping == "none" || m_Mapping == "root" || m_Mapping == "rootWithBass")
+    else if (m_Mapping == MappingNone || m_Mapping == MappingRoot)
     {
         return ChordType::rootOnly();
     }
     else
     {
-        throw runtime_error("Unknown mapping '" + m_Mapping + "'");
+        // The bass mapping has no chord type equivalent
+        throw runtime_error("Unknown mapping '" + m_MappingName + "'");
     }
 }
 
@@ -9,6 +9,10 @@
 	@date		20100915
 */
 //============================================================================
+#include <map>
+#include <vector>
+#include <utility>
+#include <boost/unordered_map.hpp>
 #include "SimilarityScore.h"
 #include "MusOO/Chord.h"
 
@@ -28,17 +32,59 @@ protected:
 
 
 private:
+	/** Chord mappings and scoring functions, resolved from their names once
+		at initialisation so that scoring never has to compare strings. */
+	enum Mapping { MappingMirex09, MappingTriads, MappingTriadsWithBass, MappingTetrads, MappingTetradsWithBass, MappingRoot, MappingBass, MappingNone };
+	enum Scoring { ScoringExact, ScoringMirex2010, ScoringChromaRecall, ScoringChromaPrecision, ScoringChromaFmeasure };
+
+	/** Everything about a chord that the scoring needs and that only depends
+		on the chord itself, memoized per distinct (root, type). */
+	struct ChordMapping
+	{
+		MusOO::Chord chord;
+		size_t index;
+		MusOO::Chord mappedChord;
+		bool inInputLimitingSet;
+		bool hasMappedUnspelledType;
+		MusOO::ChordType mappedUnspelledType;
+	};
+	/** Score of a pair of interned chords, together with the test index it
+		is accounted to in the confusion matrix. */
+	struct PairScore
+	{
+		PairScore() : isKnown(false), score(0.), testIndex(0) {}
+		bool isKnown;
+		double score;
+		size_t testIndex;
+	};
+
+	/** Hashes a chord type by the pitch classes it holds relative to its
+		root, so the mapped types can be looked up in constant time.
+		Inversions of a type share their hash. */
+	struct ChordTypeHash
+	{
+		size_t operator()(const MusOO::ChordType& inChordType) const;
+	};
+
+	const size_t internChord(const MusOO::Chord& inChord);
+	const double calcScore(ChordMapping& ioRefMapping, ChordMapping& ioTestMapping);
+	const MusOO::ChordType& lookupMappedUnspelledType(const MusOO::Chord& inChord, ChordMapping& ioMapping) const;
 	void initialize(const std::string& inMapping, const std::set<MusOO::ChordType> inInputLimitingSet, const std::set<MusOO::ChordType> inOutputLimitingSet, const std::string& inScoring);
 	const size_t calcChordIndex(const MusOO::Chord& inChord, MusOO::Chord& outMappedChord) const;
     const MusOO::ChordType calcMappedChordType(const MusOO::ChordType& inChordType) const;
 	const MusOO::ChordType mirexMapping(const MusOO::ChordType& inChordType) const;
     void insertInversions(std::set<MusOO::ChordType>& inSet, const MusOO::ChordType& inChordType) const;
 
-	std::string m_Mapping;
+	Mapping m_Mapping;
+	std::string m_MappingName;
 	std::set<MusOO::ChordType> m_InputLimitingSet;
 	std::set<MusOO::ChordType> m_MappedTypes;
+	boost::unordered_map<MusOO::ChordType, size_t, ChordTypeHash> m_MappedTypeIndices;
+	std::map<std::pair<MusOO::Chroma, MusOO::ChordType>, size_t> m_ChordIds;
+	std::vector<ChordMapping> m_InternedChords;
+	std::vector<std::vector<PairScore> > m_PairScores;
 	size_t m_NumOfMappedTypes;
-    std::string m_Scoring;
+    Scoring m_Scoring;
     size_t m_NumOfTrueChords;
 };
 
@@ -19,25 +19,26 @@ using namespace MusOO;
 
 SimilarityScoreKey::SimilarityScoreKey(const std::string& inScoreSelect)
 {
+	Eigen::Array<double, 2, 12> theScoreMatrix;
 	if (!inScoreSelect.compare("Mirex"))
 	{
-		m_ScoreMatrix << 
+		theScoreMatrix << 
 			(Eigen::Array<double,1,12>() << 1., 0.5, 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.5).finished(), 
 			(Eigen::Array<double,1,12>() << 0.2, 0., 0., 0.3, 0., 0., 0., 0., 0., 0., 0., 0.).finished();
 	}
 	else if (!inScoreSelect.compare("Binary"))
 	{
-		m_ScoreMatrix << 
+		theScoreMatrix << 
 			(Eigen::Array<double,1,12>() << 1., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.).finished(), 
 			(Eigen::Array<double,1,12>() << 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.).finished();
 	}
 	else if (!inScoreSelect.compare("Lerdahl"))
 	{
-		m_ScoreMatrix << 
+		theScoreMatrix << 
 			(Eigen::Array<double,1,12>() << 0., 7., 14., 14., 16., 23., 30., 23., 16., 14., 14., 7.).finished(), 
 			(Eigen::Array<double,1,12>() << 7., 14., 10., 7., 9., 16., 21., 23., 23., 21., 21., 14.).finished();
-		m_ScoreMatrix /= m_ScoreMatrix.rowwise().mean().replicate(1,12);
-		m_ScoreMatrix = m_ScoreMatrix.exp();
+		theScoreMatrix /= theScoreMatrix.rowwise().mean().replicate(1,12);
+		theScoreMatrix = theScoreMatrix.exp();
 	}
 	else
 	{
@@ -52,6 +53,14 @@ SimilarityScoreKey::SimilarityScoreKey(const std::string& inScoreSelect)
 			i%2==0?Mode::major():Mode::minorNatural());
 	}
 	this->m_Labels.back() = Key::silence();
+	// Tabulate all label pairs, the label index serving as dense id
+	for (size_t iRef = 0; iRef < this->m_NumOfRefLabels; ++iRef)
+	{
+		for (size_t iTest = 0; iTest < this->m_NumOfTestLabels; ++iTest)
+		{
+			m_ScoreTable(iRef,iTest) = calcScore(m_Labels[iRef], m_Labels[iTest], theScoreMatrix);
+		}
+	}
 }
 
 SimilarityScoreKey::~SimilarityScoreKey()
@@ -63,10 +72,14 @@ const double SimilarityScoreKey::score(const Key& inRefKey, const Key& inTestKey
 {
 	this->m_RefIndex = calcKeyIndex(inRefKey);
 	this->m_TestIndex = calcKeyIndex(inTestKey);
+	return m_ScoreTable(this->m_RefIndex, this->m_TestIndex);
+}
 
-	if (this->m_RefIndex == 24 || this->m_TestIndex == 24)
+const double SimilarityScoreKey::calcScore(const Key& inRefKey, const Key& inTestKey, const Eigen::Array<double, 2, 12>& inScoreMatrix) const
+{
+	if (inRefKey == Key::silence() || inTestKey == Key::silence())
 	{
-        return (this->m_RefIndex == this->m_TestIndex)?1.:0.;
+        return (inRefKey == inTestKey)?1.:0.;
 	}
 	else
 	{
@@ -74,11 +87,11 @@ const double SimilarityScoreKey::score(const Key& inRefKey, const Key& inTestKey
 		int theClockwiseDistance = Interval(inRefKey.tonic(), inTestKey.tonic()).circleStepsCW();
 		if (inRefKey.mode().isMajor())
 		{
-			return m_ScoreMatrix(inTestKey.mode().isMajor()?0:1,theClockwiseDistance);
+			return inScoreMatrix(inTestKey.mode().isMajor()?0:1,theClockwiseDistance);
 		}
 		else
 		{
-			return m_ScoreMatrix(inTestKey.mode().isMajor()?1:0,(12-theClockwiseDistance)%12);
+			return inScoreMatrix(inTestKey.mode().isMajor()?1:0,(12-theClockwiseDistance)%12);
 		}
 	}
 }
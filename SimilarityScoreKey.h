@@ -33,7 +33,8 @@ protected:
 private:
 
 	const size_t calcKeyIndex(const MusOO::Key& inKey);
-	Eigen::Array<double, 2, 12> m_ScoreMatrix;
+	const double calcScore(const MusOO::Key& inRefKey, const MusOO::Key& inTestKey, const Eigen::Array<double, 2, 12>& inScoreMatrix) const;
+	Eigen::Array<double, 25, 25> m_ScoreTable;
 
 };
 
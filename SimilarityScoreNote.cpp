@@ -34,6 +34,12 @@ SimilarityScoreNote::SimilarityScoreNote(const std::string& inScoreSelect)
 		m_Labels[i] = NoteMidi(m_LowestNote.number()+i);
 	}
 	this->m_Labels.back() = Note::silence();
+	// Tabulate all label pairs, the label index serving as dense id
+	m_ScoreTable = Eigen::ArrayXXd::Zero(this->m_NumOfRefLabels, this->m_NumOfTestLabels);
+	for (size_t i = 0; i < this->m_NumOfRefLabels; ++i)
+	{
+		m_ScoreTable(i,i) = 1.;
+	}
 }
 
 SimilarityScoreNote::~SimilarityScoreNote()
@@ -46,7 +52,12 @@ const double SimilarityScoreNote::score(const Note& inRef, const Note& inTest)
 	this->m_RefIndex = NoteMidi(inRef).number() - m_LowestNote.number();
 	this->m_TestIndex = NoteMidi(inTest).number() - m_LowestNote.number();
 
-	if (this->m_RefIndex == this->m_TestIndex)
+	if (this->m_RefIndex < this->m_NumOfRefLabels && this->m_TestIndex < this->m_NumOfTestLabels)
+	{
+		return m_ScoreTable(this->m_RefIndex, this->m_TestIndex);
+	}
+	// Notes outside of the tabulated range
+	else if (this->m_RefIndex == this->m_TestIndex)
 	{
 		return 1.;
 	}
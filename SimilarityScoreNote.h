@@ -31,6 +31,7 @@ protected:
 private:
 
 	MusOO::NoteMidi m_LowestNote;
+	Eigen::ArrayXXd m_ScoreTable;
 
 
 };
@@ -0,0 +1,262 @@
+//============================================================================
+/**
+	Implementation file for TarArchive.h
+
+	@author		agent
+	@date		20261016
+*/
+//============================================================================
+
+// Includes
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <boost/cstdint.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_streambuf.hpp>
+#include "TarArchive.h"
+
+using std::string;
+using std::runtime_error;
+using boost::filesystem::path;
+using boost::uint64_t;
+
+namespace
+{
+	const size_t s_BlockSize = 512;
+
+	const string readText(const char* inField, const size_t inMaxSize)
+	{
+		return string(inField, std::find(inField, inField + inMaxSize, '\0'));
+	}
+
+	/** Reads an octal number, or a base-256 one for large sizes. */
+	bool readNumber(const char* inField, const size_t inSize, uint64_t& outNumber)
+	{
+		outNumber = 0;
+		if (static_cast<unsigned char>(inField[0]) & 0x80)
+		{
+			outNumber = static_cast<unsigned char>(inField[0]) & 0x7f;
+			for (size_t i = 1; i < inSize; ++i)
+			{
+				outNumber = (outNumber << 8) | static_cast<unsigned char>(inField[i]);
+			}
+			return true;
+		}
+		size_t i = 0;
+		while (i < inSize && inField[i] == ' ')
+		{
+			++i;
+		}
+		for (; i < inSize && inField[i] >= '0' && inField[i] <= '7'; ++i)
+		{
+			outNumber = 8 * outNumber + (inField[i] - '0');
+		}
+		return i == inSize || inField[i] == '\0' || inField[i] == ' ';
+	}
+
+	/** Sums the bytes of a header, with the checksum field itself counting as spaces. */
+	uint64_t calcChecksum(const char* inHeader)
+	{
+		uint64_t theChecksum = 8 * ' ';
+		for (size_t i = 0; i < s_BlockSize; ++i)
+		{
+			if (i < 148 || i >= 156)
+			{
+				theChecksum += static_cast<unsigned char>(inHeader[i]);
+			}
+		}
+		return theChecksum;
+	}
+
+	/** Finds the path among the "<length> <key>=<value>\n" records of a pax header. */
+	const string readPaxPath(const char* inBegin, const char* inEnd)
+	{
+		string thePath;
+		while (inBegin < inEnd)
+		{
+			const char* theSpace = std::find(inBegin, inEnd, ' ');
+			size_t theLength = 0;
+			for (const char* theDigit = inBegin; theDigit < theSpace && *theDigit >= '0' && *theDigit <= '9'; ++theDigit)
+			{
+				theLength = 10 * theLength + (*theDigit - '0');
+			}
+			if (theSpace == inEnd || theLength == 0 || theLength > static_cast<size_t>(inEnd - inBegin))
+			{
+				break;
+			}
+			const char* theRecordEnd = inBegin + theLength;
+			const char* theEquals = std::find(theSpace + 1, theRecordEnd, '=');
+			if (theEquals != theRecordEnd && string(theSpace + 1, theEquals) == "path")
+			{
+				thePath.assign(theEquals + 1, theRecordEnd - 1);
+			}
+			inBegin = theRecordEnd;
+		}
+		return thePath;
+	}
+}
+
+TarArchive::TarArchive(const path& inArchivePath)
+: m_Path(inArchivePath), m_Data(NULL), m_Size(0)
+{
+	try
+	{
+		// Empty files cannot be mapped
+		if (boost::filesystem::file_size(m_Path) > 0)
+		{
+			boost::interprocess::file_mapping theFile(m_Path.string().c_str(), boost::interprocess::read_only);
+			boost::interprocess::mapped_region(theFile, boost::interprocess::read_only).swap(m_Region);
+			m_Data = static_cast<const char*>(m_Region.get_address());
+			m_Size = m_Region.get_size();
+		}
+	}
+	catch (std::exception&)
+	{
+		throw runtime_error("Could not open archive '" + m_Path.string() + "'");
+	}
+	if (m_Size >= 2 && static_cast<unsigned char>(m_Data[0]) == 0x1f && static_cast<unsigned char>(m_Data[1]) == 0x8b)
+	{
+		// A compressed archive cannot be read at random, so decompress it once
+		try
+		{
+			boost::iostreams::filtering_streambuf<boost::iostreams::input> theCompressedData;
+			theCompressedData.push(boost::iostreams::gzip_decompressor());
+			theCompressedData.push(boost::iostreams::array_source(m_Data, m_Size));
+			boost::iostreams::copy(theCompressedData, boost::iostreams::back_inserter(m_DecompressedData));
+		}
+		catch (std::exception&)
+		{
+			throw runtime_error("Could not decompress archive '" + m_Path.string() + "'");
+		}
+		boost::interprocess::mapped_region().swap(m_Region);
+		m_Data = m_DecompressedData.empty() ? NULL : &m_DecompressedData[0];
+		m_Size = m_DecompressedData.size();
+	}
+	index();
+}
+
+TarArchive::~TarArchive()
+{
+}
+
+bool TarArchive::findMember(const path& inFilePath, const char*& outBegin, const char*& outEnd) const
+{
+	path::const_iterator theFileIt = inFilePath.begin();
+	for (path::const_iterator theArchiveIt = m_Path.begin(); theArchiveIt != m_Path.end(); ++theArchiveIt, ++theFileIt)
+	{
+		if (theFileIt == inFilePath.end() || *theFileIt != *theArchiveIt)
+		{
+			return false;
+		}
+	}
+	string theName;
+	for (; theFileIt != inFilePath.end(); ++theFileIt)
+	{
+		if (*theFileIt != ".")
+		{
+			theName += (theName.empty() ? "" : "/") + theFileIt->string();
+		}
+	}
+	boost::unordered_map<string, std::pair<size_t, size_t> >::const_iterator theMember = m_Members.find(theName);
+	if (theMember == m_Members.end() && !m_RootDirectory.empty())
+	{
+		theMember = m_Members.find(m_RootDirectory + theName);
+	}
+	if (theMember == m_Members.end())
+	{
+		return false;
+	}
+	outBegin = m_Data + theMember->second.first;
+	outEnd = outBegin + theMember->second.second;
+	return true;
+}
+
+const path& TarArchive::getPath() const
+{
+	return m_Path;
+}
+
+void TarArchive::index()
+{
+	// Set by the GNU or pax header that precedes a file with a long name
+	string theLongName;
+	size_t theOffset = 0;
+	while (theOffset + s_BlockSize <= m_Size)
+	{
+		const char* theHeader = m_Data + theOffset;
+		// The archive ends with blocks of zeros
+		if (std::count(theHeader, theHeader + s_BlockSize, '\0') == static_cast<std::ptrdiff_t>(s_BlockSize))
+		{
+			break;
+		}
+		uint64_t theChecksum;
+		uint64_t theSize;
+		if (!readNumber(theHeader + 148, 8, theChecksum) || theChecksum != calcChecksum(theHeader) || !readNumber(theHeader + 124, 12, theSize))
+		{
+			throw runtime_error("'" + m_Path.string() + "' is not a valid tar archive");
+		}
+		const size_t theDataOffset = theOffset + s_BlockSize;
+		if (theSize > m_Size - theDataOffset)
+		{
+			throw runtime_error("The archive '" + m_Path.string() + "' is truncated");
+		}
+		const char theType = theHeader[156];
+		if (theType == 'L')
+		{
+			theLongName = readText(m_Data + theDataOffset, theSize);
+		}
+		else if (theType == 'x')
+		{
+			theLongName = readPaxPath(m_Data + theDataOffset, m_Data + theDataOffset + theSize);
+		}
+		else
+		{
+			if (theType == '0' || theType == '\0' || theType == '7')
+			{
+				string theName = theLongName;
+				if (theName.empty())
+				{
+					theName = readText(theHeader, 100);
+					const string thePrefix = readText(theHeader + 345, 155);
+					if (std::memcmp(theHeader + 257, "ustar", 6) == 0 && !thePrefix.empty())
+					{
+						theName = thePrefix + "/" + theName;
+					}
+				}
+				while (theName.compare(0, 2, "./") == 0)
+				{
+					theName.erase(0, 2);
+				}
+				m_Members[theName] = std::make_pair(theDataOffset, static_cast<size_t>(theSize));
+			}
+			theLongName.clear();
+		}
+		theOffset = theDataOffset + (theSize + s_BlockSize - 1) / s_BlockSize * s_BlockSize;
+	}
+
+	// Archives are often made of a single directory, which is left out of the names in the list
+	if (!m_Members.empty())
+	{
+		const string& theFirstName = m_Members.begin()->first;
+		const size_t theSeparator = theFirstName.find('/');
+		if (theSeparator != string::npos)
+		{
+			const string theRootDirectory = theFirstName.substr(0, theSeparator + 1);
+			boost::unordered_map<string, std::pair<size_t, size_t> >::const_iterator theMember = m_Members.begin();
+			while (theMember != m_Members.end() && theMember->first.compare(0, theRootDirectory.size(), theRootDirectory) == 0)
+			{
+				++theMember;
+			}
+			if (theMember == m_Members.end())
+			{
+				m_RootDirectory = theRootDirectory;
+			}
+		}
+	}
+}
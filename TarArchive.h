@@ -0,0 +1,58 @@
+#ifndef TarArchive_h
+#define TarArchive_h
+
+//============================================================================
+/**
+	Class representing a tar archive of annotation files, which can be read
+	without unpacking it.
+
+	An uncompressed archive is memory mapped, a gzip-compressed one is
+	decompressed into memory once. The regular files in it are indexed when
+	the archive is opened, such that they can be looked up as if the archive
+	were a directory. When all files lie in the same top-level directory,
+	they can be looked up without it too.
+
+	@author		agent
+	@date		20261016
+*/
+//============================================================================
+#include <string>
+#include <vector>
+#include <utility>
+#include <boost/filesystem/path.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/unordered_map.hpp>
+
+class TarArchive
+{
+public:
+
+	/** Constructor. Opens and indexes the archive at inArchivePath. Throws if
+		it cannot be read or is not a tar archive. */
+	TarArchive(const boost::filesystem::path& inArchivePath);
+
+	/** Destructor. */
+	virtual ~TarArchive();
+
+	/** Finds the contents of inFilePath, which refers to a file in the archive
+		by appending its name to the path of the archive. Returns false if
+		inFilePath does not lie in the archive or if there is no such file. */
+	bool findMember(const boost::filesystem::path& inFilePath, const char*& outBegin, const char*& outEnd) const;
+
+	const boost::filesystem::path& getPath() const;
+
+private:
+
+	void index();
+
+	const boost::filesystem::path m_Path;
+	boost::interprocess::mapped_region m_Region;
+	std::vector<char> m_DecompressedData;
+	const char* m_Data;
+	size_t m_Size;
+	// Offset and size of every regular file by name
+	boost::unordered_map<std::string, std::pair<size_t, size_t> > m_Members;
+	std::string m_RootDirectory;
+};
+
+#endif	// #ifndef TarArchive_h
@@ -38,18 +38,24 @@ solution "MusOOEvaluator"
 		configuration {"macosx", "gmake"}
 			linkoptions {
 				"$(shell test ${COMPILED_LIBRARIES_LIB} && echo ${COMPILED_LIBRARIES_LIB} || echo $(shell brew --prefix)/lib)/libboost_filesystem.a",
+				"$(shell test ${COMPILED_LIBRARIES_LIB} && echo ${COMPILED_LIBRARIES_LIB} || echo $(shell brew --prefix)/lib)/libboost_iostreams.a",
 				"$(shell test ${COMPILED_LIBRARIES_LIB} && echo ${COMPILED_LIBRARIES_LIB} || echo $(shell brew --prefix)/lib)/libboost_program_options.a",
-				"$(shell test ${COMPILED_LIBRARIES_LIB} && echo ${COMPILED_LIBRARIES_LIB} || echo $(shell brew --prefix)/lib)/libboost_system.a"
+				"$(shell test ${COMPILED_LIBRARIES_LIB} && echo ${COMPILED_LIBRARIES_LIB} || echo $(shell brew --prefix)/lib)/libboost_system.a",
+				"$(shell test ${COMPILED_LIBRARIES_LIB} && echo ${COMPILED_LIBRARIES_LIB} || echo $(shell brew --prefix)/lib)/libboost_thread-mt.a",
+				"$(shell test ${COMPILED_LIBRARIES_LIB} && echo ${COMPILED_LIBRARIES_LIB} || echo $(shell brew --prefix)/lib)/libboost_chrono.a",
+				"-lz",
+				"-lzstd"
 			}
 			
 		configuration {"macosx", "xcode3"}
-			linkoptions {"${COMPILED_LIBRARIES_LIB}/libboost_filesystem.a", "${COMPILED_LIBRARIES_LIB}/libboost_program_options.a", "${COMPILED_LIBRARIES_LIB}/libboost_system.a"}
+			linkoptions {"${COMPILED_LIBRARIES_LIB}/libboost_filesystem.a", "${COMPILED_LIBRARIES_LIB}/libboost_iostreams.a", "${COMPILED_LIBRARIES_LIB}/libboost_program_options.a", "${COMPILED_LIBRARIES_LIB}/libboost_system.a", "${COMPILED_LIBRARIES_LIB}/libboost_thread-mt.a", "${COMPILED_LIBRARIES_LIB}/libboost_chrono.a", "-lz", "-lzstd"}
 
 		configuration "linux"
-			links {"boost_filesystem", "boost_program_options", "boost_system"}
+			links {"boost_filesystem", "boost_iostreams", "boost_program_options", "boost_system", "boost_thread", "boost_chrono", "pthread", "z", "zstd"}
 			linkoptions {" -static $(shell test ${COMPILED_LIBRARIES_LIB} && echo -L${COMPILED_LIBRARIES_LIB})"}
 			defines {"_SYS_SYSMACROS_H"}
 		 
 		configuration "vs*"
 			defines {"_CRT_SECURE_NO_WARNINGS", "_SCL_SECURE_NO_WARNINGS"}
 			libdirs {"$(COMPILED_LIBRARIES_LIB)"}
+			links {"zlib", "zstd"}